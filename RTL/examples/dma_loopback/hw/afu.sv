@@ -55,87 +55,90 @@
 //               asserted after size cache lines have been written to memory.
 //
 //               All addresses are virtual addresses provided by the software.
-//               All data elements are cachelines.
+//               All data elements are cachelines. Software can specify the
+//               size in bytes, in which case the last cache line is only
+//               partially written.
+//
+//               Software can post several jobs with go, which wait in a
+//               small queue in the AFU (see job_queue.sv). Jobs can also be
+//               queued in a descriptor ring in host memory (see dma_ring.sv).
+//
+//               The AFU also computes a CRC-32C of the read and written data
+//               (see crc32c.sv), which software reads through MMIO.
+//
+//               The HAL provides NUM_DMA_CHANNELS independent DMA channels.
+//               Each channel has its own loopback (see loopback_channel.sv)
+//               and its own copy of all the MMIO registers, where the
+//               registers of channel i start MMIO_CHANNEL_WORDS*i words after
+//               the registers of channel 0. Channel 0 uses the addresses of
+//               the original single-channel AFU.
 //
 
+//===================================================================
+// Parameter Description
+// NUM_DMA_CHANNELS : The number of DMA channels provided by the HAL.
+//===================================================================
+
 //===================================================================
 // Interface Description
 // clk  : Clock input
 // rst  : Reset input (active high)
 // mmio : Memory-mapped I/O interface. See mmio_if.vh and description above.
-// dma  : DMA interface. See dma_if.vh and description above.
+// dma  : DMA interface of each channel. See dma_if.vh and description above.
 //===================================================================
 
-`include "cci_mpf_if.vh"
-
-module afu 
+module afu
+  #(
+    parameter int NUM_DMA_CHANNELS=1
+    )
   (
    input clk,
    input rst,
 	 mmio_if.user mmio,
-	 dma_if.peripheral dma
+	 dma_if.peripheral dma[NUM_DMA_CHANNELS]
    );
 
-   localparam int CL_ADDR_WIDTH = $size(t_ccip_clAddr);
-      
-   // I want to just use dma.count_t, but apparently
-   // either SV or Modelsim doesn't support that. Similarly, I can't
-   // just do dma.SIZE_WIDTH without getting errors or warnings about
-   // "constant expression cannot contain a hierarchical identifier" in
-   // some tools. Declaring a function within the interface works just fine in
-   // some tools, but in Quartus I get an error about too many ports in the
-   // module instantiation.
-   typedef logic [CL_ADDR_WIDTH:0] count_t;   
-   count_t 	size;
-   logic 	go;
-   logic 	done;
-
-   // Software provides 64-bit virtual byte addresses.
-   // Again, this constant would ideally get read from the DMA interface if
-   // there was widespread tool support.
-   localparam int VIRTUAL_BYTE_ADDR_WIDTH = 64;
-   logic [VIRTUAL_BYTE_ADDR_WIDTH-1:0] rd_addr, wr_addr;
-
-   // Instantiate the memory map, which provides the starting read/write
-   // 64-bit virtual byte addresses, a transfer size (in cache lines), and a
-   // go signal. It also sends a done signal back to software.
-   memory_map
-     #(
-       .ADDR_WIDTH(VIRTUAL_BYTE_ADDR_WIDTH),
-       .SIZE_WIDTH(CL_ADDR_WIDTH+1)
-       )
-     memory_map (.*);
+   // Number of 32-bit MMIO words used by the registers of each channel.
+   localparam int MMIO_CHANNEL_WORDS = 16'h0080;
 
-   // Assign the starting addresses from the memory map.
-   assign dma.rd_addr = rd_addr;
-   assign dma.wr_addr = wr_addr;
+   // The memory maps return 0 for unused addresses, so the read data of
+   // all the channels can be combined with an OR.
+   logic [63:0] ch_rd_data[NUM_DMA_CHANNELS];
    
-   // Use the size (# of cache lines) specified by software.
-   assign dma.rd_size = size;
-   assign dma.wr_size = size;
-
-   // Start both the read and write channels when the MMIO go is received.
-   // Note that writes don't actually occur until dma.wr_en is asserted.
-   assign dma.rd_go = go;
-   assign dma.wr_go = go;
-
-   // Read from the DMA when there is data available (!dma.empty) and when
-   // it is safe to write data (!dma.full).
-   assign dma.rd_en = !dma.empty && !dma.full;
-
-   // Since this is a simple loopback, write to the DMA anytime we read.
-   // For most applications, write enable would be asserted when there is an
-   // output from a pipeline. In this case, the "pipeline" is a wire.
-   assign dma.wr_en = dma.rd_en;
-
-   // Write the data that is read.
-   assign dma.wr_data = dma.rd_data;
-
-   // The AFU is done when the DMA is done writing size cache lines.
-   assign done = dma.wr_done;
+   genvar i;
+   generate
+      for (i=0; i < NUM_DMA_CHANNELS; i++) begin : channels
+	 
+	 // Each channel sees its own registers at the addresses of channel 0.
+	 mmio_if
+	   #(
+	     .DATA_WIDTH(64),
+	     .ADDR_WIDTH(16),
+	     .START_ADDR(0),
+	     .END_ADDR(0)
+	     ) ch_mmio();
+
+	 assign ch_mmio.rd_en = mmio.rd_en;
+	 assign ch_mmio.wr_en = mmio.wr_en;
+	 assign ch_mmio.rd_addr = mmio.rd_addr - 16'(i*MMIO_CHANNEL_WORDS);
+	 assign ch_mmio.wr_addr = mmio.wr_addr - 16'(i*MMIO_CHANNEL_WORDS);
+	 assign ch_mmio.wr_data = mmio.wr_data;
+	 assign ch_rd_data[i] = ch_mmio.rd_data;
+
+	 loopback_channel channel
+	   (
+	    .clk,
+	    .rst,
+	    .mmio(ch_mmio),
+	    .dma(dma[i])
+	    );
+      end
+   endgenerate
+
+   always_comb begin
+      mmio.rd_data = '0;
+      for (int j=0; j < NUM_DMA_CHANNELS; j++)
+	mmio.rd_data |= ch_rd_data[j];
+   end
             
 endmodule
-
-
-
-
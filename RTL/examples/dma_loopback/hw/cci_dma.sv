@@ -19,10 +19,86 @@
 // Module Name:  cci_dma
 // Description:  This module converts the DMA interface in dma_if.vh into
 //               CCI-P.
+//
+//               Reads and writes use multi-line (2 or 4 cache line) requests
+//               when allowed by dma.burst_len. CCI-P requires a multi-line
+//               request to start at an address that is aligned to its
+//               length, so each request uses the largest length that is
+//               aligned and doesn't exceed the remaining cache lines. This
+//               means transfers that don't start or end on a 4-line boundary
+//               use shorter requests at the edges.
+//
+//               2D transfers (dma.rd_row_size/wr_row_size != 0) move to the
+//               start of the next row, pitch cache lines after the start of
+//               the current row, after each row. Multi-line requests never
+//               cross the end of a row, so each row is split into requests
+//               like a separate transfer.
+//
+//               A new transfer can be started on either channel as soon as
+//               all the memory requests of the previous transfer on that
+//               channel have been issued (rd_ready/wr_ready), which allows
+//               transfers to be chained without waiting for the previous
+//               transfer to complete. The write channel is full between
+//               write transfers.
+//
+//               When wr_last_bytes is non-zero, only the first wr_last_bytes
+//               bytes of the last cache line of a write transfer are written
+//               to memory, using a CCI-P byte-range write, which requires a
+//               platform with byte enables (ccip_cfg_pkg::BYTE_EN_SUPPORTED).
+//               The rest of the cache line is discarded, so transfers don't
+//               have to end on a cache-line boundary.
+//
+//               Each request uses the virtual channel and cache hints
+//               selected by dma.vc_policy and dma.cache_hints at the start
+//               of its transfer. When alternating between VH0 and VH1, every
+//               cache line of a multi-line write uses the same channel, as
+//               required by CCI-P.
+//
+//               The module also maintains the performance counters of
+//               dma.perf. The read latency is measured by sending the value
+//               of a free-running cycle counter in the mdata field of each
+//               read request, which is returned with each response. Since
+//               mdata is 16 bits, latencies are measured modulo 2^16 cycles.
+//
+//               When several DMA channels share CCI-P (see
+//               cci_dma_arbiter.sv), c0TxReq and c1TxReq tell the arbiter
+//               that the channel has read or write requests to issue, and
+//               c1TxLock tells the arbiter that the channel is in the middle
+//               of a multi-line write, which must not be interleaved with
+//               other writes. A channel only requests the write channel
+//               when the AFU has data to write (dma.wr_avail). c1TxArbStall
+//               is asserted when c1TxAlmFull comes from the arbiter instead
+//               of the FIU, so the performance counters can separate the
+//               two. The arbiter uses the upper MDATA_TAG_BITS bits of mdata
+//               to route read responses, which reduces the range of the
+//               latency measurements.
+//
+//               By default, MPF sorts the read responses, and the responses
+//               are stored in a FIFO. When REORDER_READS is set, MPF is
+//               expected to return responses out of order
+//               (MPF_CONF_SORT_READ_RESPONSES is 0 in cci_mpf_app_conf.vh).
+//               Each read request then allocates one slot per cache line in
+//               a reorder buffer (see reorder_buffer.sv) and sends the first
+//               slot in mdata, and each response is written into its slot
+//               using the cache-line number of the response. The reorder
+//               buffer replaces the FIFO, so no additional block RAM is
+//               needed for the data. The read timestamps are then stored
+//               in a separate RAM indexed by slot.
+
+//==========================================================================
+// Parameter Description
+// MDATA_TAG_BITS : The number of upper mdata bits reserved for the arbiter.
+// REORDER_READS  : When set, read responses can arrive out of order and are
+//                  reordered by a reorder buffer.
+//==========================================================================
 
 `include "cci_mpf_if.vh"
 
 module cci_dma
+  #(
+    parameter int MDATA_TAG_BITS=0,
+    parameter bit REORDER_READS=0
+    )
    (
     input 	clk,
     input 	rst,
@@ -35,8 +111,12 @@ module cci_dma
     // all the signals from cci_mpf_if that are needed by this module.
     output 	t_if_cci_mpf_c0_Tx c0Tx,
     input logic c0TxAlmFull,
+    output logic c0TxReq,
     output 	t_if_cci_mpf_c1_Tx c1Tx,
     input logic c1TxAlmFull,
+    input logic c1TxArbStall,
+    output logic c1TxReq,
+    output logic c1TxLock,
     input 	t_if_cci_c0_Rx c0Rx,
 		
 		dma_if.mem dma,
@@ -56,26 +136,98 @@ module cci_dma
    logic [CL_ADDR_WIDTH:0] dma_rd_remaining_r;   
    logic [CL_ADDR_WIDTH:0] cci_wr_remaining_r;   
    logic [CL_ADDR_WIDTH-1:0] rd_addr_r, wr_addr_r;
+
+   // Shape of 2D transfers, the starting address of the current row, and
+   // the remaining cache lines in the current row. A row size of 0 is a
+   // single contiguous range.
+   logic [CL_ADDR_WIDTH:0] rd_row_size_r, rd_pitch_r, rd_row_remaining_r;
+   logic [CL_ADDR_WIDTH:0] wr_row_size_r, wr_pitch_r, wr_row_remaining_r;
+   logic [CL_ADDR_WIDTH-1:0] rd_row_addr_r, wr_row_addr_r;
+
+   // Maximum burst length (in cache lines) for the current transfers.
+   logic [2:0] rd_burst_len_r, wr_burst_len_r;
+
+   // Virtual channel policy and cache hints of the current transfers, and
+   // whether the next request uses VH1 when alternating channels.
+   logic [2:0] rd_vc_policy_r, wr_vc_policy_r;
+   logic rd_cached_r, wr_cached_r;
+   logic rd_vh1_r, wr_vh1_r;
+
+   // Bytes to write from the last cache line of the current write transfer
+   // (0 for the entire cache line).
+   t_ccip_clByteIdx wr_last_bytes_r;
+
+   // Returns the length of the next request based on the alignment of the
+   // cache-line address, the remaining cache lines, and the maximum burst
+   // length.
+   function automatic t_ccip_clLen getClLen(logic [1:0] addr_lsbs,
+					    logic [CL_ADDR_WIDTH:0] remaining,
+					    logic [2:0] burst_len);
+      if (burst_len >= 4 && addr_lsbs == 2'b00 && remaining >= 4)
+	return eCL_LEN_4;
+      else if (burst_len >= 2 && addr_lsbs[0] == 1'b0 && remaining >= 2)
+	return eCL_LEN_2;
+      else
+	return eCL_LEN_1;
+   endfunction
+
+   // Returns the virtual channel of the next request for a vc_policy (see
+   // dma_if.vh).
+   function automatic t_ccip_vc getVc(logic [2:0] vc_policy, logic vh1);
+      case (vc_policy)
+	3'd1: return eVC_VL0;
+	3'd2: return eVC_VH0;
+	3'd3: return eVC_VH1;
+	3'd4: return vh1 ? eVC_VH1 : eVC_VH0;
+	default: return eVC_VA;
+      endcase
+   endfunction
+
+   // The number of cache lines of a request is the cl_len encoding + 1.
+   function automatic logic [2:0] getLines(t_ccip_clLen cl_len);
+      return 3'(cl_len) + 3'd1;
+   endfunction
    
+   // Free-running cycle counter, which is sent with each read request to
+   // measure the read latency. With a reorder buffer, the slot is sent
+   // instead.
+   localparam int TIMESTAMP_WIDTH = REORDER_READS ? $size(t_cci_mdata) : $size(t_cci_mdata) - MDATA_TAG_BITS;
+   localparam int SLOT_WIDTH = $clog2(FIFO_DEPTH);
+   logic [TIMESTAMP_WIDTH-1:0] timestamp_r;
+   logic [SLOT_WIDTH-1:0] rd_slot;
+
    // Create the read header that defines the request to the FIU
    t_cci_mpf_c0_ReqMemHdr rd_hdr;
    t_cci_mpf_ReqMemHdrParams rd_hdr_params;
+   t_ccip_clLen rd_cl_len;
+   logic [2:0] rd_lines;
+
+   // Cache lines that can be requested without crossing the end of a row.
+   logic [CL_ADDR_WIDTH:0] rd_run;
+   logic rd_row_end;
+
+   assign rd_run = rd_row_size_r != 0 && rd_row_remaining_r < cci_rd_remaining_r ? rd_row_remaining_r : cci_rd_remaining_r;
+   assign rd_cl_len = getClLen(rd_addr_r[1:0], rd_run, rd_burst_len_r);
+   assign rd_lines = getLines(rd_cl_len);
+   assign rd_row_end = rd_row_size_r != 0 && rd_row_remaining_r == rd_lines;
    
    always_comb begin
       // Tell MPF to use virtual addresses.
       rd_hdr_params = cci_mpf_defaultReqHdrParams(1);
       
-      // Tell the FIU to automatically select the communciation channel.
-      rd_hdr_params.vc_sel = eVC_VA;
+      // Use the virtual channel selected by software, which by default
+      // tells the FIU to automatically select the communciation channel.
+      rd_hdr_params.vc_sel = getVc(rd_vc_policy_r, rd_vh1_r);
       
-      // Always read 1 cacheline. This can be optimized
-      // but is kept simple for this training example.
-      rd_hdr_params.cl_len = eCL_LEN_1;
+      // Read 1, 2, or 4 cachelines. Each cache line of a multi-line read
+      // arrives as a separate response. When MPF sorts the read responses,
+      // the cache lines arrive in order.
+      rd_hdr_params.cl_len = rd_cl_len;
       
       // Create the memory read request header.
-      rd_hdr = cci_mpf_c0_genReqHdr(eREQ_RDLINE_I,
+      rd_hdr = cci_mpf_c0_genReqHdr(rd_cached_r ? eREQ_RDLINE_S : eREQ_RDLINE_I,
                                     rd_addr_r,
-                                    t_cci_mdata'(0),
+				    REORDER_READS ? t_cci_mdata'(rd_slot) : t_cci_mdata'(timestamp_r),
                                     rd_hdr_params);
    end // always_comb
    
@@ -85,9 +237,11 @@ module cci_dma
    // cachelines to be read and the read request buffer isn't
    // almost full, and the read data buffer isn't almost full.
    logic cci_rd_en;   
-   assign cci_rd_en = cci_rd_remaining_r > 0 && 
-		      !c0TxAlmFull &&
-		      !rd_fifo_almost_full;
+   assign cci_rd_en = c0TxReq && !c0TxAlmFull;
+
+   // Requests don't depend on the almost-full signals, so an arbiter can
+   // decide which channel issues a request in the same cycle.
+   assign c0TxReq = cci_rd_remaining_r > 0 && !rd_fifo_almost_full;
 
    // Make read requests (on the CCI c0 Tx port).
    always_ff @(posedge clk or posedge rst) begin
@@ -107,45 +261,154 @@ module cci_dma
    
    logic [$clog2(FIFO_DEPTH):0] rd_fifo_space;
 
-   // The read FIFO is almost full when the number of pending CCI reads
-   // is equal to the space left in the FIFO.
-   assign rd_fifo_almost_full = cci_rd_pending_r >= rd_fifo_space ? 1'b1 : 1'b0;
-   
-   // FIFO to buffer memory reads before the AFU reads it from the DMA channel.
-   fifo 
-     #(
-       .WIDTH($size(c0Rx.data)),
-       .DEPTH(FIFO_DEPTH)
-       )
-   rd_fifo 
-     (
-      .clk(clk),
-      .rst(rst),
-      .empty(dma.empty),
-      .rd_data(dma.rd_data),
-      .rd_en(dma.rd_en),
-      
-      .full(),
-      .almost_full(),
-      .count(),
-      .space(rd_fifo_space), 
-      .wr_data(c0Rx.data),
-      .wr_en(rd_response_valid),
-      .*
-      );     					       
-   
-   // Construct a memory write request header.  
+   // Measured latency of each read response.
+   logic [TIMESTAMP_WIDTH-1:0] rd_latency;
+   logic rd_latency_valid;
+   
+   generate
+      if (REORDER_READS) begin : rob
+	 // The slots of outstanding reads are already allocated, so the
+	 // reorder buffer only needs space for the next request.
+	 assign rd_fifo_almost_full = rd_lines > rd_fifo_space ? 1'b1 : 1'b0;
+
+	 // Reorder buffer to restore the order of the memory reads before
+	 // the AFU reads them from the DMA channel.
+	 reorder_buffer
+	   #(
+	     .WIDTH($size(c0Rx.data)),
+	     .DEPTH(FIFO_DEPTH)
+	     )
+	 rd_rob
+	   (
+	    .clk(clk),
+	    .rst(rst),
+	    .alloc_en(cci_rd_en),
+	    .alloc_count((SLOT_WIDTH+1)'(rd_lines)),
+	    .alloc_slot(rd_slot),
+	    .space(rd_fifo_space),
+	    .wr_en(rd_response_valid),
+	    .wr_slot(SLOT_WIDTH'(c0Rx.hdr.mdata) + SLOT_WIDTH'(c0Rx.hdr.cl_num)),
+	    .wr_data(c0Rx.data),
+	    .rd_en(dma.rd_en),
+	    .empty(dma.empty),
+	    .rd_data(dma.rd_data)
+	    );
+
+	 // The timestamp of each request is stored with its first slot,
+	 // which is the slot in the mdata of every response of the request.
+	 // The latency is available one cycle after the response.
+	 logic [TIMESTAMP_WIDTH-1:0] rd_time_ram[FIFO_DEPTH];
+	 logic [TIMESTAMP_WIDTH-1:0] rd_time_r;
+
+	 always_ff @(posedge clk) begin
+	    if (cci_rd_en)
+	      rd_time_ram[rd_slot] <= timestamp_r;
+
+	    rd_time_r <= rd_time_ram[SLOT_WIDTH'(c0Rx.hdr.mdata)];
+	 end
+
+	 always_ff @(posedge clk or posedge rst) begin
+	    if (rst)
+	      rd_latency_valid <= 1'b0;
+	    else
+	      rd_latency_valid <= rd_response_valid;
+	 end
+
+	 assign rd_latency = timestamp_r - rd_time_r - 1'b1;
+      end
+      else begin : in_order
+	 assign rd_slot = '0;
+	 
+	 // The read FIFO is almost full when there isn't enough space left
+	 // in the FIFO for the pending CCI reads and all the lines of the
+	 // next request.
+	 assign rd_fifo_almost_full = cci_rd_pending_r + rd_lines > rd_fifo_space ? 1'b1 : 1'b0;
+   
+	 // FIFO to buffer memory reads before the AFU reads it from the DMA
+	 // channel.
+	 fifo 
+	   #(
+	     .WIDTH($size(c0Rx.data)),
+	     .DEPTH(FIFO_DEPTH)
+	     )
+	 rd_fifo 
+	   (
+	    .clk(clk),
+	    .rst(rst),
+	    .empty(dma.empty),
+	    .rd_data(dma.rd_data),
+	    .rd_en(dma.rd_en),
+	    
+	    .full(),
+	    .almost_full(),
+	    .count(),
+	    .space(rd_fifo_space), 
+	    .wr_data(c0Rx.data),
+	    .wr_en(rd_response_valid)
+	    );
+
+	 assign rd_latency = timestamp_r - c0Rx.hdr.mdata[TIMESTAMP_WIDTH-1:0];
+	 assign rd_latency_valid = rd_response_valid;
+      end
+   endgenerate
+   
+   // The length of a multi-line write is decided on its first cache line
+   // (start of packet), and every cache line of the write is then sent with
+   // the same length. wr_beat_r is the index of the next cache line within
+   // the current write.
+   logic [1:0] wr_beat_r;
+   t_ccip_clLen wr_cl_len_r, wr_cl_len;
+   logic wr_sop;
+
+   // A partial last cache line is always written by itself, so it is
+   // excluded from the remaining cache lines of multi-line writes.
+   logic [CL_ADDR_WIDTH:0] wr_burst_remaining, wr_run;
+   logic wr_partial;
+   logic wr_row_end;
+
+   assign wr_partial = cci_wr_remaining_r == 1 && wr_last_bytes_r != 0;
+   assign wr_burst_remaining = wr_last_bytes_r != 0 && cci_wr_remaining_r > 1 ? cci_wr_remaining_r - 1'b1 : cci_wr_remaining_r;
+   assign wr_sop = wr_beat_r == '0;
+   assign wr_run = wr_row_size_r != 0 && wr_row_remaining_r < wr_burst_remaining ? wr_row_remaining_r : wr_burst_remaining;
+   assign wr_cl_len = wr_sop ? getClLen(wr_addr_r[1:0], wr_run, wr_burst_len_r) : wr_cl_len_r;
+   assign wr_row_end = wr_row_size_r != 0 && wr_row_remaining_r == 1;
+   
+   // Construct a memory write request header. Every cache line of a
+   // multi-line write has its own address, where the 2 low-order bits
+   // specify the cache line within the write.
    t_cci_mpf_c1_ReqMemHdr wr_hdr;
-   assign wr_hdr = cci_mpf_c1_genReqHdr(eREQ_WRLINE_I,
-                                        wr_addr_r,
-                                        t_cci_mdata'(0),
-                                        cci_mpf_defaultReqHdrParams(1));
+   t_cci_mpf_ReqMemHdrParams wr_hdr_params;
+   
+   always_comb begin
+      wr_hdr_params = cci_mpf_defaultReqHdrParams(1);
+      wr_hdr_params.vc_sel = getVc(wr_vc_policy_r, wr_vh1_r);
+      wr_hdr_params.cl_len = wr_cl_len;
+      
+      wr_hdr = cci_mpf_c1_genReqHdr(wr_cached_r ? eREQ_WRLINE_M : eREQ_WRLINE_I,
+                                    wr_addr_r,
+                                    t_cci_mdata'(0),
+                                    wr_hdr_params);
+      wr_hdr.base.sop = wr_sop;
+
+      // Only write the valid bytes of a partial last cache line.
+      if (wr_partial) begin
+	 wr_hdr.base.mode = eMOD_BYTE;
+	 wr_hdr.base.byte_start = '0;
+	 wr_hdr.base.byte_len = wr_last_bytes_r;
+      end
+   end
 
    // Make a CCI write request when the dma receives a wr_en, and when the
    // CCI write Tx channel isn't almost full, and when there are still
    // things left to write.
    logic cci_wr_en;
    assign cci_wr_en = dma.wr_en && !c1TxAlmFull && cci_wr_remaining_r > 0;
+
+   // The write channel's data can depend on c1TxAlmFull (through dma.full),
+   // so the write request uses wr_avail, which doesn't depend on full,
+   // instead of wr_en.
+   assign c1TxReq = cci_wr_remaining_r > 0 && dma.wr_avail;
+   assign c1TxLock = !wr_sop;
    
    // Control logic for memory writes
    always_ff @(posedge clk or posedge rst) begin
@@ -184,40 +447,76 @@ module cci_dma
 	 cci_rd_pending_r 	<= '0;	 
 	 cci_wr_remaining_r 	<= '0;
 	 cci_wr_en_delayed 	<= '0;
+	 wr_beat_r 		<= '0;
+	 wr_last_bytes_r 	<= '0;
+	 rd_vc_policy_r 	<= '0;
+	 wr_vc_policy_r 	<= '0;
+	 rd_cached_r 		<= '0;
+	 wr_cached_r 		<= '0;
+	 rd_vh1_r 		<= '0;
+	 wr_vh1_r 		<= '0;
       end
       else begin
 
-	 // Initialize read registers on go. The && rd_done ensures that
+	 // Initialize read registers on go. The && rd_ready ensures that
 	 // a user modifying go during execution doesn't corrupt the state.
-	 if (dma.rd_go && dma.rd_done) begin
+	 // The data from the previous transfer might not have been read yet,
+	 // so the new transfer is added to the remaining reads.
+	 if (dma.rd_go && dma.rd_ready) begin
 	    // Converts the virtual byte addresses to a cache line address.
 	    // This just removes 6 low-end bits from the 64-bit virtual addr.
 	    rd_addr_r <= dma.rd_addr[CL_BYTE_INDEX_BITS +: $size(t_cci_clAddr)];
 	    cci_rd_remaining_r <= dma.rd_size;
-	    dma_rd_remaining_r <= dma.rd_size;
+	    rd_row_addr_r <= dma.rd_addr[CL_BYTE_INDEX_BITS +: $size(t_cci_clAddr)];
+	    rd_row_size_r <= dma.rd_row_size;
+	    rd_row_remaining_r <= dma.rd_row_size;
+	    rd_pitch_r <= dma.rd_pitch;
+	    rd_burst_len_r <= dma.burst_len;
+	    rd_vc_policy_r <= dma.vc_policy;
+	    rd_cached_r <= dma.cache_hints[0];
 	 end 
 
-	 // Initialize write registers on go. The && wr_done ensures that
+	 // Initialize write registers on go. The && wr_ready ensures that
 	 // a user modifying go during execution doesn't corrupt the state.
-	 if (dma.wr_go && dma.wr_done) begin
+	 if (dma.wr_go && dma.wr_ready) begin
 	    // Converts the virtual byte addresses to a cache line address.
 	    // This just removes 6 low-end bits from the 64-bit virtual addr.
 	    wr_addr_r <= dma.wr_addr[CL_BYTE_INDEX_BITS +: $size(t_cci_clAddr)];
 	    cci_wr_remaining_r <= dma.wr_size;
+	    wr_row_addr_r <= dma.wr_addr[CL_BYTE_INDEX_BITS +: $size(t_cci_clAddr)];
+	    wr_row_size_r <= dma.wr_row_size;
+	    wr_row_remaining_r <= dma.wr_row_size;
+	    wr_pitch_r <= dma.wr_pitch;
+	    wr_burst_len_r <= dma.burst_len;
+	    wr_vc_policy_r <= dma.vc_policy;
+	    wr_cached_r <= dma.cache_hints[1];
+	    wr_last_bytes_r <= dma.wr_last_bytes;
+	    wr_beat_r <= '0;
 	 end
 	
-	 // Decrement the number of remaining reads on a valid read.
-	 if (dma.rd_en && !dma.empty) begin
-	    dma_rd_remaining_r <= dma_rd_remaining_r - 1;	    
-	 end
+	 // Add the size of new transfers, and decrement the number of
+	 // remaining reads on a valid read.
+	 dma_rd_remaining_r <= dma_rd_remaining_r + 
+			       (dma.rd_go && dma.rd_ready ? dma.rd_size : '0) -
+			       (dma.rd_en && !dma.empty ? 1'b1 : 1'b0);
 
 	 // On a CCI read request, update the read registers.
 	 if (cci_rd_en) begin
-	    rd_addr_r 	       <= rd_addr_r + 1;	    
-	    cci_rd_remaining_r <= cci_rd_remaining_r - 1;
+	    // Move to the next row after the last request of a row.
+	    if (rd_row_end) begin
+	       rd_addr_r <= rd_row_addr_r + CL_ADDR_WIDTH'(rd_pitch_r);
+	       rd_row_addr_r <= rd_row_addr_r + CL_ADDR_WIDTH'(rd_pitch_r);
+	       rd_row_remaining_r <= rd_row_size_r;
+	    end
+	    else begin
+	       rd_addr_r <= rd_addr_r + rd_lines;
+	       rd_row_remaining_r <= rd_row_remaining_r - rd_lines;
+	    end
+	    cci_rd_remaining_r <= cci_rd_remaining_r - rd_lines;
+	    rd_vh1_r <= !rd_vh1_r;
 	    
 	    // Purposesly blocking since this will be upated again below.
-	    cci_rd_pending_r 	= cci_rd_pending_r + 1;	    
+	    cci_rd_pending_r 	= cci_rd_pending_r + rd_lines;	    
 	 end
 
 	 // When CCI reponds with data, decrement the pending reads.
@@ -227,12 +526,29 @@ module cci_dma
 	 
 	 // Update the write address on a valid DMA write.
 	 if (dma.wr_en && !dma.full) begin
-	    wr_addr_r <= wr_addr_r + 1;	    
+	    if (wr_row_end) begin
+	       wr_addr_r <= wr_row_addr_r + CL_ADDR_WIDTH'(wr_pitch_r);
+	       wr_row_addr_r <= wr_row_addr_r + CL_ADDR_WIDTH'(wr_pitch_r);
+	       wr_row_remaining_r <= wr_row_size_r;
+	    end
+	    else begin
+	       wr_addr_r <= wr_addr_r + 1;
+	       wr_row_remaining_r <= wr_row_remaining_r - 1'b1;
+	    end
 	 end
 	 
 	 // On a CCI write request, decrement the remaining requests
 	 if (cci_wr_en) begin
 	    cci_wr_remaining_r <= cci_wr_remaining_r - 1;	    
+
+	    // Track the position within a multi-line write.
+	    wr_cl_len_r <= wr_cl_len;
+	    if (wr_beat_r == getLines(wr_cl_len) - 1) begin
+	       wr_beat_r <= '0;
+	       wr_vh1_r <= !wr_vh1_r;
+	    end
+	    else
+	      wr_beat_r <= wr_beat_r + 1'b1;
 	 end
 	 
 	 // Delay with an extra flip flop.
@@ -240,10 +556,85 @@ module cci_dma
       end      
    end 
 
+   // Performance counters. Reads are stalled when there are remaining read
+   // requests that can't be issued, and writes are stalled when there are
+   // remaining write requests that can't be issued.
+   localparam int PERF_ACTIVE = 0;
+   localparam int PERF_RD_REQS = 1;
+   localparam int PERF_RD_RSPS = 2;
+   localparam int PERF_WR_REQS = 3;
+   localparam int PERF_C0_STALL = 4;
+   localparam int PERF_RD_FIFO_STALL = 5;
+   localparam int PERF_RD_EN_STALL = 6;
+   localparam int PERF_C1_STALL = 7;
+   localparam int PERF_WR_EN_STALL = 8;
+   localparam int PERF_LAT_MIN = 9;
+   localparam int PERF_LAT_MAX = 10;
+   localparam int PERF_LAT_TOTAL = 11;
+   localparam int PERF_C1_ARB_STALL = 12;
+
+   always_ff @(posedge clk or posedge rst) begin
+      if (rst) begin
+	 timestamp_r <= '0;
+	 dma.perf <= '0;
+	 dma.perf[PERF_LAT_MIN] <= '1;
+      end
+      else begin
+	 timestamp_r <= timestamp_r + 1'b1;
+
+	 if (reads_are_pending || writes_are_pending)
+	   dma.perf[PERF_ACTIVE] <= dma.perf[PERF_ACTIVE] + 1'b1;
+
+	 if (cci_rd_en)
+	   dma.perf[PERF_RD_REQS] <= dma.perf[PERF_RD_REQS] + 1'b1;
+
+	 if (cci_wr_en)
+	   dma.perf[PERF_WR_REQS] <= dma.perf[PERF_WR_REQS] + 1'b1;
+
+	 if (cci_rd_remaining_r > 0 && c0TxAlmFull)
+	   dma.perf[PERF_C0_STALL] <= dma.perf[PERF_C0_STALL] + 1'b1;
+
+	 if (cci_rd_remaining_r > 0 && !c0TxAlmFull && rd_fifo_almost_full)
+	   dma.perf[PERF_RD_FIFO_STALL] <= dma.perf[PERF_RD_FIFO_STALL] + 1'b1;
+
+	 if (!dma.empty && !dma.rd_en)
+	   dma.perf[PERF_RD_EN_STALL] <= dma.perf[PERF_RD_EN_STALL] + 1'b1;
+
+	 if (cci_wr_remaining_r > 0 && c1TxAlmFull && !c1TxArbStall)
+	   dma.perf[PERF_C1_STALL] <= dma.perf[PERF_C1_STALL] + 1'b1;
+
+	 if (cci_wr_remaining_r > 0 && c1TxArbStall && dma.wr_avail)
+	   dma.perf[PERF_C1_ARB_STALL] <= dma.perf[PERF_C1_ARB_STALL] + 1'b1;
+
+	 if (cci_wr_remaining_r > 0 && !c1TxAlmFull && !dma.wr_en)
+	   dma.perf[PERF_WR_EN_STALL] <= dma.perf[PERF_WR_EN_STALL] + 1'b1;
+
+	 if (rd_response_valid)
+	   dma.perf[PERF_RD_RSPS] <= dma.perf[PERF_RD_RSPS] + 1'b1;
+
+	 if (rd_latency_valid) begin
+	    dma.perf[PERF_LAT_TOTAL] <= dma.perf[PERF_LAT_TOTAL] + rd_latency;
+
+	    if (64'(rd_latency) < dma.perf[PERF_LAT_MIN])
+	      dma.perf[PERF_LAT_MIN] <= 64'(rd_latency);
+
+	    if (64'(rd_latency) > dma.perf[PERF_LAT_MAX])
+	      dma.perf[PERF_LAT_MAX] <= 64'(rd_latency);
+	 end
+
+	 if (dma.perf_clear) begin
+	    dma.perf <= '0;
+	    dma.perf[PERF_LAT_MIN] <= '1;
+	 end
+      end
+   end
+
    // Assign DMA interface outputs.
    assign dma.rd_done = !reads_are_pending;
    assign dma.wr_done = !writes_are_pending;
-   assign dma.full    = c1TxAlmFull;
+   assign dma.rd_ready = cci_rd_remaining_r == 0;
+   assign dma.wr_ready = cci_wr_remaining_r == 0;
+   assign dma.full    = c1TxAlmFull || cci_wr_remaining_r == 0;
   
 endmodule
 
@@ -0,0 +1,160 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+
+// Module Name:  cci_dma_arbiter.sv
+// Description:  This module shares the CCI-P request channels between
+//               several DMA channels (see cci_dma.sv), so independent jobs
+//               can run at the same time.
+//
+//               Each Tx channel is arbitrated round robin between the DMA
+//               channels that have requests to issue. Every cycle, only the
+//               granted DMA channel sees its almost-full signal cleared, so
+//               at most one DMA channel issues a request in each cycle, and
+//               the requests can be forwarded without any buffering. A
+//               multi-line write keeps the write channel until all of its
+//               cache lines have been sent.
+//
+//               The index of the requesting DMA channel is stored in the
+//               upper bits of the mdata field of each read request, which
+//               is used to send each read response to the right DMA channel.
+//               Write responses aren't used by cci_dma.sv.
+
+//==========================================================================
+// Parameter Description
+// NUM_CHANNELS : The number of DMA channels.
+// TAG_BITS     : The number of upper mdata bits that store the channel index.
+//==========================================================================
+
+//==========================================================================
+// Interface Description (All control signals are active high)
+// clk          : clk
+// rst          : rst (asynchronous)
+// c0Tx, c0TxAlmFull, c1Tx, c1TxAlmFull, c0Rx : the shared CCI signals
+// ch_*         : the corresponding signals of each DMA channel
+// ch_c0TxReq   : the DMA channel has a read request to issue
+// ch_c1TxReq   : the DMA channel has write requests to issue
+// ch_c1TxLock  : the DMA channel is in the middle of a multi-line write
+// ch_c1TxArbStall : ch_c1TxAlmFull is asserted because another DMA channel
+//                   has the write channel, not because of c1TxAlmFull
+//==========================================================================
+
+`include "cci_mpf_if.vh"
+
+module cci_dma_arbiter
+  #(
+    parameter int NUM_CHANNELS,
+    parameter int TAG_BITS=$clog2(NUM_CHANNELS)
+    )
+   (
+    input 			   clk,
+    input 			   rst,
+
+    output 			   t_if_cci_mpf_c0_Tx c0Tx,
+    input logic 		   c0TxAlmFull,
+    output 			   t_if_cci_mpf_c1_Tx c1Tx,
+    input logic 		   c1TxAlmFull,
+    input 			   t_if_cci_c0_Rx c0Rx,
+
+    input 			   t_if_cci_mpf_c0_Tx ch_c0Tx[NUM_CHANNELS],
+    input logic [NUM_CHANNELS-1:0] ch_c0TxReq,
+    output logic [NUM_CHANNELS-1:0] ch_c0TxAlmFull,
+    input 			   t_if_cci_mpf_c1_Tx ch_c1Tx[NUM_CHANNELS],
+    input logic [NUM_CHANNELS-1:0] ch_c1TxReq,
+    input logic [NUM_CHANNELS-1:0] ch_c1TxLock,
+    output logic [NUM_CHANNELS-1:0] ch_c1TxAlmFull,
+    output logic [NUM_CHANNELS-1:0] ch_c1TxArbStall,
+    output 			   t_if_cci_c0_Rx ch_c0Rx[NUM_CHANNELS]
+    );
+
+   localparam int MDATA_WIDTH = $size(t_cci_mdata);
+
+   // Width of the tag slices, which are unused with a single channel.
+   localparam int TAG_WIDTH = TAG_BITS > 0 ? TAG_BITS : 1;
+   
+   // Returns the first requesting channel after the last granted channel,
+   // or the last granted channel if no other channel is requesting.
+   function automatic int nextGrant(logic [NUM_CHANNELS-1:0] req, int last);
+      int grant = last;
+      for (int i=NUM_CHANNELS-1; i > 0; i--) begin
+	 if (req[(last + i) % NUM_CHANNELS]) grant = (last + i) % NUM_CHANNELS;
+      end
+      return grant;
+   endfunction
+
+   int c0_grant, c1_grant;
+   int c0_last_r, c1_last_r;
+
+   always_comb begin
+      c0_grant = nextGrant(ch_c0TxReq, c0_last_r);
+
+      // A multi-line write can't be interrupted. Only the granted channel
+      // can start a write, so at most one channel is locked.
+      c1_grant = nextGrant(ch_c1TxReq, c1_last_r);
+      for (int i=0; i < NUM_CHANNELS; i++) begin
+	 if (ch_c1TxLock[i]) c1_grant = i;
+      end
+
+      for (int i=0; i < NUM_CHANNELS; i++) begin
+	 ch_c0TxAlmFull[i] = c0TxAlmFull || c0_grant != i;
+	 ch_c1TxAlmFull[i] = c1TxAlmFull || c1_grant != i;
+	 ch_c1TxArbStall[i] = !c1TxAlmFull && c1_grant != i;
+      end
+   end
+
+   always_ff @(posedge clk or posedge rst) begin
+      if (rst) begin
+	 c0_last_r <= 0;
+	 c1_last_r <= 0;
+      end
+      else begin
+	 if (ch_c0TxReq != 0) c0_last_r <= c0_grant;
+	 if (ch_c1TxReq != 0) c1_last_r <= c1_grant;
+      end
+   end
+
+   // Forward the requests. The DMA channels register their requests, so at
+   // most one channel has a valid request in each cycle.
+   always_comb begin
+      c0Tx = ch_c0Tx[0];
+      c1Tx = ch_c1Tx[0];
+      c0Tx.valid = 1'b0;
+      c1Tx.valid = 1'b0;
+      
+      for (int i=0; i < NUM_CHANNELS; i++) begin
+	 if (ch_c0Tx[i].valid) begin
+	    c0Tx = ch_c0Tx[i];
+	    if (TAG_BITS > 0)
+	      c0Tx.hdr.base.mdata[MDATA_WIDTH-1 -: TAG_WIDTH] = TAG_WIDTH'(i);
+	 end
+
+	 if (ch_c1Tx[i].valid) c1Tx = ch_c1Tx[i];
+      end
+   end
+
+   // Send each read response to the channel that made the request. All
+   // other responses (e.g. MMIO) go to every channel.
+   always_comb begin
+      for (int i=0; i < NUM_CHANNELS; i++) begin
+	 ch_c0Rx[i] = c0Rx;
+	 if (TAG_BITS > 0 && cci_c0Rx_isReadRsp(c0Rx) &&
+	     c0Rx.hdr.mdata[MDATA_WIDTH-1 -: TAG_WIDTH] != TAG_WIDTH'(i))
+	   ch_c0Rx[i].rspValid = 1'b0;
+      end
+   end
+
+endmodule
@@ -35,5 +35,7 @@
 // Use virtual addresses in the AFU
 `define MPF_CONF_ENABLE_VTP 1
 
-// Ordered responses are required by the application
+// Ordered responses are required by the application. When set to 0, MPF
+// returns read responses out of order, and the HAL reorders them in the
+// reorder buffer of each DMA channel (see cci_dma.sv).
 `define MPF_CONF_SORT_READ_RESPONSES 1
@@ -315,7 +315,10 @@ module ccip_std_afu
    hal
      #(
        .MMIO_START_ADDR(16'h0050),
-       .MMIO_END_ADDR(MPF_DFH_MMIO_ADDR/4 - 2)       
+       .MMIO_END_ADDR(MPF_DFH_MMIO_ADDR/4 - 2),
+       .NUM_DMA_CHANNELS(2),
+       // Reorder the read responses in the DMA channels when MPF doesn't.
+       .REORDER_READS(!`MPF_CONF_SORT_READ_RESPONSES)
        )
    hal
      (
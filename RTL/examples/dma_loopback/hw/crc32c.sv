@@ -0,0 +1,129 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+
+// Module Name:  crc32c.sv
+// Description:  This module computes a running CRC-32C (Castagnoli) of a
+//               stream of cache lines, one cache line per cycle. The result
+//               matches the standard CRC-32C of the bytes in memory order
+//               (i.e. the same value as the SSE4.2 crc32 instruction), where
+//               byte 0 of a cache line is data[7:0].
+//
+//               Computing the CRC of an entire cache line in a single cycle
+//               would require a very deep XOR tree in the feedback path.
+//               Instead, the CRC is split using the linearity of CRCs:
+//
+//               crc(state, line) = crc(state, 0) ^ crc(0, line)
+//
+//               crc(0, line) does not depend on the state, so it is
+//               pipelined over two stages: the first stage computes the
+//               contribution of each CHUNK_WIDTH-bit chunk of the line, and
+//               the second stage XORs the contributions together. The
+//               feedback path only contains crc(state, 0), which is a 32x32
+//               XOR matrix.
+//
+//               The CRC is updated 3 cycles after valid is asserted.
+
+//==========================================================================
+// Parameter Description
+// DATA_WIDTH  : The number of bits in each input. Must be a multiple of
+//               CHUNK_WIDTH.
+// CHUNK_WIDTH : The number of bits combined in each XOR tree of the first
+//               pipeline stage.
+//==========================================================================
+
+//==========================================================================
+// Interface Description (All control signals are active high)
+// clk   : clk
+// rst   : rst (asynchronous)
+// clear : restarts the CRC (takes priority over valid)
+// valid : data is valid
+// data  : the data to add to the CRC
+// crc   : the CRC-32C of all valid data since the last clear
+//==========================================================================
+
+module crc32c
+  #(
+    parameter int DATA_WIDTH=512,
+    parameter int CHUNK_WIDTH=64
+    )
+   (
+    input logic 		 clk,
+    input logic 		 rst,
+    input logic 		 clear,
+    input logic 		 valid,
+    input logic [DATA_WIDTH-1:0] data,
+    output logic [31:0] 	 crc
+    );
+
+   // Reflected CRC-32C polynomial.
+   localparam logic [31:0] POLY = 32'h82F63B78;
+   localparam int NUM_CHUNKS = DATA_WIDTH / CHUNK_WIDTH;
+
+   // Bit-serial CRC update. The loop only describes the XOR networks, so
+   // when called with constant or zero operands, synthesis reduces it to
+   // the corresponding XOR matrix.
+   function automatic logic [31:0] crc_update(logic [31:0] crc, logic [DATA_WIDTH-1:0] data);
+      for (int i=0; i < DATA_WIDTH; i++) begin
+	 crc = (crc >> 1) ^ ((crc[0] ^ data[i]) ? POLY : 32'h0);
+      end
+      return crc;
+   endfunction
+
+   logic [31:0] chunk_crc_r[NUM_CHUNKS];
+   logic [31:0] data_crc, data_crc_r;
+   logic [31:0] state_r;
+   logic [1:0] 	valid_r;
+
+   // crc(0, line) from the chunk contributions.
+   always_comb begin
+      data_crc = '0;
+      for (int i=0; i < NUM_CHUNKS; i++) begin
+	 data_crc = data_crc ^ chunk_crc_r[i];
+      end
+   end
+
+   always_ff @(posedge clk or posedge rst) begin
+      if (rst) begin
+	 for (int i=0; i < NUM_CHUNKS; i++) chunk_crc_r[i] <= '0;
+	 data_crc_r <= '0;
+	 state_r <= '1;
+	 valid_r <= '0;
+      end
+      else begin
+	 // Stage 1: the contribution of each chunk in its position within
+	 // the cache line.
+	 for (int i=0; i < NUM_CHUNKS; i++) begin
+	    chunk_crc_r[i] <= crc_update(32'h0, DATA_WIDTH'(data[i*CHUNK_WIDTH +: CHUNK_WIDTH]) << (i*CHUNK_WIDTH));
+	 end
+
+	 // Stage 2: crc(0, line)
+	 data_crc_r <= data_crc;
+
+	 valid_r <= {valid_r[0], valid};
+
+	 // Stage 3: combine with the running state.
+	 if (clear)
+	   state_r <= '1;
+	 else if (valid_r[1])
+	   state_r <= crc_update(state_r, '0) ^ data_crc_r;
+      end
+   end
+
+   assign crc = ~state_r;
+
+endmodule
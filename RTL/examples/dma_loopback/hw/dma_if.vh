@@ -35,6 +35,71 @@
 //               puts the corresponding data on wr_data and asserts wr_en
 //               (active high) for one cycle. The wr_done signal is continuosly
 //               asserted after size cache lines have been written to memory.
+//
+//               wr_avail tells the DMA that the AFU has data to write, even
+//               when the write interface is full, so it must not depend on
+//               full. When several DMA channels share CCI-P, a channel only
+//               requests the write channel while wr_avail is asserted, so a
+//               channel that is still waiting for its data doesn't take
+//               write cycles from the other channels. AFUs that can't
+//               provide it can assign 1.
+//
+//               rd_ready and wr_ready are asserted when the corresponding
+//               channel can accept a new go, which occurs as soon as all the
+//               memory requests of the previous transfer have been issued.
+//               A transfer started before the previous transfer is done
+//               continues the same stream of data: the read data of the new
+//               transfer follows the read data of the previous transfer, and
+//               write data is written to the new transfer after the previous
+//               transfer's size cache lines have been written. The write
+//               channel is full whenever no write transfer is in progress.
+//
+//               wr_last_bytes is the number of bytes to write from the last
+//               cache line of a write transfer, where 0 writes the entire
+//               cache line. The rest of a partial last cache line is
+//               discarded. All transfers still start on a cache line.
+//
+//               perf contains performance counters that accumulate until
+//               perf_clear is asserted, which software uses to find out why
+//               transfers are slow (see cci_dma.sv for the exact conditions):
+//               perf[0]  : cycles with pending reads or writes
+//               perf[1]  : read requests issued
+//               perf[2]  : read responses received (cache lines)
+//               perf[3]  : write requests issued (cache lines)
+//               perf[4]  : cycles reads were stalled by c0TxAlmFull
+//               perf[5]  : cycles reads were stalled by the read FIFO
+//               perf[6]  : cycles read data was available but not read
+//               perf[7]  : cycles writes were stalled by c1TxAlmFull
+//               perf[8]  : cycles writes were waiting for wr_en
+//               perf[9]  : minimum read latency (cycles)
+//               perf[10] : maximum read latency (cycles)
+//               perf[11] : total read latency of all responses (cycles)
+//               perf[12] : cycles writes were stalled by another DMA
+//                          channel using the write channel
+//
+//               burst_len specifies the maximum number of cache lines (1, 2,
+//               or 4) of each memory request. It only affects the efficiency
+//               of the transfers, and must not change while a transfer is in
+//               progress.
+//
+//               rd_row_size and rd_pitch describe 2D reads: the transfer
+//               reads rows of rd_row_size cache lines, where each row starts
+//               rd_pitch cache lines after the start of the previous row.
+//               rd_size is still the total number of cache lines, so the
+//               number of rows is rd_size / rd_row_size. Strided reads of
+//               every k-th cache line use a row size of 1 and a pitch of k.
+//               A row size of 0 reads one contiguous range. Writes use
+//               wr_row_size and wr_pitch the same way, and both are sampled
+//               with go.
+//
+//               vc_policy selects the CCI-P virtual channel of each memory
+//               request: 0 lets the FIU select the channel (eVC_VA), 1 uses
+//               VL0, 2 uses VH0, 3 uses VH1, and 4 alternates requests
+//               between VH0 and VH1. cache_hints[0] reads with RDLINE_S
+//               instead of RDLINE_I, and cache_hints[1] writes with WRLINE_M
+//               instead of WRLINE_I, which keeps data that the host reads
+//               back immediately in the FPGA cache. Both are sampled with
+//               go, so each transfer uses the values at its start.
 
 `ifndef DMA_IF
 `define DMA_IF
@@ -46,15 +111,26 @@ interface dma_if #(parameter int DATA_WIDTH,
    typedef logic [ADDR_WIDTH-1:0] addr_t;
    typedef logic [SIZE_WIDTH-1:0] count_t;
 
-   logic rd_go, rd_done, rd_en, empty;
+   logic rd_go, rd_done, rd_ready, rd_en, empty;
    logic [DATA_WIDTH-1:0] rd_data;
    addr_t rd_addr;
    count_t rd_size;
 
-   logic   wr_go, wr_done, wr_en, full;
+   logic   wr_go, wr_done, wr_ready, wr_en, wr_avail, full;
    logic [DATA_WIDTH-1:0] wr_data;
    addr_t wr_addr;
    count_t wr_size;
+   logic [$clog2(DATA_WIDTH/8)-1:0] wr_last_bytes;
+
+   count_t rd_row_size, rd_pitch;
+   count_t wr_row_size, wr_pitch;
+
+   logic [2:0] burst_len;
+   logic [2:0] vc_policy;
+   logic [1:0] cache_hints;
+
+   logic [12:0][63:0] perf;
+   logic 	      perf_clear;
 
    function int getAddrWidth;
       return ADDR_WIDTH;
@@ -70,15 +146,30 @@ interface dma_if #(parameter int DATA_WIDTH,
       input  rd_size,
       output rd_data,
       output rd_done,
+      output rd_ready,
       output empty,
 
       input  wr_go,
       input  wr_en,
+      input  wr_avail,
       input  wr_addr,
       input  wr_size,
+      input  wr_last_bytes,
+      input  rd_row_size,
+      input  rd_pitch,
+      input  wr_row_size,
+      input  wr_pitch,
       input  wr_data,
       output wr_done,
-      output full				
+      output wr_ready,
+      output full,
+
+      input  burst_len,
+      input  vc_policy,
+      input  cache_hints,
+
+      output perf,
+      input  perf_clear
       );
    
    modport peripheral 
@@ -91,15 +182,30 @@ interface dma_if #(parameter int DATA_WIDTH,
       output rd_size,
       input  rd_data,
       input  rd_done,
+      input  rd_ready,
       input  empty,
 		       
       output wr_go,
       output wr_en,
+      output wr_avail,
       output wr_addr,
       output wr_size,
+      output wr_last_bytes,
+      output rd_row_size,
+      output rd_pitch,
+      output wr_row_size,
+      output wr_pitch,
       output wr_data,
       input  wr_done,
-      input  full		       
+      input  wr_ready,
+      input  full,
+
+      output burst_len,
+      output vc_policy,
+      output cache_hints,
+
+      input  perf,
+      output perf_clear
       );
    
 endinterface
@@ -0,0 +1,473 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+
+// Module Name:  dma_ring.sv
+// Description:  This module sits between the AFU and the DMA interface of
+//               the HAL, and adds a descriptor-ring mode in which software
+//               queues any number of DMA jobs in a ring in host memory,
+//               without any MMIO writes other than a doorbell.
+//
+//               Each ring entry is a 64-byte descriptor:
+//               bytes 0-7   : starting read address (virtual byte address)
+//               bytes 8-15  : starting write address (virtual byte address)
+//               bytes 16-23 : size (# of cache lines)
+//               bytes 24-31 : flags (bit 0: write a completion record,
+//                                    bit 1: scatter-gather)
+//               bytes 32-39 : cycles (written by the AFU)
+//               bytes 40-47 : bytes transferred (written by the AFU)
+//               bytes 56-63 : status (written by the AFU, 1 when complete)
+//
+//               A scatter-gather descriptor instead transfers data between
+//               lists of non-contiguous memory regions:
+//               bytes 0-7   : address of the read list (64B aligned)
+//               bytes 8-15  : address of the write list (64B aligned)
+//               bytes 16-23 : number of read list entries
+//               bytes 48-55 : number of write list entries
+//               Each list entry is 16 bytes: the starting virtual byte address
+//               of a region (bytes 0-7) and its size in cache lines (bytes
+//               8-15). Both lists must have between 1 and MAX_SG_ENTRIES
+//               entries. Before transferring any data, the lists are read
+//               into on-chip RAMs, after which the read and write lists are
+//               walked independently, starting each region as soon as the
+//               HAL has issued all the requests of the previous region. The
+//               data is a single stream, so the regions of the two lists
+//               don't have to line up. Descriptor jobs always transfer
+//               entire cache lines.
+//
+//               Software writes descriptors into the ring and then writes
+//               the total number of descriptors it has queued (ring_tail).
+//               Whenever ring_head != ring_tail, this module reads the next
+//               descriptor from memory, runs the DMA job, and, if requested,
+//               writes the descriptor back into the ring with the status
+//               set, which software polls from its cache. ring_head is then
+//               incremented. ring_head and ring_tail are free-running
+//               counts, where ring entry (count % ring_entries) is used.
+//
+//               The descriptors and completion records use the same DMA
+//               interface as the AFU, so while they are being transferred,
+//               the AFU sees an empty read channel and a full write channel.
+//               When the ring is idle, all signals pass through unmodified,
+//               so the AFU can also start jobs directly with go.
+//
+//               For jobs started directly with go, software can also provide
+//               the address of a status cache line (status_addr), so that it
+//               can detect completion from its cache instead of polling done
+//               with MMIO. After all of the job's writes have been committed,
+//               this module writes the status line:
+//               bytes 0-7   : job id (number of jobs since status_addr was set)
+//               bytes 8-15  : done (1)
+//               bytes 16-23 : cycles from go until the writes were committed
+//               bytes 24-31 : bytes written
+//               The AFU's done signal isn't asserted until the status line
+//               has been written. A status_addr of 0 disables the status line.
+
+//==========================================================================
+// Parameter Description
+// ADDR_WIDTH : The number of bits in the DMA addresses.
+// SIZE_WIDTH : The number of bits in the DMA sizes.
+// COUNT_WIDTH : The number of bits in the ring counts.
+// MAX_SG_ENTRIES : The maximum number of entries in each scatter-gather
+//                  list. Must be a multiple of 4.
+//==========================================================================
+
+//==========================================================================
+// Interface Description (All control signals are active high)
+// clk          : clk
+// rst          : rst (asynchronous)
+// ring_addr    : starting virtual byte address of the ring (64B aligned)
+// ring_entries : number of ring entries (power of 2, 0 disables the ring)
+// ring_tail    : number of descriptors queued by software
+// ring_reset   : clears ring_head (when software sets up a new ring)
+// ring_head    : number of descriptors completed
+// status_addr  : virtual byte address of the status line (64B aligned)
+// status_reset : clears job_count (when software sets a new status_addr)
+// job_count    : number of direct jobs with a status line
+// app          : DMA interface for the AFU
+// dma          : DMA interface of the HAL
+//==========================================================================
+
+module dma_ring
+  #(
+    parameter int ADDR_WIDTH,
+    parameter int SIZE_WIDTH,
+    parameter int COUNT_WIDTH=32,
+    parameter int MAX_SG_ENTRIES=256
+    )
+   (
+    input logic 		   clk,
+    input logic 		   rst,
+    input logic [ADDR_WIDTH-1:0]   ring_addr,
+    input logic [COUNT_WIDTH-1:0]  ring_entries,
+    input logic [COUNT_WIDTH-1:0]  ring_tail,
+    input logic 		   ring_reset,
+    output logic [COUNT_WIDTH-1:0] ring_head,
+    input logic [ADDR_WIDTH-1:0]   status_addr,
+    input logic 		   status_reset,
+    output logic [COUNT_WIDTH-1:0] job_count,
+	   dma_if.mem app,
+	   dma_if.peripheral dma
+    );
+
+   // Each descriptor is one cache line, so the byte index is log2(64) = 6 bits.
+   localparam CL_BYTE_INDEX_BITS = 6;
+
+   localparam logic [63:0] STATUS_DONE = 64'h1;
+
+   // Each scatter-gather entry is 16 bytes, so there are 4 per cache line.
+   localparam SG_ENTRY_WIDTH = 128;
+   localparam SG_ENTRIES_PER_LINE = $size(dma.rd_data) / SG_ENTRY_WIDTH;
+   localparam SG_LINES = MAX_SG_ENTRIES / SG_ENTRIES_PER_LINE;
+   localparam SG_COUNT_WIDTH = $clog2(MAX_SG_ENTRIES+1);
+   typedef logic [SG_COUNT_WIDTH-1:0] sg_count_t;
+
+   typedef enum {IDLE, FETCH_GO, FETCH, START, RUN, SG_FETCH_GO, SG_FETCH, SG_RUN, DIRECT, CMPL_GO, CMPL_WRITE, CMPL_WAIT} state_t;
+   state_t state_r;
+
+   // Asserted when the current job was started by go.
+   logic direct_r;
+   logic [63:0] cycles_r, bytes_r;
+
+   logic [$size(dma.rd_data)-1:0] desc_r;
+   logic [ADDR_WIDTH-1:0] 	 desc_rd_addr, desc_wr_addr, slot_addr;
+   logic [SIZE_WIDTH-1:0] 	 desc_size;
+   logic                         desc_completion, desc_sg;
+   sg_count_t                    desc_rd_entries, desc_wr_entries;
+
+   // Descriptor fields.
+   assign desc_rd_addr = desc_r[0 +: ADDR_WIDTH];
+   assign desc_wr_addr = desc_r[64 +: ADDR_WIDTH];
+   assign desc_size = desc_r[128 +: SIZE_WIDTH];
+   assign desc_completion = desc_r[192];
+   assign desc_sg = desc_r[193];
+   assign desc_rd_entries = desc_r[128 +: SG_COUNT_WIDTH];
+   assign desc_wr_entries = desc_r[384 +: SG_COUNT_WIDTH];
+
+   // Scatter-gather lists. sg_side_r selects the list being fetched
+   // (0: read list, 1: write list).
+   logic [$size(dma.rd_data)-1:0] sg_rd_ram[SG_LINES];
+   logic [$size(dma.rd_data)-1:0] sg_wr_ram[SG_LINES];
+   logic [$size(dma.rd_data)-1:0] sg_rd_line_r, sg_wr_line_r;
+   logic                          sg_rd_line_valid_r, sg_wr_line_valid_r;
+   logic                          sg_side_r;
+   sg_count_t                     sg_fetch_lines, sg_fetch_index_r;
+   sg_count_t                     sg_rd_index_r, sg_wr_index_r;
+   logic [SG_ENTRY_WIDTH-1:0]     sg_rd_entry, sg_wr_entry;
+   logic                          sg_rd_go, sg_wr_go;
+
+   assign sg_fetch_lines = ((sg_side_r ? desc_wr_entries : desc_rd_entries) + SG_ENTRIES_PER_LINE - 1) / SG_ENTRIES_PER_LINE;
+
+   // The current entry of each list. The RAM outputs are invalid for one
+   // cycle after the index changes.
+   assign sg_rd_entry = sg_rd_line_r[(sg_rd_index_r % SG_ENTRIES_PER_LINE) * SG_ENTRY_WIDTH +: SG_ENTRY_WIDTH];
+   assign sg_wr_entry = sg_wr_line_r[(sg_wr_index_r % SG_ENTRIES_PER_LINE) * SG_ENTRY_WIDTH +: SG_ENTRY_WIDTH];
+
+   // Start the next region of each list when the HAL can accept it.
+   assign sg_rd_go = state_r == SG_RUN && sg_rd_index_r != desc_rd_entries &&
+		     sg_rd_line_valid_r && dma.rd_ready;
+   assign sg_wr_go = state_r == SG_RUN && sg_wr_index_r != desc_wr_entries &&
+		     sg_wr_line_valid_r && dma.wr_ready;
+
+   // A job is complete when all of its regions have been started and all
+   // of the reads and writes have been completed.
+   logic job_done;
+   assign job_done = dma.rd_done && dma.wr_done &&
+		     (state_r == RUN || (sg_rd_index_r == desc_rd_entries &&
+					 sg_wr_index_r == desc_wr_entries));
+
+   // Address of the ring entry for the current descriptor.
+   assign slot_addr = ring_addr + (ADDR_WIDTH'(ring_head & (ring_entries - 1'b1)) << CL_BYTE_INDEX_BITS);
+
+   // Start a descriptor when there is one, and when nothing else is using
+   // the DMA.
+   logic start_desc;
+   assign start_desc = ring_entries != 0 && ring_head != ring_tail &&
+		       dma.rd_done && dma.wr_done && !app.rd_go && !app.wr_go;
+
+   // Track a job started by go when it needs a status line. Go is ignored
+   // until the previous transfer is done.
+   logic start_direct;
+   assign start_direct = status_addr != 0 && app.wr_go && dma.wr_done;
+
+   // Bytes written by a job started by go, which can end with a partial
+   // cache line.
+   logic [63:0] direct_bytes;
+   assign direct_bytes = (64'(app.wr_size) << CL_BYTE_INDEX_BITS) -
+			 (app.wr_last_bytes != 0 ? 64'(2**CL_BYTE_INDEX_BITS - app.wr_last_bytes) : 64'd0);
+
+   // The completion record and its address.
+   logic [$size(dma.wr_data)-1:0] cmpl_data;
+   logic [ADDR_WIDTH-1:0] 	  cmpl_addr;
+
+   always_comb begin
+      if (direct_r) begin
+	 cmpl_data = '0;
+	 cmpl_data[0 +: 64] = 64'(job_count) + 1'b1;
+	 cmpl_data[64 +: 64] = STATUS_DONE;
+	 cmpl_data[128 +: 64] = cycles_r;
+	 cmpl_data[192 +: 64] = bytes_r;
+	 cmpl_addr = status_addr;
+      end
+      else begin
+	 cmpl_data = desc_r;
+	 cmpl_data[256 +: 64] = cycles_r;
+	 cmpl_data[320 +: 64] = bytes_r;
+	 cmpl_data[448 +: 64] = STATUS_DONE;
+	 cmpl_addr = slot_addr;
+      end
+   end
+
+   always_ff @(posedge clk or posedge rst) begin
+      if (rst) begin
+	 state_r <= IDLE;
+	 ring_head <= '0;
+	 job_count <= '0;
+	 direct_r <= 1'b0;
+      end
+      else begin
+	 // Count the cycles of the current job.
+	 if (state_r == RUN || state_r == DIRECT || state_r == SG_FETCH_GO ||
+	     state_r == SG_FETCH || state_r == SG_RUN)
+	   cycles_r <= cycles_r + 1'b1;
+
+	 sg_rd_line_valid_r <= state_r == SG_RUN && !sg_rd_go;
+	 sg_wr_line_valid_r <= state_r == SG_RUN && !sg_wr_go;
+	 
+	 case (state_r)
+	   IDLE : begin
+	      // The AFU's go passes through to the HAL in this cycle.
+	      if (start_direct) begin
+		 direct_r <= 1'b1;
+		 cycles_r <= 64'd1;
+		 bytes_r <= direct_bytes;
+		 state_r <= DIRECT;
+	      end
+	      else if (start_desc) begin
+		 direct_r <= 1'b0;
+		 state_r <= FETCH_GO;
+	      end
+	   end
+
+	   // Read the descriptor.
+	   FETCH_GO :
+	     state_r <= FETCH;
+
+	   FETCH :
+	     if (!dma.empty) begin
+		desc_r <= dma.rd_data;
+		state_r <= START;
+	     end
+
+	   // Run the job.
+	   START : begin
+	      cycles_r <= 64'd1;
+	      if (desc_sg) begin
+		 bytes_r <= '0;
+		 sg_side_r <= 1'b0;
+		 sg_fetch_index_r <= '0;
+		 state_r <= SG_FETCH_GO;
+	      end
+	      else begin
+		 bytes_r <= 64'(desc_size) << CL_BYTE_INDEX_BITS;
+		 state_r <= RUN;
+	      end
+	   end
+
+	   // Read the scatter-gather lists, starting with the read list.
+	   SG_FETCH_GO :
+	     state_r <= SG_FETCH;
+
+	   SG_FETCH :
+	     if (!dma.empty) begin
+		sg_fetch_index_r <= sg_fetch_index_r + 1'b1;
+		if (sg_fetch_index_r == sg_fetch_lines - 1'b1) begin
+		   sg_fetch_index_r <= '0;
+		   if (!sg_side_r) begin
+		      sg_side_r <= 1'b1;
+		      state_r <= SG_FETCH_GO;
+		   end
+		   else begin
+		      sg_rd_index_r <= '0;
+		      sg_wr_index_r <= '0;
+		      state_r <= SG_RUN;
+		   end
+		end
+	     end
+
+	   RUN, SG_RUN : begin
+	      if (sg_rd_go) begin
+		 sg_rd_index_r <= sg_rd_index_r + 1'b1;
+		 bytes_r <= bytes_r + (64'(sg_rd_entry[64 +: SIZE_WIDTH]) << CL_BYTE_INDEX_BITS);
+	      end
+
+	      if (sg_wr_go)
+		sg_wr_index_r <= sg_wr_index_r + 1'b1;
+
+	      if (job_done) begin
+		 if (desc_completion) begin
+		    state_r <= CMPL_GO;
+		 end
+		 else begin
+		    ring_head <= ring_head + 1'b1;
+		    state_r <= IDLE;
+		 end
+	      end
+	   end
+
+	   DIRECT :
+	     if (dma.rd_done && dma.wr_done) state_r <= CMPL_GO;
+	     
+	   // Write the completion record (over the descriptor or into the
+	   // status line) after all the job's writes have been committed.
+	   CMPL_GO :
+	     state_r <= CMPL_WRITE;
+
+	   CMPL_WRITE :
+	     if (!dma.full) state_r <= CMPL_WAIT;
+
+	   // The HAL's wr_done isn't cleared until the cycle after the write,
+	   // which is when this state starts.
+	   CMPL_WAIT :
+	     if (dma.wr_done) begin
+		if (direct_r)
+		  job_count <= job_count + 1'b1;
+		else
+		  ring_head <= ring_head + 1'b1;
+		state_r <= IDLE;
+	     end
+	 endcase
+
+	 if (ring_reset) ring_head <= '0;
+	 if (status_reset) job_count <= '0;
+      end
+   end
+
+   // The scatter-gather RAMs.
+   always_ff @(posedge clk) begin
+      if (state_r == SG_FETCH && !dma.empty) begin
+	 if (sg_side_r)
+	   sg_wr_ram[sg_fetch_index_r] <= dma.rd_data;
+	 else
+	   sg_rd_ram[sg_fetch_index_r] <= dma.rd_data;
+      end
+
+      sg_rd_line_r <= sg_rd_ram[sg_rd_index_r / SG_ENTRIES_PER_LINE];
+      sg_wr_line_r <= sg_wr_ram[sg_wr_index_r / SG_ENTRIES_PER_LINE];
+   end
+
+   always_comb begin
+      // By default, pass everything through. Go is only passed through
+      // when the previous transfer is done, so jobs started directly never
+      // overlap.
+      dma.rd_go = app.rd_go && dma.rd_done;
+      dma.rd_addr = app.rd_addr;
+      dma.rd_size = app.rd_size;
+      dma.rd_en = app.rd_en;
+      dma.wr_go = app.wr_go && dma.wr_done;
+      dma.wr_addr = app.wr_addr;
+      dma.wr_size = app.wr_size;
+      dma.wr_en = app.wr_en;
+      dma.wr_avail = app.wr_avail;
+      dma.wr_data = app.wr_data;
+      dma.wr_last_bytes = app.wr_last_bytes;
+      dma.rd_row_size = app.rd_row_size;
+      dma.rd_pitch = app.rd_pitch;
+      dma.wr_row_size = app.wr_row_size;
+      dma.wr_pitch = app.wr_pitch;
+      dma.burst_len = app.burst_len;
+      dma.vc_policy = app.vc_policy;
+      dma.cache_hints = app.cache_hints;
+      dma.perf_clear = app.perf_clear;
+
+      app.rd_data = dma.rd_data;
+      app.empty = dma.empty;
+      app.full = dma.full;
+      app.rd_done = dma.rd_done;
+      app.wr_done = dma.wr_done;
+      app.perf = dma.perf;
+      app.rd_ready = dma.rd_done;
+      app.wr_ready = dma.wr_done;
+
+      if (state_r != IDLE) begin
+	 // Ignore the AFU's go while processing a descriptor, and hide the
+	 // descriptor's data from the AFU.
+	 dma.rd_go = 1'b0;
+	 dma.wr_go = 1'b0;
+	 dma.wr_last_bytes = '0;
+	 dma.rd_row_size = '0;
+	 dma.wr_row_size = '0;
+	 app.rd_done = 1'b0;
+	 app.wr_done = 1'b0;
+	 app.rd_ready = 1'b0;
+	 app.wr_ready = 1'b0;
+
+	 if (state_r == FETCH_GO || state_r == FETCH ||
+	     state_r == SG_FETCH_GO || state_r == SG_FETCH) begin
+	    app.empty = 1'b1;
+	    dma.rd_en = (state_r == FETCH || state_r == SG_FETCH) && !dma.empty;
+	 end
+
+	 if (state_r == CMPL_GO || state_r == CMPL_WRITE) begin
+	    app.full = 1'b1;
+	    dma.wr_en = state_r == CMPL_WRITE && !dma.full;
+	    dma.wr_avail = state_r == CMPL_WRITE;
+	    dma.wr_data = cmpl_data;
+	 end
+
+	 case (state_r)
+	   FETCH_GO : begin
+	      dma.rd_go = 1'b1;
+	      dma.rd_addr = slot_addr;
+	      dma.rd_size = SIZE_WIDTH'(1);
+	   end
+
+	   START : begin
+	      dma.rd_go = !desc_sg;
+	      dma.rd_addr = desc_rd_addr;
+	      dma.rd_size = desc_size;
+	      dma.wr_go = !desc_sg;
+	      dma.wr_addr = desc_wr_addr;
+	      dma.wr_size = desc_size;
+	   end
+
+	   SG_FETCH_GO : begin
+	      dma.rd_go = 1'b1;
+	      dma.rd_addr = sg_side_r ? desc_wr_addr : desc_rd_addr;
+	      dma.rd_size = SIZE_WIDTH'(sg_fetch_lines);
+	   end
+
+	   SG_RUN : begin
+	      dma.rd_go = sg_rd_go;
+	      dma.rd_addr = sg_rd_entry[0 +: ADDR_WIDTH];
+	      dma.rd_size = sg_rd_entry[64 +: SIZE_WIDTH];
+	      dma.wr_go = sg_wr_go;
+	      dma.wr_addr = sg_wr_entry[0 +: ADDR_WIDTH];
+	      dma.wr_size = sg_wr_entry[64 +: SIZE_WIDTH];
+	   end
+
+	   CMPL_GO : begin
+	      dma.wr_go = 1'b1;
+	      dma.wr_addr = cmpl_addr;
+	      dma.wr_size = SIZE_WIDTH'(1);
+	   end
+
+	   default : ;
+	 endcase
+      end
+   end
+
+endmodule
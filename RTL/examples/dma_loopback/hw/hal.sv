@@ -30,6 +30,10 @@
 //                   used by the AFU within the HAL.
 // MMIO_END_ADDR : The 32-bit word ending address of the MMIO addresses
 //                   used by the AFU within the HAL.
+// NUM_DMA_CHANNELS : The number of independent DMA channels provided to the
+//                    AFU, which share CCI-P through cci_dma_arbiter.sv.
+// REORDER_READS : Set when MPF doesn't sort read responses, in which case
+//                 each DMA channel reorders the responses (see cci_dma.sv).
 //===================================================================
 
 //===================================================================
@@ -47,7 +51,9 @@
 module hal
   #(
     parameter int MMIO_START_ADDR,
-    parameter int MMIO_END_ADDR
+    parameter int MMIO_END_ADDR,
+    parameter int NUM_DMA_CHANNELS=1,
+    parameter bit REORDER_READS=0
     )   
    (
     input logic clk,
@@ -63,13 +69,13 @@ module hal
    localparam int MMIO_ADDR_WIDTH         = 16;
    localparam int VIRTUAL_BYTE_ADDR_WIDTH = 64;
    
-   // Instantiate the DMA interface signals.
+   // Instantiate the DMA interface signals for each channel.
    dma_if 
      #(
        .DATA_WIDTH($size(t_ccip_clData)),
        .ADDR_WIDTH(VIRTUAL_BYTE_ADDR_WIDTH),
        .SIZE_WIDTH($size(t_ccip_clAddr)+1)
-       ) dma();
+       ) dma[NUM_DMA_CHANNELS]();
 
    // Instantiate the MMIO interface signals.
    // TODO: Replace hardcoded values with $size of CCI signals.
@@ -81,29 +87,71 @@ module hal
        .END_ADDR(MMIO_END_ADDR)
        ) mmio();
 
-   // Convert the DMA interface into CCI-P
-   cci_dma dma_ctrl
+   // The CCI signals of each DMA channel.
+   localparam int TAG_BITS = $clog2(NUM_DMA_CHANNELS);
+   t_if_cci_mpf_c0_Tx ch_c0Tx[NUM_DMA_CHANNELS];
+   t_if_cci_mpf_c1_Tx ch_c1Tx[NUM_DMA_CHANNELS];
+   t_if_cci_c0_Rx ch_c0Rx[NUM_DMA_CHANNELS];
+   logic [NUM_DMA_CHANNELS-1:0] ch_c0TxReq, ch_c0TxAlmFull;
+   logic [NUM_DMA_CHANNELS-1:0] ch_c1TxReq, ch_c1TxLock, ch_c1TxAlmFull, ch_c1TxArbStall;
+
+   // Convert each DMA interface into CCI-P.
+   // NOTE: c1Empty is shared by all channels, so the writes of a channel
+   // aren't done until the writes of every channel have been committed.
+   genvar i;
+   generate
+      for (i=0; i < NUM_DMA_CHANNELS; i++) begin : channels
+	 cci_dma
+	   #(
+	     .MDATA_TAG_BITS(TAG_BITS),
+	     .REORDER_READS(REORDER_READS)
+	     )
+	 dma_ctrl
+	   (
+	    .clk(clk),
+	    .rst(rst),
+
+	    // This module originally just passed CCI, but Quartus was reporting
+	    // errors about multiple drivers because the hal module was modifying
+	    // the c2Tx signals. Although technical no signal within CCI had
+	    // multiple drivers, Quartus apparently treats the entire interface
+	    // a single signal, so any two modules that assign values to the same
+	    // interface are seen as multiple drivers. I'm not sure if this
+	    // behavior is defined by the SV standard, or if tool specific. 
+	    //.cci(cci),   
+	    .c0Tx(ch_c0Tx[i]),
+	    .c0TxAlmFull(ch_c0TxAlmFull[i]),
+	    .c0TxReq(ch_c0TxReq[i]),
+	    .c1Tx(ch_c1Tx[i]),
+	    .c1TxAlmFull(ch_c1TxAlmFull[i]),
+	    .c1TxArbStall(ch_c1TxArbStall[i]),
+	    .c1TxReq(ch_c1TxReq[i]),
+	    .c1TxLock(ch_c1TxLock[i]),
+	    .c0Rx(ch_c0Rx[i]),
+	    
+	    .dma(dma[i]),
+	    .c0Empty,
+	    .c1Empty
+	    );
+      end
+   endgenerate
+
+   // Share the CCI request channels between the DMA channels.
+   cci_dma_arbiter
+     #(
+       .NUM_CHANNELS(NUM_DMA_CHANNELS),
+       .TAG_BITS(TAG_BITS)
+       )
+   dma_arbiter
      (
       .clk(clk),
       .rst(rst),
-
-      // This module originally just passed CCI, but Quartus was reporting
-      // errors about multiple drivers because the hal module was modifying
-      // the c2Tx signals. Although technical no signal within CCI had multiple
-      // drivers, Quartus apparently treats the entire interface a single
-      // signal, so any two modules that assign values to the same interface
-      // are seen as multiple drivers. I'm not sure if this behavior is
-      // defined by the SV standard, or if tool specific. 
-      //.cci(cci),   
       .c0Tx(cci.c0Tx),
       .c0TxAlmFull(cci.c0TxAlmFull),
       .c1Tx(cci.c1Tx),
       .c1TxAlmFull(cci.c1TxAlmFull),
       .c0Rx(cci.c0Rx),
-      
-      .dma(dma),
-      .c0Empty,
-      .c1Empty
+      .*
       );
          
    //===================================================================
@@ -138,12 +186,16 @@ module hal
    // Instantiate the AFU with the simplified HAL protocol
    // In this case, the AFU has a DMA interface for accessing CPU RAM,
    // in addition to an MMIO interface for normal MMIO communication.
-   afu afu
+   afu
+     #(
+       .NUM_DMA_CHANNELS(NUM_DMA_CHANNELS)
+       )
+   afu
      (
       .clk(clk),
       .rst(rst),
       .mmio(mmio),
-      .dma(dma.peripheral)
+      .dma(dma)
       );
 
 endmodule
@@ -0,0 +1,124 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+
+// Module Name:  job_queue.sv
+// Description:  This module implements a small queue of DMA jobs, which
+//               allows software to post the next jobs while the current job
+//               is still running. Each push adds a copy of the job registers
+//               (a shadow register set) to a FIFO. The job at the front of
+//               the FIFO is started (go) as soon as the DMA is ready for a
+//               new job, which occurs when the previous job is done.
+//
+//               Pushes while the queue is full are ignored, so software must
+//               check count before posting a job.
+//
+//               The DMA's ready and done signals are only updated the cycle
+//               after a go, so the queue waits one cycle after each go
+//               before checking them again.
+
+//==========================================================================
+// Parameter Description
+// WIDTH : the number of bits in each job
+// DEPTH : the number of jobs that can wait in the queue
+//==========================================================================
+
+//==========================================================================
+// Interface Description (All control signals are active high)
+// clk       : clk
+// rst       : rst (asynchronous)
+// push      : adds push_job to the queue
+// push_job  : the job registers of the posted job
+// job       : the job registers of the next job, which are valid with go
+// go        : starts job on the DMA
+// ready     : asserted when the DMA can start a new job
+// dma_done  : asserted when the DMA has completed all jobs
+// count     : the number of jobs waiting in the queue
+// completed : the number of jobs completed since reset (wraps around)
+// done      : asserted when the queue is empty and all jobs are complete
+//==========================================================================
+
+module job_queue
+  #(
+    parameter int WIDTH,
+    parameter int DEPTH=8
+    )
+   (
+    input logic 		   clk,
+    input logic 		   rst,
+    input logic 		   push,
+    input logic [WIDTH-1:0] 	   push_job,
+    output logic [WIDTH-1:0] 	   job,
+    output logic 		   go,
+    input logic 		   ready,
+    input logic 		   dma_done,
+    output logic [$clog2(DEPTH):0] count,
+    output logic [31:0] 	   completed,
+    output logic 		   done
+    );
+
+   logic 			   empty;
+   logic 			   go_r;
+   logic 			   active_r;
+
+   fifo
+     #(
+       .WIDTH(WIDTH),
+       .DEPTH(DEPTH)
+       )
+   jobs
+     (
+      .clk(clk),
+      .rst(rst),
+      .rd_en(go),
+      .wr_en(push),
+      .empty(empty),
+      .full(),
+      .almost_full(),
+      .count(count),
+      .space(),
+      .wr_data(push_job),
+      .rd_data(job)
+      );
+
+   // Start the next job when the DMA is ready, except in the cycle after a
+   // go, when ready hasn't been updated yet.
+   assign go = !empty && ready && !go_r;
+
+   always_ff @(posedge clk or posedge rst) begin
+      if (rst) begin
+	 go_r <= 1'b0;
+	 active_r <= 1'b0;
+	 completed <= '0;
+      end
+      else begin
+	 go_r <= go;
+
+	 // A job is complete when the DMA is done after its go.
+	 if (active_r && dma_done && !go_r) begin
+	    completed <= completed + 1'b1;
+	    active_r <= 1'b0;
+	 end
+
+	 if (go)
+	   active_r <= 1'b1;
+      end
+   end
+
+   assign done = empty && !active_r && !go_r;
+
+endmodule
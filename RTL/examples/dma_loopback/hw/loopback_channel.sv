@@ -0,0 +1,239 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+
+// Module Name:  loopback_channel.sv
+// Project:      dma_loopback
+// Description:  This module implements the loopback on a single DMA
+//               channel, along with the channel's memory map, job queue,
+//               descriptor ring, and CRCs. See afu.sv for a description of
+//               the behavior.
+
+//===================================================================
+// Interface Description
+// clk  : Clock input
+// rst  : Reset input (active high)
+// mmio : Memory-mapped I/O interface for the channel's registers.
+// dma  : DMA interface of the channel.
+//===================================================================
+
+`include "cci_mpf_if.vh"
+
+module loopback_channel
+  (
+   input clk,
+   input rst,
+	 mmio_if.user mmio,
+	 dma_if.peripheral dma
+   );
+
+   localparam int CL_ADDR_WIDTH = $size(t_ccip_clAddr);
+      
+   // I want to just use dma.count_t, but apparently
+   // either SV or Modelsim doesn't support that. Similarly, I can't
+   // just do dma.SIZE_WIDTH without getting errors or warnings about
+   // "constant expression cannot contain a hierarchical identifier" in
+   // some tools. Declaring a function within the interface works just fine in
+   // some tools, but in Quartus I get an error about too many ports in the
+   // module instantiation.
+   typedef logic [CL_ADDR_WIDTH:0] count_t;   
+   count_t 	size;
+   logic [5:0] 	last_bytes;
+   logic 	go;
+   logic 	done;
+   logic [31:0] rd_crc, wr_crc;
+   logic [2:0] 	burst_len;
+   logic [2:0]  vc_policy;
+   logic [1:0]  cache_hints;
+   count_t      rd_row_size, rd_pitch;
+   count_t      wr_row_size, wr_pitch;
+   logic 	crc_clear;
+   logic [63:0] ring_addr;
+   logic [31:0] ring_entries, ring_tail, ring_head;
+   logic 	ring_reset;
+   logic [63:0] status_addr;
+   logic 	status_reset;
+   logic [31:0] job_count;
+   logic [12:0][63:0] perf;
+   logic [31:0] queue_count, queue_depth, jobs_completed;
+
+   // Number of jobs started by go that can wait for the running job.
+   localparam int JOB_QUEUE_DEPTH = 8;
+
+   // Software provides 64-bit virtual byte addresses.
+   // Again, this constant would ideally get read from the DMA interface if
+   // there was widespread tool support.
+   localparam int VIRTUAL_BYTE_ADDR_WIDTH = 64;
+   logic [VIRTUAL_BYTE_ADDR_WIDTH-1:0] rd_addr, wr_addr;
+
+   // Instantiate the memory map, which provides the starting read/write
+   // 64-bit virtual byte addresses, a transfer size (in cache lines), and a
+   // go signal. It also sends a done signal back to software.
+   memory_map
+     #(
+       .ADDR_WIDTH(VIRTUAL_BYTE_ADDR_WIDTH),
+       .SIZE_WIDTH(CL_ADDR_WIDTH+1)
+       )
+     memory_map (.*);
+
+   // The AFU accesses the DMA through the descriptor ring (see dma_ring.sv),
+   // which runs jobs queued by software in host memory, and otherwise
+   // passes through the jobs started by go.
+   dma_if
+     #(
+       .DATA_WIDTH($size(t_ccip_clData)),
+       .ADDR_WIDTH(VIRTUAL_BYTE_ADDR_WIDTH),
+       .SIZE_WIDTH(CL_ADDR_WIDTH+1)
+       ) app_dma();
+
+   dma_ring
+     #(
+       .ADDR_WIDTH(VIRTUAL_BYTE_ADDR_WIDTH),
+       .SIZE_WIDTH(CL_ADDR_WIDTH+1)
+       )
+   dma_ring
+     (
+      .app(app_dma.mem),
+      .*
+      );
+
+   // The registers of a job started by go. Each go posts a copy of the
+   // registers to the job queue, so software can program the next job
+   // while the current job is running.
+   typedef struct packed {
+      logic [VIRTUAL_BYTE_ADDR_WIDTH-1:0] rd_addr, wr_addr;
+      count_t size;
+      logic [5:0] last_bytes;
+      count_t rd_row_size, rd_pitch, wr_row_size, wr_pitch;
+   } job_t;
+
+   job_t posted_job, job;
+   logic job_go;
+   logic [$clog2(JOB_QUEUE_DEPTH):0] queued_jobs;
+
+   assign posted_job = '{rd_addr, wr_addr, size, last_bytes,
+			 rd_row_size, rd_pitch, wr_row_size, wr_pitch};
+
+   // Start each queued job once the previous job is done.
+   job_queue
+     #(
+       .WIDTH($bits(job_t)),
+       .DEPTH(JOB_QUEUE_DEPTH)
+       )
+   job_queue
+     (
+      .clk,
+      .rst,
+      .push(go),
+      .push_job(posted_job),
+      .job(job),
+      .go(job_go),
+      .ready(app_dma.rd_ready && app_dma.wr_ready),
+      .dma_done(app_dma.wr_done),
+      .count(queued_jobs),
+      .completed(jobs_completed),
+      .done(done)
+      );
+
+   assign queue_count = 32'(queued_jobs);
+   assign queue_depth = 32'(JOB_QUEUE_DEPTH);
+
+   // Assign the starting addresses from the queued job.
+   assign app_dma.rd_addr = job.rd_addr;
+   assign app_dma.wr_addr = job.wr_addr;
+   
+   // Use the size (# of cache lines) specified by software.
+   assign app_dma.rd_size = job.size;
+   assign app_dma.wr_size = job.size;
+
+   // The last cache line is only partially written when software specifies
+   // the size in bytes. The rest of the line is read and discarded.
+   assign app_dma.wr_last_bytes = job.last_bytes;
+
+   // Use the 2D shapes specified by software, which default to a single
+   // contiguous range.
+   assign app_dma.rd_row_size = job.rd_row_size;
+   assign app_dma.rd_pitch = job.rd_pitch;
+   assign app_dma.wr_row_size = job.wr_row_size;
+   assign app_dma.wr_pitch = job.wr_pitch;
+
+   // Use the maximum burst length specified by software.
+   assign app_dma.burst_len = burst_len;
+
+   // Use the virtual channel policy and cache hints specified by software.
+   assign app_dma.vc_policy = vc_policy;
+   assign app_dma.cache_hints = cache_hints;
+
+   // The DMA performance counters are cleared along with the CRCs, so they
+   // cover the same job.
+   assign perf = app_dma.perf;
+   assign app_dma.perf_clear = crc_clear;
+
+   // Start both the read and write channels when the job queue starts a
+   // job. Note that writes don't actually occur until app_dma.wr_en is
+   // asserted.
+   assign app_dma.rd_go = job_go;
+   assign app_dma.wr_go = job_go;
+
+   // Read from the DMA when there is data available (!app_dma.empty) and when
+   // it is safe to write data (!app_dma.full).
+   assign app_dma.rd_en = !app_dma.empty && !app_dma.full;
+
+   // Since this is a simple loopback, write to the DMA anytime we read.
+   // For most applications, write enable would be asserted when there is an
+   // output from a pipeline. In this case, the "pipeline" is a wire.
+   assign app_dma.wr_en = app_dma.rd_en;
+
+   // There is data to write whenever there is read data, regardless of
+   // app_dma.full.
+   assign app_dma.wr_avail = !app_dma.empty;
+
+   // Write the data that is read.
+   assign app_dma.wr_data = app_dma.rd_data;
+
+   // The AFU is done when the DMA is done writing size cache lines of every
+   // queued job, which is provided by the job queue.
+
+   // Compute CRCs of the read and written data, so software can verify a
+   // transfer without reading the input and output arrays again. The CRCs
+   // are updated a few cycles after the data, which always completes before
+   // software can read done and then the CRCs.
+   crc32c rd_crc32c
+     (
+      .clk,
+      .rst,
+      .clear(crc_clear),
+      .valid(app_dma.rd_en),
+      .data(app_dma.rd_data),
+      .crc(rd_crc)
+      );
+
+   crc32c wr_crc32c
+     (
+      .clk,
+      .rst,
+      .clear(crc_clear),
+      .valid(app_dma.wr_en),
+      .data(app_dma.wr_data),
+      .crc(wr_crc)
+      );
+            
+endmodule
+
+
+
+
@@ -27,18 +27,72 @@
 //               Addresses still must follow all rules for CCI-P, which requires
 //               even addresses for 64-bit data.
 //
-//               The memory map provides 4 inputs to the circuit:
+//               The memory map provides 16 inputs to the circuit:
 //               go      : h0050,
 //               rd_addr : h0052,
 //               wr_addr : h0054,
-//               size    : h0056
+//               size    : h0056,
+//               bytes   : h0070,
+//               burst_len : h005E
+//               vc_policy : h0098
+//               cache_hints : h009A
+//               rd_row_size : h009C
+//               rd_pitch : h009E
+//               wr_row_size : h00A0
+//               wr_pitch : h00A2
+//               ring_addr : h0060
+//               ring_entries : h0062
+//               ring_tail : h0064
+//               status_addr : h006C
 //
-//               and provides one output to software:
+//               and provides 20 outputs to software:
 //               done    : h0058
+//               rd_crc  : h005A
+//               wr_crc  : h005C
+//               ring_head : h0066
+//               job_count : h006E
+//               perf    : h0080-h0096, h00A8
+//               job_queue : h00A4
+//               jobs_completed : h00A6
 //
 //               rd_addr and wr_addr are both 64-bit virtual byte addresses.
 //               size is the number of cache lines to transfer
+//               bytes is an alternative to size for transfers that don't end
+//               on a cache line. Writing bytes sets size to the number of
+//               cache lines containing the bytes, and last_bytes to the number
+//               of bytes in the last cache line (0 for an entire line).
+//               Writing size sets last_bytes to 0.
+//               burst_len is the maximum cache lines per memory request (1, 2,
+//               or 4), which defaults to 1.
+//               vc_policy and cache_hints select the CCI-P virtual channel
+//               and the cache hints of the memory requests (see dma_if.vh).
+//               Both default to 0 (eVC_VA, RDLINE_I, and WRLINE_I).
+//               rd_row_size, rd_pitch, wr_row_size, and wr_pitch describe
+//               2D transfers in cache lines (see dma_if.vh). A row size of 0,
+//               which is the default, transfers one contiguous range.
 //               go starts the AFU and done signals completion.
+//               rd_crc and wr_crc are the CRC-32C of all data read from and
+//               written to the DMA. Writing any value to h005A clears both
+//               CRCs. The CRCs are not cleared by go, so a job split into
+//               several transfers produces a single CRC.
+//               ring_addr, ring_entries, ring_tail, and ring_head control the
+//               descriptor ring (see dma_ring.sv). Writing ring_addr resets
+//               ring_tail and ring_head. Writing ring_tail is the doorbell.
+//               status_addr is the address of the status line written after
+//               each job started by go (0 disables), and job_count is the
+//               number of status lines written. Writing status_addr resets
+//               job_count.
+//               perf contains the 13 DMA performance counters (see dma_if.vh).
+//               The first 12 are at consecutive 64-bit addresses, and the
+//               last is at h00A8. Writing h005A also clears the counters, so
+//               they cover the same job as the CRCs.
+//               go posts the job registers to a job queue (see job_queue.sv),
+//               so software can program the next job while the previous job
+//               is running. done is only asserted when every queued job is
+//               complete. job_queue contains the number of jobs waiting in
+//               the queue (bits 31:0) and the queue's capacity (bits 63:32),
+//               and jobs_completed is the number of jobs completed since
+//               reset.
 
 //==========================================================================
 // Parameter Description
@@ -58,8 +112,32 @@
 // rd_addr : the starting read address for the DMA transfer
 // wr_addr : the starting write address for the DMA transfer
 // size    : the number of cachelines to transfer
+// last_bytes : the number of bytes to write from the last cacheline (0 for
+//              the entire cacheline)
+// burst_len : the maximum number of cachelines per memory request
+// vc_policy : the virtual channel policy of the memory requests
+// cache_hints : the cache hints of the memory reads ([0]) and writes ([1])
+// rd_row_size : the cache lines in each row of a 2D read (0 for 1D)
+// rd_pitch : the cache lines between the starts of the rows of a 2D read
+// wr_row_size : the cache lines in each row of a 2D write (0 for 1D)
+// wr_pitch : the cache lines between the starts of the rows of a 2D write
 // go      : starts the DMA transfer
 // done    : Asserted when the DMA transfer is complete
+// rd_crc  : CRC-32C of the data read from the DMA
+// wr_crc  : CRC-32C of the data written to the DMA
+// crc_clear : clears rd_crc and wr_crc
+// ring_addr : starting address of the descriptor ring
+// ring_entries : number of entries in the descriptor ring
+// ring_tail : number of descriptors queued by software
+// ring_reset : asserted when a new ring is configured
+// ring_head : number of descriptors completed by the AFU
+// status_addr : address of the status line
+// status_reset : asserted when a new status_addr is written
+// job_count : number of status lines written
+// perf    : DMA performance counters
+// queue_count : number of jobs waiting in the job queue
+// queue_depth : capacity of the job queue
+// jobs_completed : number of queued jobs completed since reset
 //==========================================================================
 
 module memory_map
@@ -75,8 +153,26 @@ module memory_map
    
    output logic [ADDR_WIDTH-1:0] rd_addr, wr_addr,
    output logic [SIZE_WIDTH-1:0] size,
+   output logic [5:0]  last_bytes,
+   output logic [2:0]  burst_len,
+   output logic [2:0]  vc_policy,
+   output logic [1:0]  cache_hints,
+   output logic [SIZE_WIDTH-1:0] rd_row_size, rd_pitch,
+   output logic [SIZE_WIDTH-1:0] wr_row_size, wr_pitch,
    output logic        go,
-   input logic 	       done   
+   input logic 	       done,
+   input logic [31:0]  rd_crc, wr_crc,
+   output logic        crc_clear,
+   output logic [63:0] ring_addr,
+   output logic [31:0] ring_entries, ring_tail,
+   output logic        ring_reset,
+   input logic [31:0]  ring_head,
+   output logic [63:0] status_addr,
+   output logic        status_reset,
+   input logic [31:0]  job_count,
+   input logic [12:0][63:0] perf,
+   input logic [31:0]  queue_count, queue_depth,
+   input logic [31:0]  jobs_completed
    );
 
    // =============================================================//   
@@ -85,19 +181,63 @@ module memory_map
    always_ff @(posedge clk or posedge rst) begin 
       if (rst) begin
 	 go       <= '0;
+	 crc_clear <= '0;
 	 rd_addr  <= '0;
 	 wr_addr  <= '0;	     
 	 size     <= '0;
+	 last_bytes <= '0;
+	 burst_len <= 3'd1;
+	 vc_policy <= '0;
+	 cache_hints <= '0;
+	 rd_row_size <= '0;
+	 rd_pitch <= '0;
+	 wr_row_size <= '0;
+	 wr_pitch <= '0;
+	 ring_addr <= '0;
+	 ring_entries <= '0;
+	 ring_tail <= '0;
+	 ring_reset <= '0;
+	 status_addr <= '0;
+	 status_reset <= '0;
       end
       else begin
 	 go <= '0;
+	 crc_clear <= '0;
+	 ring_reset <= '0;
+	 status_reset <= '0;
  	 	 	 
          if (mmio.wr_en == 1'b1) begin
             case (mmio.wr_addr)
               16'h0050: go       <= mmio.wr_data[0];
 	      16'h0052: rd_addr  <= mmio.wr_data[$size(rd_addr)-1:0];
 	      16'h0054: wr_addr  <= mmio.wr_data[$size(wr_addr)-1:0];
-	      16'h0056: size     <= mmio.wr_data[$size(size)-1:0];
+	      16'h0056: begin
+		 size       <= mmio.wr_data[$size(size)-1:0];
+		 last_bytes <= '0;
+	      end
+	      16'h005A: crc_clear <= 1'b1;
+	      16'h005E: burst_len <= mmio.wr_data[$size(burst_len)-1:0];
+	      16'h0060: begin
+		 ring_addr  <= mmio.wr_data[$size(ring_addr)-1:0];
+		 ring_tail  <= '0;
+		 ring_reset <= 1'b1;
+	      end
+	      16'h0062: ring_entries <= mmio.wr_data[$size(ring_entries)-1:0];
+	      16'h0064: ring_tail <= mmio.wr_data[$size(ring_tail)-1:0];
+	      16'h006C: begin
+		 status_addr  <= mmio.wr_data[$size(status_addr)-1:0];
+		 status_reset <= 1'b1;
+	      end
+	      16'h0070: begin
+		 size       <= SIZE_WIDTH'((mmio.wr_data + 63) >> 6);
+		 last_bytes <= mmio.wr_data[5:0];
+	      end
+	      16'h0098: vc_policy <= mmio.wr_data[$size(vc_policy)-1:0];
+	      16'h009A: cache_hints <= mmio.wr_data[$size(cache_hints)-1:0];
+	      16'h009C: rd_row_size <= mmio.wr_data[$size(rd_row_size)-1:0];
+	      16'h009E: rd_pitch <= mmio.wr_data[$size(rd_pitch)-1:0];
+	      16'h00A0: wr_row_size <= mmio.wr_data[$size(wr_row_size)-1:0];
+	      16'h00A2: wr_pitch <= mmio.wr_data[$size(wr_pitch)-1:0];
             endcase
          end
       end
@@ -121,6 +261,38 @@ module memory_map
 	      16'h0054: mmio.rd_data[$size(wr_addr)-1:0] <= wr_addr;
 	      16'h0056: mmio.rd_data[$size(size)-1:0] <= size;     	     
 	      16'h0058: mmio.rd_data[0] <= done;
+	      16'h005A: mmio.rd_data[$size(rd_crc)-1:0] <= rd_crc;
+	      16'h005C: mmio.rd_data[$size(wr_crc)-1:0] <= wr_crc;
+	      16'h005E: mmio.rd_data[$size(burst_len)-1:0] <= burst_len;
+	      16'h0060: mmio.rd_data[$size(ring_addr)-1:0] <= ring_addr;
+	      16'h0062: mmio.rd_data[$size(ring_entries)-1:0] <= ring_entries;
+	      16'h0064: mmio.rd_data[$size(ring_tail)-1:0] <= ring_tail;
+	      16'h0066: mmio.rd_data[$size(ring_head)-1:0] <= ring_head;
+	      16'h006C: mmio.rd_data[$size(status_addr)-1:0] <= status_addr;
+	      16'h006E: mmio.rd_data[$size(job_count)-1:0] <= job_count;
+	      16'h0070: mmio.rd_data <= (64'(size) << 6) - (last_bytes != 0 ? 64'(7'd64 - last_bytes) : 64'd0);
+	      
+	      16'h0080: mmio.rd_data <= perf[0];
+	      16'h0082: mmio.rd_data <= perf[1];
+	      16'h0084: mmio.rd_data <= perf[2];
+	      16'h0086: mmio.rd_data <= perf[3];
+	      16'h0088: mmio.rd_data <= perf[4];
+	      16'h008A: mmio.rd_data <= perf[5];
+	      16'h008C: mmio.rd_data <= perf[6];
+	      16'h008E: mmio.rd_data <= perf[7];
+	      16'h0090: mmio.rd_data <= perf[8];
+	      16'h0092: mmio.rd_data <= perf[9];
+	      16'h0094: mmio.rd_data <= perf[10];
+	      16'h0096: mmio.rd_data <= perf[11];
+	      16'h0098: mmio.rd_data[$size(vc_policy)-1:0] <= vc_policy;
+	      16'h009A: mmio.rd_data[$size(cache_hints)-1:0] <= cache_hints;
+	      16'h009C: mmio.rd_data[$size(rd_row_size)-1:0] <= rd_row_size;
+	      16'h009E: mmio.rd_data[$size(rd_pitch)-1:0] <= rd_pitch;
+	      16'h00A0: mmio.rd_data[$size(wr_row_size)-1:0] <= wr_row_size;
+	      16'h00A2: mmio.rd_data[$size(wr_pitch)-1:0] <= wr_pitch;
+	      16'h00A4: mmio.rd_data <= {queue_depth, queue_count};
+	      16'h00A6: mmio.rd_data[$size(jobs_completed)-1:0] <= jobs_completed;
+	      16'h00A8: mmio.rd_data <= perf[12];
 	      
 	      // If the processor requests an address that is unused, return 0.
               default:  mmio.rd_data <= 64'h0;
@@ -0,0 +1,126 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+
+// Module Name:  reorder_buffer.sv
+// Description:  This module implements a reorder buffer that returns data in
+//               the order that slots were allocated, regardless of the order
+//               in which the slots were written. Slots are allocated in
+//               order from a circular buffer (alloc_en), which returns the
+//               first allocated slot (alloc_slot). The slot is sent with a
+//               request, and the response is later written into the slot
+//               (wr_en). The read port behaves like fifo.sv: the data of the
+//               oldest slot is available on rd_data in the same cycle that
+//               empty is cleared, which only happens once that slot has been
+//               written. A slot is freed when it is read.
+//
+// Notes: The caller is responsible for not allocating more slots than
+//        space, and for only writing allocated slots.
+
+//==========================================================================
+// Parameter Description
+// WIDTH : the width of each slot in bits
+// DEPTH : the number of slots (must be a power of 2)
+//==========================================================================
+
+//==========================================================================
+// Interface Description (all control inputs are active high)
+// clk         : clock
+// rst         : reset (asynchronous)
+// alloc_en    : allocates alloc_count slots
+// alloc_count : the number of slots to allocate
+// alloc_slot  : the first slot allocated by the next alloc_en
+// space       : the number of slots that aren't allocated
+// wr_en       : write enable
+// wr_slot     : the slot to write
+// wr_data     : the data to write into wr_slot
+// rd_en       : read enable, acts like a read acknowledgement since data
+//               is already available on rd_data when !empty.
+// empty       : asserted when the oldest allocated slot hasn't been written
+// rd_data     : the data of the oldest allocated slot, available in the
+//               same cycle that empty is cleared.
+//==========================================================================
+
+module reorder_buffer #(parameter int WIDTH,
+			parameter int DEPTH)
+   (
+    input logic 		     clk,
+    input logic 		     rst,
+    input logic 		     alloc_en,
+    input logic [$clog2(DEPTH):0]    alloc_count,
+    output logic [$clog2(DEPTH)-1:0] alloc_slot,
+    output logic [$clog2(DEPTH):0]   space,
+    input logic 		     wr_en,
+    input logic [$clog2(DEPTH)-1:0]  wr_slot,
+    input [WIDTH-1:0] 		     wr_data,
+    input logic 		     rd_en,
+    output logic 		     empty,
+    output logic [WIDTH-1:0] 	     rd_data
+    );
+
+   localparam ADDR_WIDTH = $clog2(DEPTH);
+
+   logic [WIDTH-1:0] 		     mem [2**ADDR_WIDTH];
+   logic [2**ADDR_WIDTH-1:0] 	     written_r;
+   logic [ADDR_WIDTH-1:0] 	     head_r, tail_r, rd_addr_adjusted;
+   logic [ADDR_WIDTH:0] 	     space_r;
+   logic 			     valid_rd;
+
+   // Create a block RAM for the slots. Like fifo.sv, this provides the new
+   // data when a write occurs to the read address.
+   always @ (posedge clk) begin
+      if (wr_en) begin
+         mem[wr_slot] = wr_data;
+      end
+
+      rd_data = mem[rd_addr_adjusted];
+   end
+
+   // Prefetch the next slot on a valid read.
+   assign rd_addr_adjusted = (valid_rd == 1'b0) ? head_r : head_r+1'b1;
+
+   // The oldest slot can't be read until its response has been written.
+   assign empty = !written_r[head_r];
+   assign valid_rd = rd_en && !empty;
+
+   always_ff @ (posedge clk or posedge rst) begin
+      if (rst) begin
+	 head_r    <= '0;
+	 tail_r    <= '0;
+	 written_r <= '0;
+	 space_r   <= (ADDR_WIDTH+1)'(DEPTH);
+      end
+      else begin
+	 if (valid_rd) begin
+	    written_r[head_r] <= 1'b0;
+	    head_r <= head_r + 1'b1;
+	 end
+
+	 if (wr_en)
+	   written_r[wr_slot] <= 1'b1;
+
+	 if (alloc_en)
+	   tail_r <= tail_r + ADDR_WIDTH'(alloc_count);
+
+	 space_r <= space_r - (alloc_en ? alloc_count : '0) + (valid_rd ? 1'b1 : 1'b0);
+      end
+   end
+
+   assign alloc_slot = tail_r;
+   assign space = space_r;
+
+endmodule
@@ -16,11 +16,20 @@
 // Greg Stitt
 // University of Florida
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <sys/mman.h>
+
 #include <opae/mmio.h>
 #include <opae/properties.h>
 //#include <opae/mpf/shim_vtp.h>
 
 #include "AFU.h"
+// Contains the MMIO addresses of the DMA registers.
+#include "config.h"
 
 using namespace std;
 using namespace opae::fpga::types;
@@ -41,6 +50,10 @@ AFU::AFU(handle::ptr_t fpga_handle) : fpga_(fpga_handle) {
 
   if (!mpfVtpIsAvailable(*mpf_))
     throw runtime_error("ERROR: VTP not available in MPF.");
+
+  enableStatus();
+  enableByteSizes();
+  enableJobQueue();
 }
 
 
@@ -53,6 +66,26 @@ AFU::AFU(const char* uuid) : fpga_(requestAfu(uuid)) {
 
   if (!mpfVtpIsAvailable(*mpf_))
     throw runtime_error("ERROR: VTP not available in MPF.");
+
+  enableStatus();
+  enableByteSizes();
+  enableJobQueue();
+}
+
+
+AFU::AFU(const AFU &afu, unsigned channel) : fpga_(afu.fpga_), mpf_(afu.mpf_), mmio_offset_(channel * MMIO_CHANNEL_WORDS), owns_handles_(false) {
+
+  // Channels that don't exist return 0 for every register.
+  if (channel >= MAX_DMA_CHANNELS)
+    throw runtime_error("ERROR: DMA channel " + to_string(channel) + " not available.");
+
+  write(reg(MMIO_RD_ADDR), CL_BYTES);
+  if (read(reg(MMIO_RD_ADDR)) != CL_BYTES)
+    throw runtime_error("ERROR: DMA channel " + to_string(channel) + " not available.");
+
+  enableStatus();
+  enableByteSizes();
+  enableJobQueue();
 }
 
 
@@ -64,14 +97,24 @@ AFU::~AFU() {
   //for (shared_buffer::ptr_t i : buffers_) 
   //  i->release();
 
+  // Unpin any registered buffers that the user didn't unregister.
+  for (auto &i : buffer_map_) {
+    for (void* pin : i.second.pins)
+      mpfVtpReleaseBuffer(*mpf_, pin);
+  }
+
   // Clear the map of shared buffer pointers. This should trigger
   // the destructors and free the corresponding memory.
   // NOTE: mpf->close() seg faults unless the
   // buffer_map is cleared first.  
   buffer_map_.clear();
 
-  mpf_->close();
-  fpga_->close();
+  // Channel objects share the handles of the AFU object they were
+  // created from, which closes them.
+  if (owns_handles_) {
+    mpf_->close();
+    fpga_->close();
+  }
 }
 
 
@@ -109,6 +152,21 @@ handle::ptr_t AFU::requestAfu(const char* uuid) {
 void AFU::reset() {
 
   fpga_->reset();
+
+  // The reset clears the AFU's registers, including any outstanding jobs.
+  job_remaining_cls_ = 0;
+  dma_2d_ = false;
+  jobs_posted_ = jobs_completed_ = 0;
+  if (status_ != nullptr) {
+    status_jobs_ = 0;
+    write(reg(MMIO_STATUS_ADDR), (uint64_t) status_);
+  }
+
+  if (ring_ != nullptr) {
+    ring_head_ = ring_tail_ = ring_doorbell_ = 0;
+    write(reg(MMIO_RING_ADDR), (uint64_t) ring_);
+    write(reg(MMIO_RING_ENTRIES), ring_entries_);
+  }
 }
 
 
@@ -153,13 +211,530 @@ uint64_t AFU::read(uint64_t addr) const {
 }
 
 
+void AFU::launch(const volatile void* input, volatile void* output, uint64_t bytes) {
+
+  if (job_remaining_cls_ > 0)
+    throw runtime_error("ERROR: AFU::launch() called before the previous job finished.");
+
+  // The AFU ignores go while it is processing descriptors.
+  if (ring_tail_ > 0 && !poll(ring_tail_ - 1))
+    throw runtime_error("ERROR: AFU::launch() called while descriptor-ring jobs are outstanding.");
+
+  // Return the row registers to a single contiguous range.
+  if (dma_2d_) {
+    write(reg(MMIO_RD_ROW_SIZE), 0);
+    write(reg(MMIO_WR_ROW_SIZE), 0);
+    dma_2d_ = false;
+  }
+
+  job_rd_addr_ = (uint64_t) input;
+  job_wr_addr_ = (uint64_t) output;
+  job_remaining_cls_ = (bytes + CL_BYTES - 1) / CL_BYTES;
+  job_row_cls_ = 0;
+  job_last_bytes_ = byte_sizes_ ? bytes % CL_BYTES : 0;
+
+  // The CRCs and performance counters accumulate across every DMA transfer
+  // of the job, and are cleared by the same write.
+  write(reg(MMIO_RD_CRC), 0);
+  startDma();
+}
+
+
+void AFU::launch2d(const volatile void *input, uint64_t rd_pitch,
+		   volatile void *output, uint64_t wr_pitch,
+		   uint64_t row_bytes, uint64_t rows) {
+
+  if (job_remaining_cls_ > 0)
+    throw runtime_error("ERROR: AFU::launch2d() called before the previous job finished.");
+
+  if (ring_tail_ > 0 && !poll(ring_tail_ - 1))
+    throw runtime_error("ERROR: AFU::launch2d() called while descriptor-ring jobs are outstanding.");
+
+  if ((uint64_t) input % CL_BYTES != 0 || (uint64_t) output % CL_BYTES != 0 ||
+      row_bytes % CL_BYTES != 0 || rd_pitch % CL_BYTES != 0 || wr_pitch % CL_BYTES != 0)
+    throw runtime_error("ERROR: AFU::launch2d() requires buffers, rows, and pitches aligned to cache lines.");
+
+  if (row_bytes == 0 || rows == 0)
+    throw runtime_error("ERROR: AFU::launch2d() called with an empty job.");
+
+  if (rd_pitch < row_bytes || wr_pitch < row_bytes)
+    throw runtime_error("ERROR: AFU::launch2d() requires pitches of at least the row size.");
+
+  // Each DMA transfer contains whole rows.
+  if (row_bytes / CL_BYTES > max_dma_cls_)
+    throw runtime_error("ERROR: AFU::launch2d() rows can't exceed the maximum DMA size.");
+
+  job_rd_addr_ = (uint64_t) input;
+  job_wr_addr_ = (uint64_t) output;
+  job_row_cls_ = row_bytes / CL_BYTES;
+  job_rd_pitch_cls_ = rd_pitch / CL_BYTES;
+  job_wr_pitch_cls_ = wr_pitch / CL_BYTES;
+  job_remaining_cls_ = job_row_cls_ * rows;
+  job_last_bytes_ = 0;
+
+  // AFUs without 2D transfers return 0 for the unused MMIO address.
+  write(reg(MMIO_RD_PITCH), job_rd_pitch_cls_);
+  if (read(reg(MMIO_RD_PITCH)) != job_rd_pitch_cls_) {
+    job_remaining_cls_ = 0;
+    throw runtime_error("ERROR: AFU doesn't support 2D transfers.");
+  }
+
+  write(reg(MMIO_WR_PITCH), job_wr_pitch_cls_);
+  write(reg(MMIO_RD_ROW_SIZE), job_row_cls_);
+  write(reg(MMIO_WR_ROW_SIZE), job_row_cls_);
+  dma_2d_ = true;
+
+  write(reg(MMIO_RD_CRC), 0);
+  startDma();
+}
+
+
+uint64_t AFU::queueJob(const volatile void* input, volatile void* output, uint64_t bytes) {
+
+  if (job_queue_depth_ == 0)
+    throw runtime_error("ERROR: AFU doesn't have a job queue.");
+
+  if (job_remaining_cls_ > 0)
+    throw runtime_error("ERROR: AFU::queueJob() called before the previous job finished.");
+
+  if (ring_tail_ > 0 && !poll(ring_tail_ - 1))
+    throw runtime_error("ERROR: AFU::queueJob() called while descriptor-ring jobs are outstanding.");
+
+  uint64_t cls = (bytes + CL_BYTES - 1) / CL_BYTES;
+  if (cls > max_dma_cls_)
+    throw runtime_error("ERROR: AFU::queueJob() jobs can't exceed the maximum DMA size.");
+
+  if (dma_2d_) {
+    write(reg(MMIO_RD_ROW_SIZE), 0);
+    write(reg(MMIO_WR_ROW_SIZE), 0);
+    dma_2d_ = false;
+  }
+
+  waitForJobQueue();
+  write(reg(MMIO_RD_ADDR), (uint64_t) input);
+  write(reg(MMIO_WR_ADDR), (uint64_t) output);
+  if (byte_sizes_ && bytes % CL_BYTES != 0)
+    write(reg(MMIO_BYTES), bytes);
+  else
+    write(reg(MMIO_SIZE), cls);
+
+  write(reg(MMIO_GO), 1);
+  status_jobs_++;
+  return jobs_posted_++;
+}
+
+
+bool AFU::isJobDone(uint64_t id) {
+
+  if (id >= jobs_posted_)
+    throw runtime_error("ERROR: AFU::isJobDone() called with a job that wasn't posted.");
+
+  if (id >= jobs_completed_)
+    updateJobsCompleted();
+
+  return id < jobs_completed_;
+}
+
+
+void AFU::waitJob(uint64_t id) {
+
+  while (!isJobDone(id)) {
+#ifdef SLEEP_WHILE_WAITING
+    this_thread::sleep_for(chrono::milliseconds(SLEEP_MS));
+#endif
+  }
+}
+
+
+bool AFU::isDone() {
+
+  if (status_ != nullptr) {
+    // The AFU's job count is 32 bits.
+    if ((uint32_t) status_->job != (uint32_t) status_jobs_ || status_->done == 0)
+      return false;
+  }
+  else if (read(reg(MMIO_DONE)) == 0) {
+    return false;
+  }
+
+  // Start the next part of a large job as soon as the previous one is done.
+  if (job_remaining_cls_ > 0) {
+    startDma();
+    return false;
+  }
+
+  return true;
+}
+
+
+void AFU::wait() {
+
+  while (!isDone()) {
+#ifdef SLEEP_WHILE_WAITING
+    this_thread::sleep_for(chrono::milliseconds(SLEEP_MS));
+#endif
+  }
+}
+
+
+uint32_t AFU::getReadCrc() const {
+
+  return read(reg(MMIO_RD_CRC));
+}
+
+
+uint32_t AFU::getWriteCrc() const {
+
+  return read(reg(MMIO_WR_CRC));
+}
+
+
+uint64_t AFU::getCycles() const {
+
+  return status_ == nullptr ? 0 : status_->cycles;
+}
+
+
+AFU::PerfCounters AFU::getPerfCounters() const {
+
+  PerfCounters counters;
+  counters.active_cycles = read(reg(MMIO_PERF));
+  counters.rd_requests = read(reg(MMIO_PERF + 2));
+  counters.rd_responses = read(reg(MMIO_PERF + 4));
+  counters.wr_requests = read(reg(MMIO_PERF + 6));
+  counters.c0_almost_full = read(reg(MMIO_PERF + 8));
+  counters.rd_fifo_almost_full = read(reg(MMIO_PERF + 10));
+  counters.rd_data_not_read = read(reg(MMIO_PERF + 12));
+  counters.c1_almost_full = read(reg(MMIO_PERF + 14));
+  counters.wr_data_not_written = read(reg(MMIO_PERF + 16));
+  counters.min_rd_latency = read(reg(MMIO_PERF + 18));
+  counters.max_rd_latency = read(reg(MMIO_PERF + 20));
+  counters.total_rd_latency = read(reg(MMIO_PERF + 22));
+  counters.c1_arbiter = read(reg(MMIO_PERF_ARB));
+
+  // The minimum latency is the maximum value until there is a response.
+  if (counters.rd_responses == 0)
+    counters.min_rd_latency = 0;
+
+  return counters;
+}
+
+
+void AFU::setBurstLength(unsigned cls) {
+
+  if (cls != 1 && cls != 2 && cls != 4)
+    throw runtime_error("ERROR: Burst length must be 1, 2, or 4 cache lines.");
+
+  if (job_remaining_cls_ > 0 || read(reg(MMIO_DONE)) == 0)
+    throw runtime_error("ERROR: AFU::setBurstLength() called during a DMA job.");
+
+  write(reg(MMIO_BURST_LEN), cls);
+}
+
+
+void AFU::setVcPolicy(VcPolicy policy) {
+
+  if (policy > VC_VH_ALTERNATE)
+    throw runtime_error("ERROR: Invalid virtual channel policy.");
+
+  if (job_remaining_cls_ > 0 || read(reg(MMIO_DONE)) == 0)
+    throw runtime_error("ERROR: AFU::setVcPolicy() called during a DMA job.");
+
+  write(reg(MMIO_VC_POLICY), policy);
+}
+
+
+void AFU::setCacheHints(bool rd_cached, bool wr_cached) {
+
+  if (job_remaining_cls_ > 0 || read(reg(MMIO_DONE)) == 0)
+    throw runtime_error("ERROR: AFU::setCacheHints() called during a DMA job.");
+
+  write(reg(MMIO_CACHE_HINTS), (wr_cached ? 2 : 0) | (rd_cached ? 1 : 0));
+}
+
+
+AFU::ChannelCounts AFU::getChannelCounts() const {
+
+  // The csr_mgr counters aren't part of the DMA channel's registers.
+  ChannelCounts counts;
+  counts.vl0_rd = read(MMIO_CSR_VL0_RD);
+  counts.vl0_wr = read(MMIO_CSR_VL0_WR);
+  counts.vh0 = read(MMIO_CSR_VH0);
+  counts.vh1 = read(MMIO_CSR_VH1);
+  return counts;
+}
+
+
+void AFU::enableRing(unsigned entries) {
+
+  if (entries == 0 || (entries & (entries - 1)) != 0)
+    throw runtime_error("ERROR: The number of ring entries must be a power of 2.");
+
+  if (job_remaining_cls_ > 0 || (ring_tail_ > 0 && !poll(ring_tail_ - 1)))
+    throw runtime_error("ERROR: AFU::enableRing() called while jobs are outstanding.");
+
+  if (ring_ != nullptr)
+    free(ring_);
+
+  // The scatter-gather lists depend on the number of ring entries.
+  if (sg_lists_ != nullptr) {
+    free(sg_lists_);
+    sg_lists_ = nullptr;
+  }
+
+  ring_ = malloc<volatile Descriptor>(entries);
+  ring_entries_ = entries;
+  ring_head_ = ring_tail_ = ring_doorbell_ = 0;
+
+  // Disable the ring while changing the address, which also clears the
+  // AFU's counts.
+  write(reg(MMIO_RING_ENTRIES), 0);
+  write(reg(MMIO_RING_ADDR), (uint64_t) ring_);
+  write(reg(MMIO_RING_ENTRIES), entries);
+}
+
+
+uint64_t AFU::enqueue(const volatile void *input, volatile void *output, uint64_t bytes, bool doorbell) {
+
+  if (ring_ == nullptr)
+    throw runtime_error("ERROR: AFU::enqueue() called before AFU::enableRing().");
+
+  uint64_t cls = (bytes + CL_BYTES - 1) / CL_BYTES;
+  if (cls > MAX_DMA_CLS)
+    throw runtime_error("ERROR: Descriptor-ring jobs can't exceed AFU::MAX_DMA_CLS cache lines.");
+
+  volatile Descriptor &desc = nextDescriptor();
+  desc.rd_addr = (uint64_t) input;
+  desc.wr_addr = (uint64_t) output;
+  desc.size = cls;
+  desc.flags = DESC_COMPLETION;
+  desc.status = DESC_PENDING;
+
+  return commitDescriptor(doorbell);
+}
+
+
+uint64_t AFU::submitSg(const vector<SgEntry> &rd, const vector<SgEntry> &wr, bool doorbell) {
+
+  if (rd.empty() || wr.empty() || rd.size() > MAX_SG_ENTRIES || wr.size() > MAX_SG_ENTRIES)
+    throw runtime_error("ERROR: Scatter-gather lists must have between 1 and AFU::MAX_SG_ENTRIES entries.");
+
+  uint64_t rd_cls = 0, wr_cls = 0;
+  for (const SgEntry &entry : rd) {
+    if (entry.cls == 0 || entry.cls > MAX_DMA_CLS || entry.addr % CL_BYTES != 0)
+      throw runtime_error("ERROR: Invalid scatter-gather entry.");
+    rd_cls += entry.cls;
+  }
+
+  for (const SgEntry &entry : wr) {
+    if (entry.cls == 0 || entry.cls > MAX_DMA_CLS || entry.addr % CL_BYTES != 0)
+      throw runtime_error("ERROR: Invalid scatter-gather entry.");
+    wr_cls += entry.cls;
+  }
+
+  if (rd_cls != wr_cls)
+    throw runtime_error("ERROR: Scatter-gather read and write lists have different sizes.");
+
+  if (ring_ == nullptr)
+    enableRing();
+
+  if (sg_lists_ == nullptr)
+    sg_lists_ = malloc<volatile SgEntry>(2 * MAX_SG_ENTRIES * ring_entries_);
+
+  // Each ring entry has its own lists, which aren't reused until the
+  // entry's job is complete.
+  volatile Descriptor &desc = nextDescriptor();
+  volatile SgEntry *rd_list = sg_lists_ + 2 * MAX_SG_ENTRIES * (ring_tail_ % ring_entries_);
+  volatile SgEntry *wr_list = rd_list + MAX_SG_ENTRIES;
+
+  for (size_t i=0; i < rd.size(); i++) {
+    rd_list[i].addr = rd[i].addr;
+    rd_list[i].cls = rd[i].cls;
+  }
+
+  for (size_t i=0; i < wr.size(); i++) {
+    wr_list[i].addr = wr[i].addr;
+    wr_list[i].cls = wr[i].cls;
+  }
+
+  desc.rd_addr = (uint64_t) rd_list;
+  desc.wr_addr = (uint64_t) wr_list;
+  desc.size = rd.size();
+  desc.wr_entries = wr.size();
+  desc.flags = DESC_COMPLETION | DESC_SG;
+  desc.status = DESC_PENDING;
+
+  return commitDescriptor(doorbell);
+}
+
+
+volatile AFU::Descriptor& AFU::nextDescriptor() {
+
+  // Wait for the oldest job if the ring is full.
+  if (ring_tail_ - ring_head_ == ring_entries_)
+    wait(ring_head_);
+
+  return ring_[ring_tail_ % ring_entries_];
+}
+
+
+uint64_t AFU::commitDescriptor(bool doorbell) {
+
+  uint64_t id = ring_tail_++;
+  if (doorbell)
+    this->doorbell();
+
+  return id;
+}
+
+
+void AFU::doorbell() {
+
+  if (ring_doorbell_ == ring_tail_)
+    return;
+
+  // Make sure the descriptors are in memory before the AFU can read them.
+  atomic_thread_fence(memory_order_seq_cst);
+  write(reg(MMIO_RING_TAIL), ring_tail_);
+  ring_doorbell_ = ring_tail_;
+}
+
+
+bool AFU::poll(uint64_t id) {
+
+  if (id >= ring_tail_)
+    throw runtime_error("ERROR: AFU::poll() called with an invalid job id.");
+
+  // Jobs complete in order, so advance past every completed job.
+  while (ring_head_ < ring_tail_ && ring_[ring_head_ % ring_entries_].status == DESC_DONE)
+    ring_head_++;
+
+  return id < ring_head_;
+}
+
+
+void AFU::wait(uint64_t id) {
+
+  // The job won't ever complete if it is waiting for a doorbell.
+  if (id >= ring_doorbell_)
+    doorbell();
+
+  while (!poll(id)) {
+#ifdef SLEEP_WHILE_WAITING
+    this_thread::sleep_for(chrono::milliseconds(SLEEP_MS));
+#endif
+  }
+}
+
+
+void AFU::setMaxDmaSize(uint64_t cls) {
+
+  if (cls == 0 || cls > MAX_DMA_CLS)
+    throw runtime_error("ERROR: Invalid maximum DMA size.");
+
+  max_dma_cls_ = cls;
+}
+
+
+void AFU::startDma() {
+
+  uint64_t cls = job_remaining_cls_ < max_dma_cls_ ? job_remaining_cls_ : max_dma_cls_;
+
+  // Split 2D jobs at the end of a row, so each transfer starts on a row.
+  if (job_row_cls_ != 0)
+    cls -= cls % job_row_cls_;
+
+  // Jobs posted with queueJob() may still fill the queue, and the AFU drops
+  // a go that arrives when the queue is full.
+  waitForJobQueue();
+  write(reg(MMIO_RD_ADDR), job_rd_addr_);
+  write(reg(MMIO_WR_ADDR), job_wr_addr_);
+
+  // Only the last transfer of the job can end with a partial cache line.
+  if (cls == job_remaining_cls_ && job_last_bytes_ != 0)
+    write(reg(MMIO_BYTES), cls * CL_BYTES - (CL_BYTES - job_last_bytes_));
+  else
+    write(reg(MMIO_SIZE), cls);
+
+  write(reg(MMIO_GO), 1);
+  status_jobs_++;
+  jobs_posted_++;
+
+  if (job_row_cls_ != 0) {
+    job_rd_addr_ += cls / job_row_cls_ * job_rd_pitch_cls_ * CL_BYTES;
+    job_wr_addr_ += cls / job_row_cls_ * job_wr_pitch_cls_ * CL_BYTES;
+  }
+  else {
+    job_rd_addr_ += cls * CL_BYTES;
+    job_wr_addr_ += cls * CL_BYTES;
+  }
+  job_remaining_cls_ -= cls;
+}
+
+
+void AFU::enableStatus() {
+
+  status_ = malloc<volatile Status>(1, PAGE_4KB);
+  status_->job = 0;
+  status_->done = 0;
+  write(reg(MMIO_STATUS_ADDR), (uint64_t) status_);
+
+  // AFUs without a status line return 0 for the unused MMIO address.
+  if (read(reg(MMIO_STATUS_ADDR)) != (uint64_t) status_) {
+    free(status_);
+    status_ = nullptr;
+  }
+}
+
+
+void AFU::enableByteSizes() {
+
+  // AFUs without byte sizes return 0 for the unused MMIO address.
+  write(reg(MMIO_BYTES), 1);
+  byte_sizes_ = read(reg(MMIO_BYTES)) == 1;
+}
+
+
+void AFU::enableJobQueue() {
+
+  // AFUs without a job queue return 0 for the unused MMIO address. The
+  // completion count isn't cleared by software, so job ids start at the
+  // current count.
+  job_queue_depth_ = read(reg(MMIO_JOB_QUEUE)) >> 32;
+  if (job_queue_depth_ > 0)
+    jobs_posted_ = jobs_completed_ = read(reg(MMIO_JOBS_COMPLETED));
+}
+
+
+void AFU::waitForJobQueue() {
+
+  // The queue holds job_queue_depth_ jobs in addition to the running job,
+  // so the AFU's completion count only has to be read when software has
+  // posted more jobs than that.
+  if (job_queue_depth_ == 0)
+    return;
+
+  while (jobs_posted_ - jobs_completed_ > job_queue_depth_) {
+    updateJobsCompleted();
+  }
+}
+
+
+void AFU::updateJobsCompleted() {
+
+  // Extend the AFU's 32-bit count using the difference from the last read.
+  uint32_t completed = read(reg(MMIO_JOBS_COMPLETED));
+  jobs_completed_ += (uint32_t) (completed - (uint32_t) jobs_completed_);
+}
+
+
 void AFU::free(volatile void* ptr) {
   
   // Casting away volatile qualifier to enable support for volatile and
   // non-volatile. Should be safe since we are just searching for the address 
   // of ptr and not modifying the contents of the array.
   auto it = buffer_map_.find((void*) ptr);
-  if (it == buffer_map_.end()) {
+  if (it == buffer_map_.end() || it->second.handle == nullptr) {
     throw std::runtime_error("ERROR: AFU::free() called with pointer without shared buffer.");
   }
   
@@ -167,6 +742,122 @@ void AFU::free(volatile void* ptr) {
 };
 
 
+void AFU::registerBuffer(const volatile void* ptr, size_t bytes) {
+
+  if (bytes == 0)
+    throw std::runtime_error("ERROR: AFU::registerBuffer() called with an empty region.");
+
+  // Reuse an existing buffer if it already covers the region. Buffers
+  // allocated by alloc() are already pinned, so there is nothing to count.
+  auto it = findBuffer(ptr, bytes);
+  if (it != buffer_map_.end()) {
+    if (it->second.handle == nullptr)
+      it->second.registrations ++;
+    return;
+  }
+  
+  // Pinning works on entire pages, so expand the region to 4KB boundaries.
+  size_t page_size = PAGE_SIZES[PAGE_4KB];
+  uintptr_t start = (uintptr_t) ptr & -page_size;
+  uintptr_t end = ((uintptr_t) ptr + bytes + page_size - 1) & -page_size;
+
+  // Find the registered buffers that share pages with the region. A page
+  // can't be pinned twice, so only the pages between them are pinned, and
+  // they are merged into a single buffer.
+  auto first = buffer_map_.lower_bound((void*) start);
+  if (first != buffer_map_.begin()) {
+    auto prev = std::prev(first);
+    if ((uintptr_t) prev->first + prev->second.bytes > start)
+      first = prev;
+  }
+
+  auto last = first;
+  while (last != buffer_map_.end() && (uintptr_t) last->first < end) {
+    if (last->second.handle != nullptr)
+      throw std::runtime_error("ERROR: AFU::registerBuffer() region partially overlaps an allocated buffer.");  
+    ++last;
+  }
+
+  // Ask the kernel to back any 2MB-aligned part of the region with huge
+  // pages, which VTP can then map with a single translation. This is only
+  // a hint, so failures are ignored.
+  size_t huge_page_size = PAGE_SIZES[PAGE_2MB];
+  uintptr_t huge_start = (start + huge_page_size - 1) & -huge_page_size;
+  uintptr_t huge_end = end & -huge_page_size;
+  if (huge_start < huge_end)
+    madvise((void*) huge_start, huge_end - huge_start, MADV_HUGEPAGE);
+  
+  // Pin the gaps before, between, and after the existing buffers, and add
+  // them to the VTP page table.
+  Buffer merged = {nullptr, 0, 1, {}};
+  uintptr_t merged_start = start, merged_end = end, pinned_end = start;
+  for (auto i = first; ; ++i) {
+    uintptr_t gap_end = i == last ? end : (uintptr_t) i->first;
+    if (pinned_end < gap_end) {
+      void* buf_addr = (void*) pinned_end;
+      fpga_result status = mpfVtpPrepareBuffer(*mpf_, gap_end - pinned_end, &buf_addr, FPGA_BUF_PREALLOCATED);
+      if (status != FPGA_OK) {
+	for (void* pin : merged.pins)
+	  mpfVtpReleaseBuffer(*mpf_, pin);
+	throw status;
+      }
+      merged.pins.push_back((void*) pinned_end);
+    }
+
+    if (i == last)
+      break;
+
+    merged_start = std::min(merged_start, (uintptr_t) i->first);
+    merged_end = std::max(merged_end, (uintptr_t) i->first + i->second.bytes);
+    pinned_end = (uintptr_t) i->first + i->second.bytes;
+  }
+
+  for (auto i = first; i != last; ++i) {
+    merged.registrations += i->second.registrations;
+    merged.pins.insert(merged.pins.end(), i->second.pins.begin(), i->second.pins.end());
+  }
+
+  buffer_map_.erase(first, last);
+  merged.bytes = merged_end - merged_start;
+  buffer_map_[(void*) merged_start] = merged;
+}
+
+
+void AFU::unregisterBuffer(const volatile void* ptr) {
+
+  auto it = findBuffer(ptr);
+  if (it == buffer_map_.end()) {
+    throw std::runtime_error("ERROR: AFU::unregisterBuffer() called with pointer without registered buffer.");
+  }
+
+  // Allocated buffers are released by free().
+  if (it->second.handle != nullptr)
+    return;
+
+  if (--it->second.registrations == 0) {
+    for (void* pin : it->second.pins)
+      mpfVtpReleaseBuffer(*mpf_, pin);
+    buffer_map_.erase(it);
+  }
+}
+
+
+std::map<void*, AFU::Buffer>::iterator AFU::findBuffer(const volatile void* ptr, size_t bytes) {
+
+  // Find the buffer with the largest start address <= ptr, and then check
+  // if it contains the entire region.
+  auto it = buffer_map_.upper_bound((void*) ptr);
+  if (it == buffer_map_.begin())
+    return buffer_map_.end();
+
+  --it;
+  if ((uintptr_t) ptr + bytes > (uintptr_t) it->first + it->second.bytes)
+    return buffer_map_.end();
+  
+  return it;
+}
+
+
 opae::fpga::types::shared_buffer::ptr_t AFU::alloc(size_t bytes, PageOptions page_option, bool read_only) {
     
   if (page_option < PAGE_4KB || page_option > PAGE_1GB)
@@ -188,6 +879,6 @@ opae::fpga::types::shared_buffer::ptr_t AFU::alloc(size_t bytes, PageOptions pag
 #endif
  
   // Save the buffer handle in the buffer_map_ using the address as the key.
-  buffer_map_[(void*) buf_handle->c_type()] = buf_handle;
+  buffer_map_[(void*) buf_handle->c_type()] = {buf_handle, page_aligned_bytes, 0, {}};
   return buf_handle;
 }
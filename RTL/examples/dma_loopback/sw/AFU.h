@@ -20,6 +20,7 @@
 #define __AFU_H__
 
 #include <list>
+#include <vector>
 #include <opae/cxx/core/handle.h>
 #include <opae/cxx/core/shared_buffer.h>
 #include <opae/mpf/cxx/mpf_handle.h>
@@ -38,14 +39,104 @@ public:
   static const PageOptions DEFAULT_PAGE_OPTION = PageOptions::PAGE_2MB;
   static const unsigned CL_BYTES = 64;
   static const unsigned CL_BITS = 512;
+
+  // The DMA size register is CL_ADDR_WIDTH+1 bits, where CL_ADDR_WIDTH is
+  // the 42-bit cache-line address width of CCI-P. Larger jobs are split
+  // into multiple DMA transfers.
+  static const uint64_t MAX_DMA_CLS = ((uint64_t) 1 << 43) - 1;
+
+  // Descriptor-ring entry (see hw/dma_ring.sv). For scatter-gather
+  // descriptors, the addresses are the addresses of the lists, and size
+  // and wr_entries are the number of read and write list entries.
+  struct alignas(64) Descriptor {
+    uint64_t rd_addr;
+    uint64_t wr_addr;
+    uint64_t size;
+    uint64_t flags;
+    uint64_t reserved[2];
+    uint64_t wr_entries;
+    uint64_t status;
+  };
+
+  // Scatter-gather list entry: a region of AFU-accessible memory starting
+  // at virtual byte address addr (cache-line aligned) with cls cache lines.
+  struct SgEntry {
+    uint64_t addr;
+    uint64_t cls;
+  };
+
+  // Status line written by the AFU after each DMA transfer started by
+  // launch() (see hw/dma_ring.sv).
+  struct alignas(64) Status {
+    uint64_t job;
+    uint64_t done;
+    uint64_t cycles;
+    uint64_t bytes;
+  };
+
+  // DMA performance counters (see hw/dma_if.vh), which cover the most
+  // recent job started by launch().
+  struct PerfCounters {
+    uint64_t active_cycles;
+    uint64_t rd_requests;
+    uint64_t rd_responses;
+    uint64_t wr_requests;
+    // Cycles stalled for each reason.
+    uint64_t c0_almost_full;
+    uint64_t rd_fifo_almost_full;
+    uint64_t rd_data_not_read;
+    uint64_t c1_almost_full;
+    uint64_t wr_data_not_written;
+    // Cycles writes waited for another DMA channel.
+    uint64_t c1_arbiter;
+    // Read latencies in AFU clock cycles.
+    uint64_t min_rd_latency;
+    uint64_t max_rd_latency;
+    uint64_t total_rd_latency;
+
+    double meanRdLatency() const {
+      return rd_responses == 0 ? 0.0 : (double) total_rd_latency / rd_responses;
+    }
+  };
+
+  // CCI-P virtual channel policies (see hw/dma_if.vh). VC_AUTO lets the
+  // FIU select the channel of each request.
+  enum VcPolicy {VC_AUTO=0, VC_VL0=1, VC_VH0=2, VC_VH1=3, VC_VH_ALTERNATE=4};
+
+  // Responses received on each CCI-P virtual channel. VL0 counts reads and
+  // writes separately.
+  struct ChannelCounts {
+    uint64_t vl0_rd;
+    uint64_t vl0_wr;
+    uint64_t vh0;
+    uint64_t vh1;
+  };
+
+  enum DescriptorFlags {DESC_COMPLETION=1, DESC_SG=2};
+  enum DescriptorStatus {DESC_PENDING=0, DESC_DONE=1};
+  static const unsigned DEFAULT_RING_ENTRIES = 256;
+
+  // Must match the MAX_SG_ENTRIES parameter of hw/dma_ring.sv.
+  static const unsigned MAX_SG_ENTRIES = 256;
+
+  // The maximum number of DMA channels that fit in the AFU's MMIO space.
+  static const unsigned MAX_DMA_CHANNELS = 7;
  
   // Constructors, destrictors
   AFU(opae::fpga::types::handle::ptr_t);
   AFU(const char*);
+
+  // Creates an object for another DMA channel of the same AFU, which shares
+  // the AFU's handles. Each channel has its own jobs, buffers, status line,
+  // and descriptor ring, and runs independently of the other channels. An
+  // exception is thrown if the AFU doesn't have the channel. The channel
+  // object must be destroyed before afu.
+  AFU(const AFU &afu, unsigned channel);
   virtual ~AFU();
  
   // Methods
   static opae::fpga::types::handle::ptr_t requestAfu(const char* uuid); 
+  // Resets the entire AFU, including the jobs of every DMA channel.
   virtual void reset();
   virtual void write(uint64_t addr, uint64_t data) const;
   virtual uint64_t read(uint64_t addr) const;  
@@ -74,15 +165,189 @@ public:
   
   void free(volatile void *ptr);
 
+  // Makes existing memory (e.g. a std::vector or an mmap'd file) accessible
+  // to the AFU without copying it. The region is expanded to page
+  // boundaries and pinned. Registering a region that is already covered by
+  // a registered or allocated buffer reuses the existing pinned pages, so
+  // repeated registrations of the same data are cheap. Regions that share
+  // a page with other registered regions (e.g. two small std::vectors) are
+  // merged with them, and stay pinned until every merged registration is
+  // unregistered. Each call must be matched by a call to unregisterBuffer().
+  void registerBuffer(const volatile void *ptr, size_t bytes);
+  void unregisterBuffer(const volatile void *ptr);
+
+  // Starts a DMA job that streams bytes from input through the AFU into
+  // output. Sizes that aren't a multiple of CL_BYTES read the entire last
+  // cache line of input, but only write the requested bytes of output. AFUs
+  // without byte sizes write the entire last cache line. Jobs larger than
+  // the maximum DMA size are automatically split into back-to-back DMA
+  // transfers, which are started by isDone() and wait().
+  //
+  // If the AFU supports it, the AFU writes a status line into shared memory
+  // after each transfer, so isDone() and wait() only read from the cache
+  // instead of reading the AFU's done register with MMIO.
+  void launch(const volatile void *input, volatile void *output, uint64_t bytes);
+
+  // Starts a 2D job that copies rows of row_bytes bytes, where the rows of
+  // input start rd_pitch bytes apart, and the rows of output start wr_pitch
+  // bytes apart. This reads or writes a tile of a larger row-major matrix
+  // without packing it into a separate buffer first. The buffers, row_bytes,
+  // and the pitches must be multiples of CL_BYTES. isDone() and wait() work
+  // the same as for launch(). An exception is thrown if the AFU doesn't
+  // support 2D transfers.
+  void launch2d(const volatile void *input, uint64_t rd_pitch,
+		volatile void *output, uint64_t wr_pitch,
+		uint64_t row_bytes, uint64_t rows);
+  bool isDone();
+  void wait();
+
+  // Hardware job queue. queueJob() posts a job to a small queue in the AFU,
+  // which starts the job as soon as the previous job is done, so software
+  // can post the next jobs while a job is still running. Each job is
+  // limited to the maximum DMA size, and queueJob() waits while the queue
+  // is full. The returned id is checked with isJobDone() and waitJob().
+  // The CRCs and performance counters accumulate across queued jobs.
+  // An exception is thrown if the AFU doesn't have a job queue, or if a job
+  // started by launch() or the descriptor ring hasn't finished.
+  uint64_t queueJob(const volatile void *input, volatile void *output, uint64_t bytes);
+  bool isJobDone(uint64_t id);
+  void waitJob(uint64_t id);
+
+  // Returns the number of AFU clock cycles of the most recent DMA transfer,
+  // or 0 if the AFU doesn't write a status line.
+  uint64_t getCycles() const;
+
+  // Returns the CRC-32C of all data read from and written to the DMA during
+  // the most recent job (see crc32c.h). The CRCs include the entire last
+  // cache line of the job.
+  uint32_t getReadCrc() const;
+  uint32_t getWriteCrc() const;
+
+  // Returns the DMA performance counters of the most recent job. The
+  // counters are cleared by launch().
+  PerfCounters getPerfCounters() const;
+
+  // Sets the maximum number of cache lines (1, 2, or 4) the DMA requests
+  // from memory at once. Longer bursts use the CCI-P links more
+  // efficiently.
+  void setBurstLength(unsigned cls);
+
+  // Sets the CCI-P virtual channel of the memory requests of the following
+  // jobs. VL0 uses the FPGA cache, and the PCIe channels VH0 and VH1 can
+  // be used together by alternating requests between them.
+  void setVcPolicy(VcPolicy policy);
+
+  // Sets the cache hints of the following jobs. rd_cached reads with
+  // RDLINE_S, and wr_cached writes with WRLINE_M, which keeps the written
+  // data in the FPGA cache for data the host reads back immediately.
+  void setCacheHints(bool rd_cached, bool wr_cached);
+
+  // Returns the number of responses received on each virtual channel since
+  // the AFU was reset. The counters include the requests of every DMA
+  // channel, so the channel mix of a job is the difference of the counts
+  // before and after the job.
+  ChannelCounts getChannelCounts() const;
+
+  // Descriptor-ring mode. Instead of starting each job with MMIO writes,
+  // enqueue() writes the job into a ring in shared memory, where the AFU
+  // fetches it from, and then writes a single doorbell register. Any number
+  // of jobs can be queued, and the AFU runs them back to back in order.
+  // When doorbell is false, the doorbell isn't written until the next call
+  // to doorbell(), which allows a batch of jobs to be started with one MMIO
+  // write. The AFU writes a completion record into the ring after each job,
+  // so poll() and wait() only read host memory. Jobs can't exceed
+  // MAX_DMA_CLS cache lines. launch() can't be used while ring jobs are
+  // outstanding.
+  void enableRing(unsigned entries=DEFAULT_RING_ENTRIES);
+  uint64_t enqueue(const volatile void *input, volatile void *output, uint64_t bytes, bool doorbell=true);
+  void doorbell();
+  bool poll(uint64_t id);
+  void wait(uint64_t id);
+
+  // Queues a scatter-gather job in the descriptor ring, which enables the
+  // ring if necessary. The AFU reads the regions of rd in order as a single
+  // stream, and writes the stream into the regions of wr in order, so the
+  // regions don't have to line up, but both lists must have the same total
+  // size. Each list can have at most MAX_SG_ENTRIES entries. The lists are
+  // copied, so they can be reused immediately. Returns an id for poll() and
+  // wait().
+  uint64_t submitSg(const std::vector<SgEntry> &rd, const std::vector<SgEntry> &wr, bool doorbell=true);
+
+  // Changes the maximum number of cache lines per DMA transfer (e.g. to
+  // test splitting of large jobs in simulation).
+  void setMaxDmaSize(uint64_t cls);
+
 protected: 
 
+  // Every AFU-accessible region, either allocated by alloc() (handle is
+  // valid) or registered by registerBuffer() (handle is null). Registered
+  // regions that share pages are merged, so a registered buffer can consist
+  // of several separately pinned parts, which are listed in pins.
+  struct Buffer {
+    opae::fpga::types::shared_buffer::ptr_t handle;
+    size_t bytes;
+    unsigned registrations;
+    std::vector<void*> pins;
+  };
+
   // Members
-  std::map<void*, opae::fpga::types::shared_buffer::ptr_t> buffer_map_;
+  std::map<void*, Buffer> buffer_map_;
   opae::fpga::types::handle::ptr_t fpga_;
   opae::fpga::bbb::mpf::types::mpf_handle::ptr_t mpf_;
 
+  // Offset of the DMA channel's registers from the registers of channel 0.
+  uint64_t mmio_offset_ = 0;
+  // False for channel objects, which don't close the shared handles.
+  bool owns_handles_ = true;
+
+  // State of the current DMA job.
+  uint64_t job_rd_addr_, job_wr_addr_;
+  uint64_t job_remaining_cls_ = 0;
+
+  // Shape of a 2D job in cache lines (job_row_cls_ is 0 for 1D jobs), and
+  // whether the AFU's row registers currently hold a 2D shape.
+  uint64_t job_row_cls_ = 0, job_rd_pitch_cls_ = 0, job_wr_pitch_cls_ = 0;
+  bool dma_2d_ = false;
+
+  // Bytes to write from the job's last cache line (0 for the entire line),
+  // and whether the AFU supports byte sizes.
+  unsigned job_last_bytes_ = 0;
+  bool byte_sizes_ = false;
+  uint64_t max_dma_cls_ = MAX_DMA_CLS;
+
+  // Capacity of the AFU's job queue (0 if the AFU doesn't have one), and
+  // the number of jobs started with go and known to be complete. The AFU
+  // counts completed jobs with a 32-bit counter.
+  unsigned job_queue_depth_ = 0;
+  uint64_t jobs_posted_ = 0, jobs_completed_ = 0;
+
+  // Status line, or nullptr if the AFU doesn't support it, and the number
+  // of DMA transfers since the status line was configured.
+  volatile Status *status_ = nullptr;
+  uint64_t status_jobs_ = 0;
+
+  // Descriptor ring. The counts are free running, and ring_head_ is the
+  // number of jobs known to be complete.
+  volatile Descriptor *ring_ = nullptr;
+  unsigned ring_entries_ = 0;
+  uint64_t ring_head_ = 0, ring_tail_ = 0, ring_doorbell_ = 0;
+
+  // Scatter-gather lists, with a read and a write list for each ring entry,
+  // or nullptr until the first scatter-gather job.
+  volatile SgEntry *sg_lists_ = nullptr;
+
   // Methods
   opae::fpga::types::shared_buffer::ptr_t alloc(size_t bytes, PageOptions page_option, bool read_only);
+  std::map<void*, Buffer>::iterator findBuffer(const volatile void *ptr, size_t bytes=1);
+  void startDma();
+  void enableStatus();
+  void enableByteSizes();
+  void enableJobQueue();
+  void waitForJobQueue();
+  void updateJobsCompleted();
+  uint64_t reg(uint64_t addr) const { return addr + mmio_offset_; }
+  volatile Descriptor& nextDescriptor();
+  uint64_t commitDescriptor(bool doorbell);
 };
 
 #endif
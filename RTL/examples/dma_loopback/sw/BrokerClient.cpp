@@ -0,0 +1,268 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "BrokerClient.h"
+
+using namespace std;
+using namespace broker;
+
+
+BrokerClient::BrokerClient(const char *shm_name) : next_id_(0), jobs_completed_(0) {
+
+  int fd = shm_open(shm_name, O_RDWR, 0);
+  if (fd < 0)
+    throw runtime_error(string("ERROR: Can't open ") + shm_name + ". Is the broker running?");
+
+  struct stat shm_stat;
+  if (fstat(fd, &shm_stat) != 0 || (size_t) shm_stat.st_size < sizeof(Header)) {
+    close(fd);
+    throw runtime_error("ERROR: Invalid broker shared memory.");
+  }
+
+  void *ptr = mmap(nullptr, shm_stat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED)
+    throw runtime_error(string("ERROR: Can't map broker shared memory: ") + strerror(errno));
+
+  base_ = reinterpret_cast<uint8_t*>(ptr);
+  header_ = reinterpret_cast<Header*>(ptr);
+  if (header_->magic != MAGIC) {
+    munmap(base_, shm_stat.st_size);
+    throw runtime_error("ERROR: Broker is not ready.");
+  }
+
+  if (!brokerAlive()) {
+    munmap(base_, shm_stat.st_size);
+    throw runtime_error("ERROR: Broker is not running.");
+  }
+
+  // Claim a free client slot. The slot isn't visible to the broker until
+  // the rings are reset and it becomes active.
+  slot_ = nullptr;
+  for (ClientSlot &s : header_->clients) {
+    int32_t expected = 0;
+    if (s.pid.compare_exchange_strong(expected, getpid())) {
+      slot_ = &s;
+      break;
+    }
+  }
+
+  if (slot_ == nullptr) {
+    munmap(base_, header_->segment_bytes);
+    throw runtime_error("ERROR: All broker client slots are in use.");
+  }
+
+  slot_->sq_head.store(0);
+  slot_->sq_tail.store(0);
+  slot_->cq_head.store(0);
+  slot_->cq_tail.store(0);
+  slot_->state.store(SLOT_ACTIVE, memory_order_release);
+
+  free_list_[slot_->heap_offset] = slot_->heap_bytes;
+}
+
+
+BrokerClient::~BrokerClient() {
+
+  // The AFU may still be writing into this client's heap, so wait for all
+  // submitted jobs before giving the slot to another client. If the broker
+  // is gone, the jobs will never complete.
+  uint32_t tail = slot_->sq_tail.load();
+  uint32_t done;
+  while ((done = slot_->cq_tail.load(memory_order_acquire)) != tail && brokerAlive())
+    futexWait(slot_->cq_tail, done, LIVENESS_MS);
+
+  slot_->state.store(SLOT_FREE, memory_order_release);
+  slot_->pid.store(0, memory_order_release);
+  munmap(base_, header_->segment_bytes);
+}
+
+
+volatile uint8_t* BrokerClient::alloc(size_t bytes) {
+
+  bytes = (bytes + ALLOC_ALIGNMENT - 1) & -ALLOC_ALIGNMENT;
+  if (bytes == 0)
+    bytes = ALLOC_ALIGNMENT;
+
+  // First fit from the free list.
+  for (auto it = free_list_.begin(); it != free_list_.end(); ++it) {
+    if (it->second >= bytes) {
+      uint64_t offset = it->first;
+      uint64_t remaining = it->second - bytes;
+      free_list_.erase(it);
+      if (remaining > 0)
+	free_list_[offset + bytes] = remaining;
+
+      allocated_[offset] = bytes;
+      return base_ + offset;
+    }
+  }
+
+  throw runtime_error("ERROR: Broker client heap is full.");
+}
+
+
+void BrokerClient::free(volatile void *ptr) {
+
+  auto it = allocated_.find(toOffset(ptr));
+  if (it == allocated_.end())
+    throw runtime_error("ERROR: BrokerClient::free() called with pointer that wasn't allocated.");
+
+  uint64_t offset = it->first;
+  uint64_t bytes = it->second;
+  allocated_.erase(it);
+
+  // Merge with the following and preceding free regions.
+  auto next = free_list_.find(offset + bytes);
+  if (next != free_list_.end()) {
+    bytes += next->second;
+    free_list_.erase(next);
+  }
+
+  auto prev = free_list_.lower_bound(offset);
+  if (prev != free_list_.begin()) {
+    --prev;
+    if (prev->first + prev->second == offset) {
+      prev->second += bytes;
+      return;
+    }
+  }
+
+  free_list_[offset] = bytes;
+}
+
+
+uint64_t BrokerClient::launch(const volatile void *input, volatile void *output, uint64_t bytes) {
+
+  uint64_t in_offset = toOffset(input);
+  uint64_t out_offset = toOffset(output);
+
+  // Limit the jobs that haven't been reaped to the size of the rings, which
+  // guarantees the broker never has to wait for space in the completion
+  // ring.
+  uint32_t tail = slot_->sq_tail.load(memory_order_relaxed);
+  while (true) {
+    uint32_t done = slot_->cq_tail.load(memory_order_acquire);
+    reapCompletions();
+    if (tail - slot_->cq_head.load(memory_order_relaxed) < RING_ENTRIES)
+      break;
+    waitForCompletion(done);
+  }
+
+  Job &job = slot_->sq[tail & (RING_ENTRIES-1)];
+  job.id = next_id_++;
+  job.input = in_offset;
+  job.output = out_offset;
+  job.bytes = bytes;
+  slot_->sq_tail.store(tail + 1, memory_order_release);
+
+  // Wake up the broker.
+  header_->doorbell.fetch_add(1, memory_order_release);
+  futexWake(header_->doorbell);
+
+  return job.id;
+}
+
+
+bool BrokerClient::isDone(uint64_t id) {
+
+  if (id >= next_id_)
+    throw runtime_error("ERROR: BrokerClient::isDone() called with a job that wasn't launched.");
+
+  if (id >= jobs_completed_)
+    reapCompletions();
+
+  if (id >= jobs_completed_)
+    return false;
+
+  if (rejected_.count(id) > 0)
+    throw runtime_error("ERROR: Broker rejected job " + to_string(id) + ".");
+
+  return true;
+}
+
+
+void BrokerClient::wait(uint64_t id) {
+
+  while (true) {
+    // Read the tail before checking, so a completion that arrives in
+    // between wakes up the futex immediately.
+    uint32_t done = slot_->cq_tail.load(memory_order_acquire);
+    if (isDone(id))
+      return;
+    waitForCompletion(done);
+  }
+}
+
+
+uint64_t BrokerClient::toOffset(const volatile void *ptr) const {
+
+  uint64_t offset = (const volatile uint8_t*) ptr - base_;
+  if ((const volatile uint8_t*) ptr < base_ ||
+      offset < slot_->heap_offset ||
+      offset >= slot_->heap_offset + slot_->heap_bytes)
+    throw runtime_error("ERROR: Pointer was not allocated by BrokerClient::malloc().");
+
+  return offset;
+}
+
+
+void BrokerClient::reapCompletions() {
+
+  uint32_t head = slot_->cq_head.load(memory_order_relaxed);
+  uint32_t tail = slot_->cq_tail.load(memory_order_acquire);
+
+  while (head != tail) {
+    Completion &c = slot_->cq[head & (RING_ENTRIES-1)];
+    jobs_completed_ = c.id + 1;
+    if (c.status != JOB_OK)
+      rejected_.insert(c.id);
+    head++;
+  }
+
+  slot_->cq_head.store(head, memory_order_release);
+}
+
+
+bool BrokerClient::brokerAlive() const {
+
+  // kill() fails with EPERM for a broker owned by another user, which still
+  // exists.
+  int32_t pid = header_->broker_pid.load(memory_order_acquire);
+  return pid != 0 && !(kill(pid, 0) != 0 && errno == ESRCH);
+}
+
+
+// Sleeps until the completion tail changes from done, checking that the
+// broker still exists every LIVENESS_MS.
+void BrokerClient::waitForCompletion(uint32_t done) {
+
+  futexWait(slot_->cq_tail, done, LIVENESS_MS);
+  if (slot_->cq_tail.load(memory_order_acquire) == done && !brokerAlive())
+    throw runtime_error("ERROR: Broker exited before completing the client's jobs.");
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+//
+// Description: Client side of the AFU broker (see broker.h). This class has
+// the same malloc/free/launch/wait shape as the AFU class, but submits jobs
+// to the broker process that owns the AFU. Any number of processes can
+// create a BrokerClient at the same time (up to broker::MAX_CLIENTS).
+//
+// Unlike the AFU class, launch() returns a job id, and several jobs can be
+// in flight at once. Jobs are executed in submission order. Once a job is
+// done, isDone() keeps returning true for it, and wait() returns
+// immediately. Both throw an exception for an id that wasn't returned by
+// launch(), or for a job that the broker rejected. launch() and wait()
+// throw an exception if the broker exits before the jobs complete.
+
+#ifndef __BROKER_CLIENT_H__
+#define __BROKER_CLIENT_H__
+
+#include <map>
+#include <set>
+
+#include "broker.h"
+
+class BrokerClient {
+
+public:
+
+  BrokerClient(const char *shm_name=broker::DEFAULT_SHM_NAME);
+  virtual ~BrokerClient();
+
+  template <class T>
+  T* malloc(size_t elements) {
+
+    return reinterpret_cast<T*>(alloc(elements*sizeof(T)));
+  }
+
+  void free(volatile void *ptr);
+
+  uint64_t launch(const volatile void *input, volatile void *output, uint64_t bytes);
+  bool isDone(uint64_t id);
+  void wait(uint64_t id);
+
+protected:
+
+  static const uint64_t ALLOC_ALIGNMENT = 4096;
+
+  uint8_t *base_;
+  broker::Header *header_;
+  broker::ClientSlot *slot_;
+  uint64_t next_id_;
+
+  // Because jobs complete in order, every id below jobs_completed_ is done.
+  // Only the ids of rejected jobs have to be stored.
+  uint64_t jobs_completed_;
+  std::set<uint64_t> rejected_;
+
+  // Free and allocated regions of this client's heap, as segment offsets.
+  std::map<uint64_t, uint64_t> free_list_, allocated_;
+
+  volatile uint8_t* alloc(size_t bytes);
+  uint64_t toOffset(const volatile void *ptr) const;
+  void reapCompletions();
+  bool brokerAlive() const;
+  void waitForCompletion(uint32_t done);
+};
+
+#endif
@@ -0,0 +1,444 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include <aio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "FileStreamer.h"
+#include "config.h"
+
+using namespace std;
+
+// The longest sleep between checks of the AFU while no disk request has
+// completed. The sleep starts at 1 us and doubles up to this limit.
+#ifdef SLEEP_WHILE_WAITING
+const chrono::microseconds MAX_BACKOFF = chrono::milliseconds(SLEEP_MS);
+#else
+const chrono::microseconds MAX_BACKOFF(100);
+#endif
+
+
+//=============================================================
+// POSIX AIO implementation of AsyncIo. This is always available, but
+// glibc implements it with a pool of threads, so it has more overhead than
+// io_uring.
+
+class PosixAio : public AsyncIo {
+
+public:
+
+  PosixAio(unsigned depth) : requests_(depth) {
+
+    for (Request &r : requests_)
+      r.active = false;
+  }
+
+  virtual ~PosixAio() {
+
+    for (Request &r : requests_) {
+      if (r.active) {
+	aio_cancel(r.cb.aio_fildes, &r.cb);
+	const struct aiocb *list[] = {&r.cb};
+	while (aio_error(&r.cb) == EINPROGRESS)
+	  aio_suspend(list, 1, nullptr);
+      }
+    }
+  }
+
+  virtual void submitRead(int fd, void *buf, size_t bytes, off_t offset, unsigned tag) {
+
+    Request &r = getRequest(fd, buf, bytes, offset, tag);
+    if (aio_read(&r.cb) != 0)
+      throw runtime_error(string("ERROR: aio_read failed: ") + strerror(errno));
+    r.active = true;
+  }
+
+  virtual void submitWrite(int fd, const void *buf, size_t bytes, off_t offset, unsigned tag) {
+
+    Request &r = getRequest(fd, const_cast<void*>(buf), bytes, offset, tag);
+    if (aio_write(&r.cb) != 0)
+      throw runtime_error(string("ERROR: aio_write failed: ") + strerror(errno));
+    r.active = true;
+  }
+
+  virtual bool complete(unsigned &tag, ssize_t &result, bool block) {
+
+    vector<const struct aiocb*> pending;
+
+    while (true) {
+      pending.clear();
+
+      for (Request &r : requests_) {
+	if (!r.active)
+	  continue;
+
+	// aio_return() only returns -1 on failure, so the error code has to
+	// come from aio_error().
+	int error = aio_error(&r.cb);
+	if (error != EINPROGRESS) {
+	  r.active = false;
+	  tag = r.tag;
+	  result = aio_return(&r.cb);
+	  if (result < 0)
+	    result = -error;
+	  return true;
+	}
+
+	pending.push_back(&r.cb);
+      }
+
+      if (!block || pending.empty())
+	return false;
+
+      // Sleep until one of the pending requests finishes. EINTR just
+      // causes another pass through the loop.
+      aio_suspend(pending.data(), pending.size(), nullptr);
+    }
+  }
+
+protected:
+
+  struct Request {
+    struct aiocb cb;
+    unsigned tag;
+    bool active;
+  };
+
+  vector<Request> requests_;
+
+  Request& getRequest(int fd, void *buf, size_t bytes, off_t offset, unsigned tag) {
+
+    for (Request &r : requests_) {
+      if (!r.active) {
+	memset(&r.cb, 0, sizeof(r.cb));
+	r.cb.aio_fildes = fd;
+	r.cb.aio_buf = buf;
+	r.cb.aio_nbytes = bytes;
+	r.cb.aio_offset = offset;
+	r.tag = tag;
+	return r;
+      }
+    }
+
+    throw runtime_error("ERROR: Too many outstanding AIO requests.");
+  }
+};
+
+
+#ifdef HAVE_LIBURING
+
+//=============================================================
+// io_uring implementation of AsyncIo.
+
+class UringIo : public AsyncIo {
+
+public:
+
+  UringIo(unsigned depth) {
+
+    int status = io_uring_queue_init(depth, &ring_, 0);
+    if (status < 0)
+      throw runtime_error(string("ERROR: io_uring_queue_init failed: ") + strerror(-status));
+  }
+
+  virtual ~UringIo() {
+
+    io_uring_queue_exit(&ring_);
+  }
+
+  virtual void submitRead(int fd, void *buf, size_t bytes, off_t offset, unsigned tag) {
+
+    io_uring_sqe *sqe = getSqe();
+    io_uring_prep_read(sqe, fd, buf, bytes, offset);
+    submit(sqe, tag);
+  }
+
+  virtual void submitWrite(int fd, const void *buf, size_t bytes, off_t offset, unsigned tag) {
+
+    io_uring_sqe *sqe = getSqe();
+    io_uring_prep_write(sqe, fd, buf, bytes, offset);
+    submit(sqe, tag);
+  }
+
+  virtual bool complete(unsigned &tag, ssize_t &result, bool block) {
+
+    io_uring_cqe *cqe;
+    int status = block ? io_uring_wait_cqe(&ring_, &cqe) : io_uring_peek_cqe(&ring_, &cqe);
+    if (status == -EAGAIN)
+      return false;
+    if (status < 0)
+      throw runtime_error(string("ERROR: io_uring completion failed: ") + strerror(-status));
+
+    tag = (unsigned) (uintptr_t) io_uring_cqe_get_data(cqe);
+    result = cqe->res;
+    io_uring_cqe_seen(&ring_, cqe);
+    return true;
+  }
+
+protected:
+
+  io_uring ring_;
+
+  io_uring_sqe* getSqe() {
+
+    io_uring_sqe *sqe = io_uring_get_sqe(&ring_);
+    if (sqe == nullptr)
+      throw runtime_error("ERROR: io_uring submission queue is full.");
+    return sqe;
+  }
+
+  void submit(io_uring_sqe *sqe, unsigned tag) {
+
+    io_uring_sqe_set_data(sqe, (void*) (uintptr_t) tag);
+    int status = io_uring_submit(&ring_);
+    if (status < 0)
+      throw runtime_error(string("ERROR: io_uring_submit failed: ") + strerror(-status));
+  }
+};
+
+#endif
+
+
+unique_ptr<AsyncIo> AsyncIo::create(unsigned depth) {
+
+#ifdef HAVE_LIBURING
+  try {
+    return unique_ptr<AsyncIo>(new UringIo(depth));
+  }
+  catch (const runtime_error &e) {
+    // Kernels without io_uring (or with it disabled) fall back to AIO.
+    cerr << e.what() << " Using POSIX AIO instead." << endl;
+  }
+#endif
+
+  return unique_ptr<AsyncIo>(new PosixAio(depth));
+}
+
+
+//=============================================================
+// FileStreamer
+
+FileStreamer::FileStreamer(AFU &afu, size_t chunk_bytes, unsigned ratio, unsigned depth) :
+  afu_(afu), chunk_bytes_(chunk_bytes), ratio_(ratio), slots_(depth) {
+
+  if (ratio == 0 || depth == 0)
+    throw runtime_error("ERROR: FileStreamer requires a positive ratio and depth.");
+
+  // Every chunk, and the output it produces, must be a multiple of the
+  // O_DIRECT alignment. This also guarantees that every chunk except the
+  // last one contains a multiple of ratio cache lines.
+  size_t alignment = IO_ALIGNMENT * ratio;
+  if (chunk_bytes == 0 || chunk_bytes % alignment != 0)
+    throw runtime_error("ERROR: FileStreamer chunk size must be a multiple of " + to_string(alignment) + " bytes.");
+
+  for (Slot &s : slots_) {
+    s.input = afu_.malloc<volatile uint8_t>(chunk_bytes_);
+    s.output = afu_.malloc<volatile uint8_t>(chunk_bytes_ / ratio_);
+    s.state = SLOT_FREE;
+  }
+
+  // Every slot can have a read and a write outstanding.
+  io_ = AsyncIo::create(depth * 2);
+}
+
+
+FileStreamer::~FileStreamer() {
+
+  // Wait for outstanding requests before the buffers disappear.
+  io_.reset();
+
+  for (Slot &s : slots_) {
+    afu_.free(s.input);
+    afu_.free(s.output);
+  }
+}
+
+
+uint64_t FileStreamer::run(const char *input_file, const char *output_file) {
+
+  int in_fd = openDirect(input_file, O_RDONLY);
+  int out_fd = openDirect(output_file, O_WRONLY | O_CREAT | O_TRUNC);
+
+  struct stat in_stat;
+  if (fstat(in_fd, &in_stat) != 0) {
+    close(in_fd);
+    close(out_fd);
+    throw runtime_error(string("ERROR: Can't stat ") + input_file);
+  }
+
+  uint64_t total_bytes = in_stat.st_size;
+  uint64_t num_chunks = (total_bytes + chunk_bytes_ - 1) / chunk_bytes_;
+  uint64_t next_read = 0, next_run = 0, writes_done = 0;
+  unsigned depth = slots_.size();
+  unsigned tag;
+  ssize_t result;
+
+  for (Slot &s : slots_)
+    s.state = SLOT_FREE;
+
+  try {
+    while (writes_done < num_chunks) {
+
+      // Start reading upcoming chunks into any slots that are free.
+      while (next_read < num_chunks && slots_[next_read % depth].state == SLOT_FREE) {
+	Slot &s = slots_[next_read % depth];
+	s.chunk = next_read;
+	s.state = SLOT_READING;
+	s.expected_bytes = min<uint64_t>(chunk_bytes_, total_bytes - next_read * chunk_bytes_);
+	io_->submitRead(in_fd, const_cast<uint8_t*>(s.input), chunk_bytes_,
+			next_read * chunk_bytes_, (next_read % depth) * 2);
+	next_read++;
+      }
+
+      // Run the AFU on the next chunk as soon as its data has arrived.
+      Slot &s = slots_[next_run % depth];
+      if (next_run < num_chunks && s.state == SLOT_READY) {
+	launch(s);
+
+	// Service disk reads and writes for other chunks while the AFU is
+	// busy. When no request has completed, back off instead of spinning
+	// on the AFU's status.
+	chrono::microseconds backoff(1);
+	while (!afu_.isDone()) {
+	  if (io_->complete(tag, result, false)) {
+	    writes_done += handleCompletion(tag, result);
+	    backoff = chrono::microseconds(1);
+	  }
+	  else {
+	    this_thread::sleep_for(backoff);
+	    backoff = min(backoff * 2, MAX_BACKOFF);
+	  }
+	}
+
+	// Round up to the O_DIRECT alignment. The file is truncated to its
+	// exact size at the end.
+	size_t out_bytes = outputBytes(s.in_bytes);
+	out_bytes = (out_bytes + IO_ALIGNMENT - 1) & -IO_ALIGNMENT;
+
+	s.state = SLOT_WRITING;
+	s.expected_bytes = out_bytes;
+	io_->submitWrite(out_fd, const_cast<uint8_t*>(s.output), out_bytes,
+			 s.chunk * (chunk_bytes_ / ratio_), (next_run % depth) * 2 + 1);
+	next_run++;
+	continue;
+      }
+
+      // Nothing else can make progress until a disk request completes.
+      if (io_->complete(tag, result, true))
+	writes_done += handleCompletion(tag, result);
+    }
+
+    if (ftruncate(out_fd, outputBytes(total_bytes)) != 0)
+      throw runtime_error(string("ERROR: Can't resize ") + output_file);
+  }
+  catch (...) {
+    // Drain outstanding requests so the buffers can be reused.
+    io_.reset();
+    io_ = AsyncIo::create(depth * 2);
+    close(in_fd);
+    close(out_fd);
+    throw;
+  }
+
+  close(in_fd);
+  close(out_fd);
+  return total_bytes;
+}
+
+
+int FileStreamer::openDirect(const char *name, int flags) {
+
+  int fd = open(name, flags | O_DIRECT, 0644);
+
+  // Some file systems (e.g. tmpfs) don't support O_DIRECT, in which case
+  // the page cache is used instead.
+  if (fd < 0 && errno == EINVAL) {
+    cerr << "WARNING: " << name << " does not support O_DIRECT." << endl;
+    fd = open(name, flags, 0644);
+  }
+
+  if (fd < 0)
+    throw runtime_error(string("ERROR: Can't open ") + name + ": " + strerror(errno));
+
+  return fd;
+}
+
+
+size_t FileStreamer::outputBytes(size_t in_bytes) const {
+
+  // The loopback copies every byte. The pipelines produce one output for
+  // every (possibly partial) input cache line.
+  if (ratio_ == 1)
+    return in_bytes;
+
+  return (in_bytes + AFU::CL_BYTES - 1) / AFU::CL_BYTES * (AFU::CL_BYTES / ratio_);
+}
+
+
+void FileStreamer::launch(Slot &slot) {
+
+  // The DMA only transfers complete cache lines, and the pipelines only
+  // write complete output cache lines, so the AFU is given a multiple of
+  // ratio cache lines. The padding is cleared so it can't affect the
+  // results. This only happens for the last chunk.
+  uint64_t num_cls = (slot.in_bytes + AFU::CL_BYTES - 1) / AFU::CL_BYTES;
+  num_cls = (num_cls + ratio_ - 1) / ratio_ * ratio_;
+
+  for (size_t i=slot.in_bytes; i < num_cls * AFU::CL_BYTES; i++)
+    slot.input[i] = 0;
+
+  afu_.launch(slot.input, slot.output, num_cls * AFU::CL_BYTES);
+}
+
+
+unsigned FileStreamer::handleCompletion(unsigned tag, ssize_t result) {
+
+  Slot &s = slots_[tag / 2];
+  bool is_write = tag % 2;
+
+  if (result < 0)
+    throw runtime_error(string("ERROR: File ") + (is_write ? "write" : "read") + " failed: " + strerror(-result));
+
+  // Reads are only short for the last chunk, where expected_bytes is the
+  // rest of the file. Any other short transfer would shift the offsets of
+  // the following chunks, so it is treated as an error.
+  if ((size_t) result != s.expected_bytes)
+    throw runtime_error(string("ERROR: Short file ") + (is_write ? "write" : "read") + " of chunk " + to_string(s.chunk) + " (" + to_string(result) + " of " + to_string(s.expected_bytes) + " bytes).");
+
+  if (is_write) {
+    s.state = SLOT_FREE;
+    return 1;
+  }
+
+  s.in_bytes = result;
+  s.state = SLOT_READY;
+  return 0;
+}
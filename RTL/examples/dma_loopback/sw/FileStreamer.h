@@ -0,0 +1,108 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+//
+// Description: Streams a file through a DMA AFU (e.g. dma_loopback,
+// simple_pipeline, float_pipeline) and writes the results to another file.
+//
+// File extents are read with O_DIRECT directly into buffers allocated with
+// AFU::malloc(), so the data is never copied by the CPU. The reads and
+// writes are issued asynchronously (io_uring when compiled with
+// HAVE_LIBURING, POSIX AIO otherwise), which allows disk reads of upcoming
+// chunks and writeback of previous chunks to overlap with the AFU
+// processing the current chunk.
+
+#ifndef __FILE_STREAMER_H__
+#define __FILE_STREAMER_H__
+
+#include <memory>
+#include <vector>
+#include <sys/types.h>
+
+#include "AFU.h"
+
+
+// Minimal asynchronous file I/O interface. Every request is identified by
+// a tag provided by the caller, which is returned on completion.
+class AsyncIo {
+
+public:
+
+  virtual ~AsyncIo() {}
+
+  virtual void submitRead(int fd, void *buf, size_t bytes, off_t offset, unsigned tag) = 0;
+  virtual void submitWrite(int fd, const void *buf, size_t bytes, off_t offset, unsigned tag) = 0;
+
+  // Returns true and the tag/result of a completed request. If block is
+  // false, returns false when no request has completed yet.
+  virtual bool complete(unsigned &tag, ssize_t &result, bool block) = 0;
+
+  // Creates the best available implementation supporting depth
+  // simultaneous requests.
+  static std::unique_ptr<AsyncIo> create(unsigned depth);
+};
+
+
+class FileStreamer {
+
+public:
+
+  // Every chunk size must be a multiple of this for O_DIRECT.
+  static const size_t IO_ALIGNMENT = 4096;
+  static const size_t DEFAULT_CHUNK_BYTES = 1 << 24;
+  static const unsigned DEFAULT_DEPTH = 3;
+
+  // ratio is the number of input bytes consumed for every output byte
+  // written by the AFU (1 for dma_loopback, 8 for simple_pipeline, 16 for
+  // float_pipeline). depth is the number of chunks in flight.
+  FileStreamer(AFU &afu, size_t chunk_bytes=DEFAULT_CHUNK_BYTES,
+	       unsigned ratio=1, unsigned depth=DEFAULT_DEPTH);
+  virtual ~FileStreamer();
+
+  // Streams the entire input file through the AFU into the output file.
+  // Returns the number of input bytes processed.
+  uint64_t run(const char *input_file, const char *output_file);
+
+protected:
+
+  enum SlotState {SLOT_FREE, SLOT_READING, SLOT_READY, SLOT_WRITING};
+
+  struct Slot {
+    volatile uint8_t *input;
+    volatile uint8_t *output;
+    SlotState state;
+    uint64_t chunk;
+    size_t in_bytes;
+
+    // The number of bytes the outstanding read or write must transfer.
+    size_t expected_bytes;
+  };
+
+  AFU &afu_;
+  size_t chunk_bytes_;
+  unsigned ratio_;
+  std::vector<Slot> slots_;
+  std::unique_ptr<AsyncIo> io_;
+
+  // Methods
+  static int openDirect(const char *name, int flags);
+  size_t outputBytes(size_t in_bytes) const;
+  void launch(Slot &slot);
+  unsigned handleCompletion(unsigned tag, ssize_t result);
+};
+
+#endif
@@ -0,0 +1,325 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+//
+// Description: This application is a broker daemon that owns the AFU and
+// executes DMA jobs submitted by other processes through shared memory
+// (see broker.h and BrokerClient.h). Clients are served round robin, one
+// job at a time.
+//
+// To test without an FPGA, run broker_ase with the dma_loopback simulation,
+// and then run one or more ./client processes.
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <grp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <opae/utils.h>
+
+#include "AFU.h"
+#include "broker.h"
+// Auto-generated by OPAE's afu_json_mgr script
+#include "afu_json_info.h"
+
+using namespace std;
+using namespace broker;
+
+
+volatile sig_atomic_t running = 1;
+
+void handleSignal(int) {
+
+  running = 0;
+}
+
+// Bounds of a client's heap. The broker keeps its own copy, because
+// clients can write anything into the shared slots.
+struct Heap {
+  uint64_t offset;
+  uint64_t bytes;
+};
+
+void printUsage(char *name);
+bool checkUsage(int argc, char *argv[], unsigned long &heap_mb, const char* &shm_name, const char* &group);
+bool isValid(const Heap &heap, const Job &job);
+bool serveClient(AFU &afu, uint8_t *base, ClientSlot &slot, const Heap &heap);
+
+int main(int argc, char *argv[]) {
+
+  unsigned long heap_mb;
+  const char* shm_name;
+  const char* group;
+  if (!checkUsage(argc, argv, heap_mb, shm_name, group)) {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // Only the broker's user, and optionally the members of one group, can
+  // access the segment.
+  struct group *grp = nullptr;
+  if (group != nullptr && (grp = getgrnam(group)) == nullptr) {
+    cerr << "ERROR: Unknown group " << group << "." << endl;
+    return EXIT_FAILURE;
+  }
+
+  uint64_t heap_bytes = (heap_mb << 20) & -HEAP_ALIGNMENT;
+  uint64_t segment_bytes = heapStart() + heap_bytes * MAX_CLIENTS;
+
+  // Create the shared-memory segment. Any existing segment either belongs
+  // to another broker or was left behind by a broker that crashed, so the
+  // user has to decide what to do with it.
+  int fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    cerr << "ERROR: Can't create " << shm_name << ": " << strerror(errno)
+	 << ". If no broker is running, delete /dev/shm" << shm_name << endl;
+    return EXIT_FAILURE;
+  }
+
+  // The umask doesn't affect fchmod().
+  if (grp != nullptr && (fchown(fd, -1, grp->gr_gid) != 0 || fchmod(fd, 0660) != 0)) {
+    cerr << "ERROR: Can't give group " << group << " access to shared memory: "
+	 << strerror(errno) << endl;
+    close(fd);
+    shm_unlink(shm_name);
+    return EXIT_FAILURE;
+  }
+
+  if (ftruncate(fd, segment_bytes) != 0) {
+    cerr << "ERROR: Can't resize shared memory: " << strerror(errno) << endl;
+    close(fd);
+    shm_unlink(shm_name);
+    return EXIT_FAILURE;
+  }
+
+  void *ptr = mmap(nullptr, segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    cerr << "ERROR: Can't map shared memory: " << strerror(errno) << endl;
+    shm_unlink(shm_name);
+    return EXIT_FAILURE;
+  }
+
+  uint8_t *base = reinterpret_cast<uint8_t*>(ptr);
+  Header *header = reinterpret_cast<Header*>(ptr);
+  Heap heaps[MAX_CLIENTS];
+
+  // Install the handlers without SA_RESTART, so a signal interrupts the
+  // futex wait and the broker can clean up the shared memory.
+  struct sigaction action = {};
+  action.sa_handler = handleSignal;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  int exit_status = EXIT_FAILURE;
+
+  try {
+    AFU afu(AFU_ACCEL_UUID);
+
+    // Pin the entire segment, so every client buffer is accessible to the
+    // AFU without any copies.
+    afu.registerBuffer(base, segment_bytes);
+
+    header->segment_bytes = segment_bytes;
+    header->broker_pid.store(getpid());
+    header->doorbell.store(0);
+    for (unsigned i=0; i < MAX_CLIENTS; i++) {
+      heaps[i] = {heapStart() + i * heap_bytes, heap_bytes};
+      header->clients[i].state.store(SLOT_FREE);
+      header->clients[i].pid.store(0);
+      header->clients[i].heap_offset = heaps[i].offset;
+      header->clients[i].heap_bytes = heaps[i].bytes;
+    }
+
+    // Clients check the magic number to know when the broker is ready.
+    atomic_thread_fence(memory_order_release);
+    header->magic = MAGIC;
+    cout << "Broker ready with " << MAX_CLIENTS << " client slots of "
+	 << (heap_bytes >> 20) << " MB." << endl;
+
+    while (running) {
+
+      // Read the doorbell before looking for work, so any job submitted
+      // after this point prevents the futex from sleeping.
+      uint32_t doorbell = header->doorbell.load(memory_order_acquire);
+      bool found_job = false;
+
+      for (unsigned i=0; i < MAX_CLIENTS; i++) {
+	ClientSlot &slot = header->clients[i];
+	int32_t pid = slot.pid.load(memory_order_acquire);
+	if (pid <= 0)
+	  continue;
+
+	// Release the slots of clients that exited without cleaning up, even
+	// if they died before activating the slot. The compare-exchange fails
+	// if the client released the slot and another client claimed it.
+	if (kill(pid, 0) != 0 && errno == ESRCH) {
+	  if (slot.pid.compare_exchange_strong(pid, PID_RECLAIMING)) {
+	    slot.state.store(SLOT_FREE, memory_order_release);
+	    slot.pid.store(0, memory_order_release);
+	  }
+	  continue;
+	}
+
+	if (slot.state.load(memory_order_acquire) != SLOT_ACTIVE)
+	  continue;
+
+	found_job |= serveClient(afu, base, slot, heaps[i]);
+      }
+
+      if (!found_job)
+	futexWait(header->doorbell, doorbell);
+    }
+
+    afu.unregisterBuffer(base);
+    exit_status = EXIT_SUCCESS;
+  }
+  // Exception handling for all the runtime errors that can occur within
+  // the AFU wrapper class.
+  catch (const fpga_result& e) {
+
+    // Provide more meaningful error messages for each exception.
+    if (e == FPGA_BUSY) {
+      cerr << "ERROR: All FPGAs busy." << endl;
+    }
+    else if (e == FPGA_NOT_FOUND) {
+      cerr << "ERROR: FPGA with accelerator " << AFU_ACCEL_UUID
+	   << " not found." << endl;
+    }
+    else {
+      // Print the default error string for the remaining fpga_result types.
+      cerr << "ERROR: " << fpgaErrStr(e) << endl;
+    }
+  }
+  catch (const runtime_error& e) {
+    cerr << e.what() << endl;
+  }
+  catch (const opae::fpga::types::no_driver& e) {
+    cerr << "ERROR: No FPGA driver found." << endl;
+  }
+
+  // Tell any waiting clients that their jobs will never complete.
+  header->broker_pid.store(0, memory_order_release);
+  for (ClientSlot &slot : header->clients)
+    futexWake(slot.cq_tail);
+
+  munmap(base, segment_bytes);
+  shm_unlink(shm_name);
+  return exit_status;
+}
+
+
+// Executes the next job from the client's submission ring, if there is one.
+bool serveClient(AFU &afu, uint8_t *base, ClientSlot &slot, const Heap &heap) {
+
+  uint32_t head = slot.sq_head.load(memory_order_relaxed);
+  if (head == slot.sq_tail.load(memory_order_acquire))
+    return false;
+
+  Job job = slot.sq[head & (RING_ENTRIES-1)];
+  slot.sq_head.store(head + 1, memory_order_release);
+
+  int64_t status = JOB_INVALID;
+  if (isValid(heap, job)) {
+    afu.launch(base + job.input, base + job.output, job.bytes);
+    afu.wait();
+    status = JOB_OK;
+  }
+
+  // The client never has more unreaped jobs than ring entries, so there is
+  // always space in the completion ring.
+  uint32_t tail = slot.cq_tail.load(memory_order_relaxed);
+  slot.cq[tail & (RING_ENTRIES-1)] = {job.id, status};
+  slot.cq_tail.store(tail + 1, memory_order_release);
+  futexWake(slot.cq_tail);
+  return true;
+}
+
+
+// Clients can only access their own heap. Every value in the job comes
+// from the client, so the comparisons are arranged to avoid overflow.
+bool isValid(const Heap &heap, const Job &job) {
+
+  if (job.bytes == 0 || job.bytes > heap.bytes)
+    return false;
+
+  // The AFU reads the entire last cache line. Heaps are a multiple of
+  // HEAP_ALIGNMENT, so the rounded size still fits.
+  uint64_t bytes = (job.bytes + AFU::CL_BYTES - 1) & -(uint64_t) AFU::CL_BYTES;
+
+  return job.input >= heap.offset && job.input - heap.offset <= heap.bytes - bytes &&
+    job.output >= heap.offset && job.output - heap.offset <= heap.bytes - bytes;
+}
+
+
+void printUsage(char *name) {
+
+  cout << "Usage: " << name << " [heap_mb [shm_name [group]]]\n"
+       << "heap_mb (positive integer amount of shared memory per client in MB, default "
+       << (DEFAULT_HEAP_BYTES >> 20) << ")\n"
+       << "shm_name (name of the shared-memory segment, default " << DEFAULT_SHM_NAME << ")\n"
+       << "group (group whose members can run clients, default only the broker's user)"
+       << endl;
+}
+
+// Returns unsigned long representation of string str.
+// Throws an exception if str is not a positive integer.
+unsigned long stringToPositiveInt(char *str) {
+
+  char *p;
+  long num = strtol(str, &p, 10);
+  if (p != 0 && *p == '\0' && num > 0) {
+    return num;
+  }
+
+  throw runtime_error("String is not a positive integer.");
+  return 0;
+}
+
+
+bool checkUsage(int argc, char *argv[], unsigned long &heap_mb, const char* &shm_name, const char* &group) {
+
+  heap_mb = DEFAULT_HEAP_BYTES >> 20;
+  shm_name = DEFAULT_SHM_NAME;
+  group = nullptr;
+
+  if (argc > 4)
+    return false;
+
+  try {
+    if (argc > 1)
+      heap_mb = stringToPositiveInt(argv[1]);
+  }
+  catch (const runtime_error& e) {
+    return false;
+  }
+
+  if (argc > 2)
+    shm_name = argv[2];
+
+  if (argc > 3)
+    group = argv[3];
+
+  // Each client heap is a multiple of 2MB.
+  return heap_mb >= 2;
+}
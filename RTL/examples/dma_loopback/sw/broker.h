@@ -0,0 +1,141 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+//
+// Description: Layout of the shared-memory segment used by the AFU broker
+// (broker.cpp) and its clients (BrokerClient.h).
+//
+// Only one process can open an AFU, so the broker opens it and executes
+// jobs on behalf of any number of client processes. The broker creates a
+// single POSIX shared-memory segment and registers the entire segment with
+// the AFU (AFU::registerBuffer()). Every client maps the same segment, so
+// data that a client places in its part of the segment can be read and
+// written directly by the AFU without any copies.
+//
+// The segment starts with a header containing one slot per client. Each
+// slot has a submission ring (written by the client, read by the broker)
+// and a completion ring (written by the broker, read by the client). The
+// remainder of the segment is divided into equal heaps, one per client
+// slot, from which the client allocates its buffers. Because the segment
+// is mapped at a different virtual address in every process, jobs refer to
+// buffers by their byte offset within the segment.
+//
+// Both sides sleep on futexes in the shared segment when there is nothing
+// to do: the broker on the doorbell, and clients on their completion tail.
+// Clients sleep for at most LIVENESS_MS at a time, and then check that the
+// broker process still exists, so they don't wait forever on a broker that
+// crashed.
+
+#ifndef __BROKER_H__
+#define __BROKER_H__
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace broker {
+
+  const char* const DEFAULT_SHM_NAME = "/afu_broker";
+  const uint32_t MAGIC = 0x41465542;
+  const unsigned MAX_CLIENTS = 16;
+
+  // Must be a power of 2.
+  const unsigned RING_ENTRIES = 64;
+
+  // Client heaps start on a 2MB boundary.
+  const uint64_t HEAP_ALIGNMENT = 1 << 21;
+  const uint64_t DEFAULT_HEAP_BYTES = 1 << 26;
+
+  // Maximum time a client sleeps before checking that the broker exists.
+  const unsigned LIVENESS_MS = 100;
+
+  enum SlotState {SLOT_FREE=0, SLOT_ACTIVE};
+
+  // Slot owner while the broker releases the slot of a dead client.
+  const int32_t PID_RECLAIMING = -1;
+  enum JobStatus {JOB_OK=0, JOB_INVALID=-1};
+
+  struct Job {
+    uint64_t id;
+    uint64_t input;   // Segment offset
+    uint64_t output;  // Segment offset
+    uint64_t bytes;
+  };
+
+  struct Completion {
+    uint64_t id;
+    int64_t status;
+  };
+
+  // The indices are free-running counters, which are masked to access the
+  // rings. Indices written by different processes are kept in separate
+  // cache lines.
+  //
+  // A client claims a free slot by changing pid from 0 to its own pid, and
+  // then activates the slot once the rings are reset. Because the pid is
+  // written by the claim itself, the broker can release the slot of a
+  // client that dies at any point.
+  struct alignas(64) ClientSlot {
+    std::atomic<uint32_t> state;
+    std::atomic<int32_t> pid;
+    uint64_t heap_offset;
+    uint64_t heap_bytes;
+
+    alignas(64) std::atomic<uint32_t> sq_head;
+    alignas(64) std::atomic<uint32_t> sq_tail;
+    Job sq[RING_ENTRIES];
+
+    alignas(64) std::atomic<uint32_t> cq_head;
+    alignas(64) std::atomic<uint32_t> cq_tail;
+    Completion cq[RING_ENTRIES];
+  };
+
+  struct alignas(64) Header {
+    uint32_t magic;
+    uint64_t segment_bytes;
+    // Cleared when the broker exits.
+    std::atomic<int32_t> broker_pid;
+    std::atomic<uint32_t> doorbell;
+    ClientSlot clients[MAX_CLIENTS];
+  };
+
+  inline uint64_t heapStart() {
+
+    return (sizeof(Header) + HEAP_ALIGNMENT - 1) & -HEAP_ALIGNMENT;
+  }
+
+  // Futexes work across processes when the word is in a shared mapping
+  // (i.e. when the FUTEX_PRIVATE_FLAG is not used). A timeout_ms of 0
+  // waits without a timeout.
+  inline void futexWait(std::atomic<uint32_t> &word, uint32_t expected, unsigned timeout_ms=0) {
+
+    struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected,
+	    timeout_ms == 0 ? nullptr : &timeout, nullptr, 0);
+  }
+
+  inline void futexWake(std::atomic<uint32_t> &word) {
+
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+  }
+}
+
+#endif
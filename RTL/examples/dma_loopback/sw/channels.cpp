@@ -0,0 +1,184 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+//
+// Description: This application runs a DMA job on each DMA channel of the
+// AFU at the same time, where each channel is accessed through its own AFU
+// object.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <opae/utils.h>
+
+#include "AFU.h"
+// Contains application-specific information
+#include "config.h"
+// Auto-generated by OPAE's afu_json_mgr script
+#include "afu_json_info.h"
+
+using namespace std;
+
+
+void printUsage(char *name);
+bool checkUsage(int argc, char *argv[], unsigned long &size, unsigned long &num_channels);
+
+int main(int argc, char *argv[]) {
+
+  unsigned long size, num_channels;
+  if (!checkUsage(argc, argv, size, num_channels)) {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  try {
+    AFU afu(AFU_ACCEL_UUID);
+
+    // Channel 0 is the original AFU object.
+    vector<unique_ptr<AFU>> extra_channels;
+    vector<AFU*> channels = {&afu};
+    for (unsigned i=1; i < num_channels; i++) {
+      extra_channels.emplace_back(new AFU(afu, i));
+      channels.push_back(extra_channels.back().get());
+    }
+
+    vector<volatile dma_data_t*> inputs, outputs;
+    for (AFU *channel : channels) {
+      auto input  = channel->malloc<dma_data_t>(size);
+      auto output = channel->malloc<dma_data_t>(size);
+
+      for (uint64_t i=0; i < size; i++) {
+	input[i] = (dma_data_t) rand();
+	output[i] = 0;
+      }
+
+      inputs.push_back(input);
+      outputs.push_back(output);
+    }
+
+    // Start every channel before waiting for any of them.
+    auto start_time = chrono::steady_clock::now();
+    for (unsigned i=0; i < num_channels; i++)
+      channels[i]->launch(inputs[i], outputs[i], size*sizeof(dma_data_t));
+
+    for (AFU *channel : channels)
+      channel->wait();
+
+    chrono::duration<double> seconds = chrono::steady_clock::now() - start_time;
+
+    bool failed = false;
+    for (unsigned i=0; i < num_channels; i++) {
+      uint64_t errors = 0;
+      for (uint64_t j=0; j < size; j++) {
+	if (outputs[i][j] != inputs[i][j]) {
+	  errors++;
+	}
+      }
+
+      if (errors > 0) {
+	cout << "Channel " << i << " failed with " << errors << " errors." << endl;
+	failed = true;
+      }
+
+      channels[i]->free(inputs[i]);
+      channels[i]->free(outputs[i]);
+    }
+
+    if (failed)
+      return EXIT_FAILURE;
+
+    // Each byte is both read and written.
+    cout << "All " << num_channels << " channels successful ("
+	 << 2*size*sizeof(dma_data_t)*num_channels / seconds.count() / 1e9
+	 << " GB/s total)." << endl;
+    return EXIT_SUCCESS;
+  }
+  // Exception handling for all the runtime errors that can occur within
+  // the AFU wrapper class.
+  catch (const fpga_result& e) {
+
+    // Provide more meaningful error messages for each exception.
+    if (e == FPGA_BUSY) {
+      cerr << "ERROR: All FPGAs busy." << endl;
+    }
+    else if (e == FPGA_NOT_FOUND) {
+      cerr << "ERROR: FPGA with accelerator " << AFU_ACCEL_UUID
+	   << " not found." << endl;
+    }
+    else {
+      // Print the default error string for the remaining fpga_result types.
+      cerr << "ERROR: " << fpgaErrStr(e) << endl;
+    }
+  }
+  catch (const runtime_error& e) {
+    cerr << e.what() << endl;
+  }
+  catch (const opae::fpga::types::no_driver& e) {
+    cerr << "ERROR: No FPGA driver found." << endl;
+  }
+
+  return EXIT_FAILURE;
+}
+
+
+void printUsage(char *name) {
+
+  cout << "Usage: " << name << " size [num_channels]\n"
+       << "size (positive integer amount of dma_data_t to transfer per channel)\n"
+       << "num_channels (positive integer amount of DMA channels to use, default 2)"
+       << endl;
+}
+
+// Returns unsigned long representation of string str.
+// Throws an exception if str is not a positive integer.
+unsigned long stringToPositiveInt(char *str) {
+
+  char *p;
+  long num = strtol(str, &p, 10);
+  if (p != 0 && *p == '\0' && num > 0) {
+    return num;
+  }
+
+  throw runtime_error("String is not a positive integer.");
+  return 0;
+}
+
+
+bool checkUsage(int argc, char *argv[],
+		unsigned long &size, unsigned long &num_channels) {
+
+  num_channels = 2;
+  
+  if (argc == 2 || argc == 3) {
+    try {
+      size = stringToPositiveInt(argv[1]);
+      if (argc == 3)
+	num_channels = stringToPositiveInt(argv[2]);
+    }
+    catch (const runtime_error& e) {
+      return false;
+    }
+  }
+  else {
+    return false;
+  }
+
+  return num_channels <= AFU::MAX_DMA_CHANNELS;
+}
@@ -0,0 +1,149 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+//
+// Description: This application performs the same tests as main.cpp, but
+// submits the DMA transfers to a running broker (see broker.cpp) instead of
+// opening the AFU directly. All of the tests are submitted before waiting
+// for any of them, and any number of client processes can run at the same
+// time.
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "BrokerClient.h"
+// Contains application-specific information
+#include "config.h"
+
+using namespace std;
+
+
+void printUsage(char *name);
+bool checkUsage(int argc, char *argv[], unsigned long &size, unsigned long &num_tests);
+
+int main(int argc, char *argv[]) {
+
+  unsigned long size, num_tests;
+  if (!checkUsage(argc, argv, size, num_tests)) {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  try {
+    BrokerClient client;
+    vector<volatile dma_data_t*> inputs, outputs;
+    vector<uint64_t> jobs;
+    bool failed = false;
+
+    // Allocate and initialize memory from the client's part of the broker's
+    // shared memory, and submit every test.
+    for (unsigned test=0; test < num_tests; test++) {
+      auto input = client.malloc<volatile dma_data_t>(size);
+      auto output = client.malloc<volatile dma_data_t>(size);
+
+      for (uint64_t i=0; i < size; i++) {
+	input[i] = (dma_data_t) rand();
+	output[i] = 0;
+      }
+
+      inputs.push_back(input);
+      outputs.push_back(output);
+      jobs.push_back(client.launch(input, output, size*sizeof(dma_data_t)));
+    }
+
+    for (unsigned test=0; test < num_tests; test++) {
+      cout << "Test " << test << "...";
+      client.wait(jobs[test]);
+
+      uint64_t errors = 0;
+      for (uint64_t i=0; i < size; i++) {
+	if (outputs[test][i] != inputs[test][i]) {
+	  errors++;
+	}
+      }
+
+      if (errors > 0) {
+	cout << "Failed with " << errors << " errors." << endl;
+	failed = true;
+      }
+      else {
+	cout << "Succeeded." << endl;
+      }
+
+      client.free(inputs[test]);
+      client.free(outputs[test]);
+    }
+
+    if (failed) {
+      cout << "DMA tests failed." << endl;
+      return EXIT_FAILURE;
+    }
+
+    cout << "All DMA Tests Successful!!!" << endl;
+    return EXIT_SUCCESS;
+  }
+  catch (const runtime_error& e) {
+    cerr << e.what() << endl;
+  }
+
+  return EXIT_FAILURE;
+}
+
+
+void printUsage(char *name) {
+
+  cout << "Usage: " << name << " size num_tests\n"
+       << "size (positive integer amount of dma_data_t to transfer)\n"
+       << "num_tests (positive integer amount of \"size\" DMA tests to run)"
+       << endl;
+}
+
+// Returns unsigned long representation of string str.
+// Throws an exception if str is not a positive integer.
+unsigned long stringToPositiveInt(char *str) {
+
+  char *p;
+  long num = strtol(str, &p, 10);
+  if (p != 0 && *p == '\0' && num > 0) {
+    return num;
+  }
+
+  throw runtime_error("String is not a positive integer.");
+  return 0;
+}
+
+
+bool checkUsage(int argc, char *argv[],
+		unsigned long &size, unsigned long &num_tests) {
+
+  if (argc == 3) {
+    try {
+      size = stringToPositiveInt(argv[1]);
+      num_tests = stringToPositiveInt(argv[2]);
+    }
+    catch (const runtime_error& e) {
+      return false;
+    }
+  }
+  else {
+    return false;
+  }
+
+  return true;
+}
@@ -30,6 +30,16 @@ typedef volatile int dma_data_t;
 // The number of milliseconds to sleep when SLEEP_WHILE_WAITING is defined.
 const unsigned SLEEP_MS = 10;
 
+// By default, main.cpp verifies each transfer by comparing the AFU's CRCs of
+// the read and written data with a CRC computed by software, which avoids
+// reading the output array. Defining this flag also compares every element
+// of the output array with the input array.
+//#define VERIFY_OUTPUT_ARRAY
+
+// Defining this flag prints the AFU's DMA performance counters after each
+// transfer, which shows why a transfer is slower than expected.
+//#define PRINT_PERF_COUNTERS
+
 
 //=============================================================
 // AFU MMIO Addresses
@@ -40,7 +50,49 @@ enum MmioAddr {
   MMIO_RD_ADDR=0x0052,
   MMIO_WR_ADDR=0x0054,
   MMIO_SIZE=0x0056,
-  MMIO_DONE=0x0058
+  MMIO_DONE=0x0058,
+  // Writing any value to MMIO_RD_CRC clears both CRCs.
+  MMIO_RD_CRC=0x005A,
+  MMIO_WR_CRC=0x005C,
+  MMIO_BURST_LEN=0x005E,
+  MMIO_RING_ADDR=0x0060,
+  MMIO_RING_ENTRIES=0x0062,
+  // Writing MMIO_RING_TAIL is the descriptor ring's doorbell.
+  MMIO_RING_TAIL=0x0064,
+  MMIO_RING_HEAD=0x0066,
+  MMIO_STATUS_ADDR=0x006C,
+  MMIO_JOB_COUNT=0x006E,
+  // Writing MMIO_BYTES sets the size in bytes instead of cache lines.
+  MMIO_BYTES=0x0070,
+  // The performance counters are at consecutive 64-bit addresses.
+  MMIO_PERF=0x0080,
+  MMIO_VC_POLICY=0x0098,
+  MMIO_CACHE_HINTS=0x009A,
+  // The 2D shapes of reads and writes in cache lines.
+  MMIO_RD_ROW_SIZE=0x009C,
+  MMIO_RD_PITCH=0x009E,
+  MMIO_WR_ROW_SIZE=0x00A0,
+  MMIO_WR_PITCH=0x00A2,
+  // The number of queued jobs (bits 31:0) and the job queue's capacity
+  // (bits 63:32).
+  MMIO_JOB_QUEUE=0x00A4,
+  MMIO_JOBS_COMPLETED=0x00A6,
+  // The last performance counter, which doesn't follow the others.
+  MMIO_PERF_ARB=0x00A8
+};
+
+// The registers of DMA channel i start at MMIO_CHANNEL_WORDS*i words after
+// the addresses above (see hw/afu.sv).
+const unsigned MMIO_CHANNEL_WORDS = 0x0080;
+
+// Counters of csr_mgr (see hw/csr_mgr.sv), which count the responses of each
+// CCI-P virtual channel since reset. These are shared by all DMA channels.
+enum CsrMgrAddr {
+
+  MMIO_CSR_VL0_RD=0x0016,
+  MMIO_CSR_VL0_WR=0x0018,
+  MMIO_CSR_VH0=0x001A,
+  MMIO_CSR_VH1=0x001C
 };
 
 
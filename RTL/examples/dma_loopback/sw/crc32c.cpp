@@ -0,0 +1,97 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "crc32c.h"
+
+// Reflected CRC-32C polynomial.
+static const uint32_t POLY = 0x82F63B78;
+
+
+// CRC of each possible byte.
+struct CrcTable {
+
+  uint32_t entries[256];
+
+  CrcTable() {
+    for (unsigned i=0; i < 256; i++) {
+      uint32_t entry = i;
+      for (unsigned bit=0; bit < 8; bit++)
+	entry = (entry >> 1) ^ ((entry & 1) ? POLY : 0);
+      entries[i] = entry;
+    }
+  }
+};
+
+
+static uint32_t crc32cTable(const uint8_t *data, size_t bytes, uint32_t crc) {
+
+  static const CrcTable table;
+
+  for (size_t i=0; i < bytes; i++)
+    crc = (crc >> 8) ^ table.entries[(crc ^ data[i]) & 0xff];
+
+  return crc;
+}
+
+
+#if defined(__x86_64__)
+// Compiled for SSE4.2 independently of the compiler flags, and only called
+// after checking that the processor supports it.
+__attribute__((target("sse4.2")))
+static uint32_t crc32cSse42(const uint8_t *data, size_t bytes, uint32_t crc) {
+
+  // Process 8 bytes per instruction, with memcpy for unaligned data.
+  uint64_t crc64 = crc;
+  for (; bytes >= 8; data += 8, bytes -= 8) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+
+  crc = (uint32_t) crc64;
+  for (; bytes > 0; data++, bytes--)
+    crc = _mm_crc32_u8(crc, *data);
+
+  return crc;
+}
+#endif
+
+
+uint32_t crc32c(const volatile void *data, size_t bytes, uint32_t crc) {
+
+  // The volatile qualifier is cast away, so the data can be read 8 bytes
+  // at a time. The data must not be modified by the AFU during the CRC.
+  const uint8_t *ptr = const_cast<const uint8_t*>(reinterpret_cast<const volatile uint8_t*>(data));
+
+  // The CRC register starts with all ones, and the result is inverted.
+  crc = ~crc;
+
+#if defined(__x86_64__)
+  static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+  if (has_sse42)
+    return ~crc32cSse42(ptr, bytes, crc);
+#endif
+
+  return ~crc32cTable(ptr, bytes, crc);
+}
@@ -0,0 +1,34 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+//
+// Description: Software CRC-32C (Castagnoli) that matches the CRCs computed
+// by the AFU (see hw/crc32c.sv). Uses the SSE4.2 crc32 instruction when the
+// processor supports it, and a lookup table otherwise.
+
+#ifndef __CRC32C_H__
+#define __CRC32C_H__
+
+#include <cstddef>
+#include <cstdint>
+
+// Returns the CRC-32C of bytes starting at data. To compute the CRC of
+// data that is produced in pieces, pass the CRC of the previous pieces as
+// crc.
+uint32_t crc32c(const volatile void *data, size_t bytes, uint32_t crc=0);
+
+#endif
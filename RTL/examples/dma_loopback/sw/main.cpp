@@ -29,10 +29,12 @@
 #include <cstdlib>
 #include <iostream>
 #include <cmath>
+#include <chrono>
 
 #include <opae/utils.h>
 
 #include "AFU.h"
+#include "crc32c.h"
 // Contains application-specific information
 #include "config.h"
 // Auto-generated by OPAE's afu_json_mgr script
@@ -42,12 +44,12 @@ using namespace std;
 
 
 void printUsage(char *name);
-bool checkUsage(int argc, char *argv[], unsigned long &size, unsigned long &num_tests);
+bool checkUsage(int argc, char *argv[], unsigned long &size, unsigned long &num_tests, unsigned long &burst_len, unsigned long &vc_policy, unsigned long &max_dma_cls);
 
 int main(int argc, char *argv[]) {
 
-  unsigned long size, num_tests;
-  if (!checkUsage(argc, argv, size, num_tests)) {
+  unsigned long size, num_tests, burst_len, vc_policy, max_dma_cls;
+  if (!checkUsage(argc, argv, size, num_tests, burst_len, vc_policy, max_dma_cls)) {
     printUsage(argv[0]);
     return EXIT_FAILURE;
   }
@@ -57,6 +59,13 @@ int main(int argc, char *argv[]) {
     // constructor searchers available FPGAs for one with an AFU with the
     // the specified ID
     AFU afu(AFU_ACCEL_UUID); 
+    afu.setBurstLength(burst_len);
+    afu.setVcPolicy((AFU::VcPolicy) vc_policy);
+
+    // Lowering the maximum DMA size splits every test into multiple DMA
+    // transfers, which tests the splitting without huge arrays.
+    if (max_dma_cls > 0)
+      afu.setMaxDmaSize(max_dma_cls);
     bool failed = false;
 
     for (unsigned test=0; test < num_tests; test++) {
@@ -72,38 +81,52 @@ int main(int argc, char *argv[]) {
       cout << "Starting Test " << test << "...";
 
       // Initialize the input and output memory.
-      for (unsigned i=0; i < size; i++) {
+      for (uint64_t i=0; i < size; i++) {
 	input[i] = (dma_data_t) rand();
 	output[i] = 0;
       }
-    
-      // Inform the FPGA of the starting read and write address of the arrays.
-      afu.write(MMIO_RD_ADDR, (uint64_t) input);
-      afu.write(MMIO_WR_ADDR, (uint64_t) output);
 
-      // The FPGA DMA only handles cache-line transfers, so we need to convert
-      // the array size to cache lines.
-      unsigned total_bytes = size*sizeof(dma_data_t);
-      unsigned num_cls = ceil((float) total_bytes / (float) AFU::CL_BYTES);
-      afu.write(MMIO_SIZE, num_cls);
+      // The AFU reads complete cache lines, so its CRC includes the unused
+      // bytes of the last cache line, which are part of the allocated
+      // memory.
+      uint64_t bytes = size*sizeof(dma_data_t);
+      uint64_t cl_bytes = (bytes + AFU::CL_BYTES - 1) / AFU::CL_BYTES * AFU::CL_BYTES;
+      uint32_t input_crc = crc32c(input, cl_bytes);
 
-      // Start the FPGA DMA transfer.
-      afu.write(MMIO_GO, 1);  
+      // Start the FPGA DMA transfer. The FPGA DMA reads entire cache lines
+      // and only writes the requested bytes of the last cache line. The AFU
+      // class splits jobs larger than the DMA's maximum size into multiple
+      // transfers.
+#ifdef PRINT_PERF_COUNTERS
+      AFU::ChannelCounts start_counts = afu.getChannelCounts();
+#endif
+      auto start_time = chrono::steady_clock::now();
+      afu.launch(input, output, bytes);
 
       // Wait until the FPGA is done.
-      while (afu.read(MMIO_DONE) == 0) {
-#ifdef SLEEP_WHILE_WAITING
-	this_thread::sleep_for(chrono::milliseconds(SLEEP_MS));
-#endif
-      }
+      afu.wait();
+      chrono::duration<double> seconds = chrono::steady_clock::now() - start_time;
         
-      // Verify correct output.
+      // Verify that the AFU read the input and wrote the same data by
+      // comparing CRCs, which doesn't require reading either array again.
+      uint64_t errors = 0;
+      if (afu.getReadCrc() != input_crc || afu.getWriteCrc() != input_crc) {
+	cout << "CRC mismatch. ";
+	errors++;
+      }
+
+      // Verify correct output. Split jobs are always verified, because the
+      // CRCs don't detect data written to the wrong offset.
       // NOTE: This could be replaced with memcp, but that is only possible
       // when not using volatile data (i.e. AFU::mallocNonvolatile()). 
-      unsigned errors = 0;
-      for (unsigned i=0; i < size; i++) {
-	if (output[i] != input[i]) {
-	  errors++;
+#ifndef VERIFY_OUTPUT_ARRAY
+      if (max_dma_cls > 0)
+#endif
+      {
+	for (uint64_t i=0; i < size; i++) {
+	  if (output[i] != input[i]) {
+	    errors++;
+	  }
 	}
       }
 
@@ -112,8 +135,35 @@ int main(int argc, char *argv[]) {
 	failed = true;
       }
       else {
-	cout << "Succeeded." << endl;
+	// Each byte is both read and written.
+	cout << "Succeeded (" << 2*bytes / seconds.count() / 1e9 << " GB/s";
+	if (max_dma_cls > 0)
+	  cout << ", " << (cl_bytes / AFU::CL_BYTES + max_dma_cls - 1) / max_dma_cls << " DMA transfers";
+	cout << ")." << endl;
       }
+
+#ifdef PRINT_PERF_COUNTERS
+      AFU::PerfCounters perf = afu.getPerfCounters();
+      cout << "  Active cycles: " << perf.active_cycles
+	   << ", read requests: " << perf.rd_requests
+	   << ", read responses: " << perf.rd_responses
+	   << ", write requests: " << perf.wr_requests << "\n"
+	   << "  Read stalls: c0TxAlmFull " << perf.c0_almost_full
+	   << ", FIFO " << perf.rd_fifo_almost_full
+	   << ", rd_en " << perf.rd_data_not_read << "\n"
+	   << "  Write stalls: c1TxAlmFull " << perf.c1_almost_full
+	   << ", wr_en " << perf.wr_data_not_written
+	   << ", arbiter " << perf.c1_arbiter << "\n"
+	   << "  Read latency (cycles): min " << perf.min_rd_latency
+	   << ", max " << perf.max_rd_latency
+	   << ", mean " << perf.meanRdLatency() << endl;
+
+      AFU::ChannelCounts counts = afu.getChannelCounts();
+      cout << "  Virtual channels: VL0 reads " << counts.vl0_rd - start_counts.vl0_rd
+	   << ", VL0 writes " << counts.vl0_wr - start_counts.vl0_wr
+	   << ", VH0 " << counts.vh0 - start_counts.vh0
+	   << ", VH1 " << counts.vh1 - start_counts.vh1 << endl;
+#endif
     
       // Free the allocated memory.
       afu.free(input);
@@ -158,9 +208,12 @@ int main(int argc, char *argv[]) {
 
 void printUsage(char *name) {
 
-  cout << "Usage: " << name << " size num_tests\n"     
+  cout << "Usage: " << name << " size num_tests [burst_len] [vc_policy] [max_dma_cls]\n"     
        << "size (positive integer amount of dma_data_t to transfer)\n"
-       << "num_tests (positive integer amount of \"size\" DMA tests to run)" 
+       << "num_tests (positive integer amount of \"size\" DMA tests to run)\n" 
+       << "burst_len (maximum cache lines per memory request: 1, 2, or 4, default 4)\n"
+       << "vc_policy (virtual channel: 0 automatic, 1 VL0, 2 VH0, 3 VH1, 4 alternating VH0/VH1, default 0)\n"
+       << "max_dma_cls (maximum cache lines per DMA transfer, which splits larger tests, default 0 for the hardware maximum)"
        << endl;
 }
 
@@ -178,14 +231,30 @@ unsigned long stringToPositiveInt(char *str) {
   return 0;  
 }
 
+// Same as stringToPositiveInt(), but also allows 0.
+unsigned long stringToNonnegativeInt(char *str) {
+
+  return str[0] == '0' && str[1] == '\0' ? 0 : stringToPositiveInt(str);
+}
+
 
 bool checkUsage(int argc, char *argv[], 
-		unsigned long &size, unsigned long &num_tests) {
+		unsigned long &size, unsigned long &num_tests, unsigned long &burst_len,
+		unsigned long &vc_policy, unsigned long &max_dma_cls) {
   
-  if (argc == 3) {
+  burst_len = 4;
+  vc_policy = AFU::VC_AUTO;
+  max_dma_cls = 0;
+  if (argc >= 3 && argc <= 6) {
     try {
       size = stringToPositiveInt(argv[1]);
       num_tests = stringToPositiveInt(argv[2]);
+      if (argc >= 4)
+	burst_len = stringToPositiveInt(argv[3]);
+      if (argc >= 5)
+	vc_policy = stringToNonnegativeInt(argv[4]);
+      if (argc == 6)
+	max_dma_cls = stringToNonnegativeInt(argv[5]);
     }
     catch (const runtime_error& e) {    
       return false;
@@ -195,5 +264,5 @@ bool checkUsage(int argc, char *argv[],
     return false;
   }
 
-  return true;
+  return vc_policy <= AFU::VC_VH_ALTERNATE;
 }
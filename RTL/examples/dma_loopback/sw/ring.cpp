@@ -0,0 +1,229 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+//
+// Description: This application demonstrates the descriptor-ring mode of
+// the DMA AFU. Many small jobs are queued in a ring in shared memory, and
+// started with a single doorbell, instead of starting each job with MMIO
+// writes. It then runs the same jobs through the AFU's hardware job queue
+// for comparison, and uses a single scatter-gather job to gather the jobs'
+// inputs in reverse order.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <opae/utils.h>
+
+#include "AFU.h"
+// Contains application-specific information
+#include "config.h"
+// Auto-generated by OPAE's afu_json_mgr script
+#include "afu_json_info.h"
+
+using namespace std;
+
+
+void printUsage(char *name);
+bool checkUsage(int argc, char *argv[], unsigned long &size, unsigned long &num_jobs);
+
+int main(int argc, char *argv[]) {
+
+  unsigned long size, num_jobs;
+  if (!checkUsage(argc, argv, size, num_jobs)) {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  try {
+    AFU afu(AFU_ACCEL_UUID);
+    afu.enableRing();
+
+    // Every job uses a different part of the same input and output arrays.
+    auto input  = afu.malloc<dma_data_t>(size*num_jobs);
+    auto output = afu.malloc<dma_data_t>(size*num_jobs);
+
+    for (uint64_t i=0; i < size*num_jobs; i++) {
+      input[i] = (dma_data_t) rand();
+      output[i] = 0;
+    }
+
+    // Each job must start on a cache line.
+    uint64_t job_bytes = size*sizeof(dma_data_t);
+    if (job_bytes % AFU::CL_BYTES != 0) {
+      cerr << "ERROR: size*sizeof(dma_data_t) must be a multiple of " << AFU::CL_BYTES << "." << endl;
+      return EXIT_FAILURE;
+    }
+
+    // Queue all the jobs, ringing the doorbell once for every ring's worth
+    // of jobs.
+    auto start_time = chrono::steady_clock::now();
+    vector<uint64_t> jobs;
+    for (unsigned long job=0; job < num_jobs; job++) {
+      bool last_in_batch = (job + 1) % AFU::DEFAULT_RING_ENTRIES == 0 || job + 1 == num_jobs;
+      jobs.push_back(afu.enqueue(input + job*size, output + job*size, job_bytes, last_in_batch));
+    }
+
+    afu.wait(jobs.back());
+    chrono::duration<double> seconds = chrono::steady_clock::now() - start_time;
+
+    uint64_t errors = 0;
+    for (uint64_t i=0; i < size*num_jobs; i++) {
+      if (output[i] != input[i]) {
+	errors++;
+      }
+    }
+
+    if (errors > 0) {
+      cout << "Failed with " << errors << " errors." << endl;
+      return EXIT_FAILURE;
+    }
+
+    cout << "All " << num_jobs << " jobs successful ("
+	 << num_jobs / seconds.count() << " jobs/s)." << endl;
+
+    // Run the same jobs through the AFU's hardware job queue, which starts
+    // each job with MMIO writes, but doesn't wait for the previous job.
+    for (uint64_t i=0; i < size*num_jobs; i++)
+      output[i] = 0;
+
+    start_time = chrono::steady_clock::now();
+    uint64_t last_job = 0;
+    for (unsigned long job=0; job < num_jobs; job++) {
+      last_job = afu.queueJob(input + job*size, output + job*size, job_bytes);
+    }
+
+    afu.waitJob(last_job);
+    seconds = chrono::steady_clock::now() - start_time;
+
+    for (uint64_t i=0; i < size*num_jobs; i++) {
+      if (output[i] != input[i]) {
+	errors++;
+      }
+    }
+
+    if (errors > 0) {
+      cout << "Job queue failed with " << errors << " errors." << endl;
+      return EXIT_FAILURE;
+    }
+
+    cout << "All " << num_jobs << " queued jobs successful ("
+	 << num_jobs / seconds.count() << " jobs/s)." << endl;
+
+    // Gather the input of each job in reverse order into one contiguous
+    // output region.
+    unsigned long sg_jobs = num_jobs < AFU::MAX_SG_ENTRIES ? num_jobs : AFU::MAX_SG_ENTRIES;
+    vector<AFU::SgEntry> rd_list, wr_list;
+    for (unsigned long job=0; job < sg_jobs; job++) {
+      rd_list.push_back({(uint64_t) (input + (sg_jobs - 1 - job)*size), job_bytes / AFU::CL_BYTES});
+    }
+    wr_list.push_back({(uint64_t) output, sg_jobs * job_bytes / AFU::CL_BYTES});
+
+    for (uint64_t i=0; i < sg_jobs*size; i++)
+      output[i] = 0;
+
+    afu.wait(afu.submitSg(rd_list, wr_list));
+
+    for (unsigned long job=0; job < sg_jobs; job++) {
+      for (uint64_t i=0; i < size; i++) {
+	if (output[job*size + i] != input[(sg_jobs - 1 - job)*size + i]) {
+	  errors++;
+	}
+      }
+    }
+
+    afu.free(input);
+    afu.free(output);
+
+    if (errors > 0) {
+      cout << "Scatter-gather job failed with " << errors << " errors." << endl;
+      return EXIT_FAILURE;
+    }
+
+    cout << "Scatter-gather job successful." << endl;
+    return EXIT_SUCCESS;
+  }
+  // Exception handling for all the runtime errors that can occur within
+  // the AFU wrapper class.
+  catch (const fpga_result& e) {
+
+    // Provide more meaningful error messages for each exception.
+    if (e == FPGA_BUSY) {
+      cerr << "ERROR: All FPGAs busy." << endl;
+    }
+    else if (e == FPGA_NOT_FOUND) {
+      cerr << "ERROR: FPGA with accelerator " << AFU_ACCEL_UUID
+	   << " not found." << endl;
+    }
+    else {
+      // Print the default error string for the remaining fpga_result types.
+      cerr << "ERROR: " << fpgaErrStr(e) << endl;
+    }
+  }
+  catch (const runtime_error& e) {
+    cerr << e.what() << endl;
+  }
+  catch (const opae::fpga::types::no_driver& e) {
+    cerr << "ERROR: No FPGA driver found." << endl;
+  }
+
+  return EXIT_FAILURE;
+}
+
+
+void printUsage(char *name) {
+
+  cout << "Usage: " << name << " size num_jobs\n"
+       << "size (positive integer amount of dma_data_t to transfer per job)\n"
+       << "num_jobs (positive integer amount of jobs to queue)"
+       << endl;
+}
+
+// Returns unsigned long representation of string str.
+// Throws an exception if str is not a positive integer.
+unsigned long stringToPositiveInt(char *str) {
+
+  char *p;
+  long num = strtol(str, &p, 10);
+  if (p != 0 && *p == '\0' && num > 0) {
+    return num;
+  }
+
+  throw runtime_error("String is not a positive integer.");
+  return 0;
+}
+
+
+bool checkUsage(int argc, char *argv[],
+		unsigned long &size, unsigned long &num_jobs) {
+
+  if (argc == 3) {
+    try {
+      size = stringToPositiveInt(argv[1]);
+      num_jobs = stringToPositiveInt(argv[2]);
+    }
+    catch (const runtime_error& e) {
+      return false;
+    }
+  }
+  else {
+    return false;
+  }
+
+  return true;
+}
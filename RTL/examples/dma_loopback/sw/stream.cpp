@@ -0,0 +1,150 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+//
+// Description: This application streams a file through a DMA AFU and
+// writes the AFU's output to another file using the FileStreamer class.
+// File data is read directly into AFU buffers with O_DIRECT, so it is never
+// copied by the CPU, and disk reads/writes overlap with AFU execution.
+//
+// By default, the application uses the dma_loopback AFU, in which case the
+// output file should be identical to the input file. Any other DMA AFU that
+// uses the same MMIO addresses (e.g. simple_pipeline or float_pipeline) can
+// be used by specifying its UUID and the ratio of input bytes to output
+// bytes.
+//
+// To test without an FPGA, run stream_ase with the dma_loopback simulation
+// and compare the files (e.g. with cmp).
+
+#include <cstdlib>
+#include <iostream>
+#include <chrono>
+
+#include <opae/utils.h>
+
+#include "AFU.h"
+#include "FileStreamer.h"
+// Contains application-specific information
+#include "config.h"
+// Auto-generated by OPAE's afu_json_mgr script
+#include "afu_json_info.h"
+
+using namespace std;
+
+
+void printUsage(char *name);
+bool checkUsage(int argc, char *argv[], unsigned long &chunk_kb, unsigned long &ratio, const char* &uuid);
+
+int main(int argc, char *argv[]) {
+
+  unsigned long chunk_kb, ratio;
+  const char* uuid;
+  if (!checkUsage(argc, argv, chunk_kb, ratio, uuid)) {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  try {
+    AFU afu(uuid);
+    FileStreamer streamer(afu, chunk_kb * 1024, ratio);
+
+    auto start = chrono::steady_clock::now();
+    uint64_t bytes = streamer.run(argv[1], argv[2]);
+    chrono::duration<double> seconds = chrono::steady_clock::now() - start;
+
+    cout << "Streamed " << bytes << " bytes in " << seconds.count() << "s ("
+	 << bytes / seconds.count() / 1e9 << " GB/s)." << endl;
+    return EXIT_SUCCESS;
+  }
+  // Exception handling for all the runtime errors that can occur within
+  // the AFU wrapper class.
+  catch (const fpga_result& e) {
+
+    // Provide more meaningful error messages for each exception.
+    if (e == FPGA_BUSY) {
+      cerr << "ERROR: All FPGAs busy." << endl;
+    }
+    else if (e == FPGA_NOT_FOUND) {
+      cerr << "ERROR: FPGA with accelerator " << uuid
+	   << " not found." << endl;
+    }
+    else {
+      // Print the default error string for the remaining fpga_result types.
+      cerr << "ERROR: " << fpgaErrStr(e) << endl;
+    }
+  }
+  catch (const runtime_error& e) {
+    cerr << e.what() << endl;
+  }
+  catch (const opae::fpga::types::no_driver& e) {
+    cerr << "ERROR: No FPGA driver found." << endl;
+  }
+
+  return EXIT_FAILURE;
+}
+
+
+void printUsage(char *name) {
+
+  cout << "Usage: " << name << " input_file output_file [chunk_kb [ratio [uuid]]]\n"
+       << "chunk_kb (size of each DMA transfer in KB, default "
+       << FileStreamer::DEFAULT_CHUNK_BYTES / 1024 << ", must be a multiple of 4*ratio)\n"
+       << "ratio (input bytes per output byte: 1 for dma_loopback (default), 8 for simple_pipeline, 16 for float_pipeline)\n"
+       << "uuid (UUID of the AFU, default is dma_loopback)"
+       << endl;
+}
+
+// Returns unsigned long representation of string str.
+// Throws an exception if str is not a positive integer.
+unsigned long stringToPositiveInt(char *str) {
+
+  char *p;
+  long num = strtol(str, &p, 10);
+  if (p != 0 && *p == '\0' && num > 0) {
+    return num;
+  }
+
+  throw runtime_error("String is not a positive integer.");
+  return 0;
+}
+
+
+bool checkUsage(int argc, char *argv[], unsigned long &chunk_kb,
+		unsigned long &ratio, const char* &uuid) {
+
+  chunk_kb = FileStreamer::DEFAULT_CHUNK_BYTES / 1024;
+  ratio = 1;
+  uuid = AFU_ACCEL_UUID;
+
+  if (argc < 3 || argc > 6)
+    return false;
+
+  try {
+    if (argc > 3)
+      chunk_kb = stringToPositiveInt(argv[3]);
+    if (argc > 4)
+      ratio = stringToPositiveInt(argv[4]);
+  }
+  catch (const runtime_error& e) {
+    return false;
+  }
+
+  if (argc > 5)
+    uuid = argv[5];
+
+  return true;
+}
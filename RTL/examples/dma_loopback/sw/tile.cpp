@@ -0,0 +1,169 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+//
+// Description: This application copies a tile of a large row-major matrix
+// into a separate packed matrix with a single 2D DMA job, where the DMA
+// reads each row of the tile directly from the large matrix.
+
+#include <cstdlib>
+#include <iostream>
+
+#include <opae/utils.h>
+
+#include "AFU.h"
+// Contains application-specific information
+#include "config.h"
+// Auto-generated by OPAE's afu_json_mgr script
+#include "afu_json_info.h"
+
+using namespace std;
+
+// Number of matrix elements per cache line. The columns of the matrix and
+// the tile are multiples of this, so every row starts on a cache line.
+const unsigned CL_ELEMENTS = AFU::CL_BYTES / sizeof(dma_data_t);
+
+void printUsage(char *name);
+bool checkUsage(int argc, char *argv[], unsigned long &rows, unsigned long &cols,
+		unsigned long &tile_rows, unsigned long &tile_cols);
+
+int main(int argc, char *argv[]) {
+
+  unsigned long rows, cols, tile_rows, tile_cols;
+  if (!checkUsage(argc, argv, rows, cols, tile_rows, tile_cols)) {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  try {
+    AFU afu(AFU_ACCEL_UUID);
+
+    auto matrix = afu.malloc<dma_data_t>(rows * cols);
+    auto tile = afu.malloc<dma_data_t>(tile_rows * tile_cols);
+
+    for (uint64_t i=0; i < rows * cols; i++)
+      matrix[i] = (dma_data_t) rand();
+
+    for (uint64_t i=0; i < tile_rows * tile_cols; i++)
+      tile[i] = 0;
+
+    // Copy the tile at the center of the matrix, rounded down to a cache
+    // line.
+    uint64_t row = (rows - tile_rows) / 2;
+    uint64_t col = (cols - tile_cols) / 2 / CL_ELEMENTS * CL_ELEMENTS;
+
+    // The rows of the matrix are cols elements apart, and the rows of the
+    // packed tile are tile_cols elements apart.
+    afu.launch2d(matrix + row*cols + col, cols*sizeof(dma_data_t),
+		 tile, tile_cols*sizeof(dma_data_t),
+		 tile_cols*sizeof(dma_data_t), tile_rows);
+    afu.wait();
+
+    uint64_t errors = 0;
+    for (uint64_t i=0; i < tile_rows; i++) {
+      for (uint64_t j=0; j < tile_cols; j++) {
+	if (tile[i*tile_cols + j] != matrix[(row+i)*cols + col + j]) {
+	  errors++;
+	}
+      }
+    }
+
+    afu.free(matrix);
+    afu.free(tile);
+
+    if (errors > 0) {
+      cout << "Failed with " << errors << " errors." << endl;
+      return EXIT_FAILURE;
+    }
+
+    cout << "Tile copy successful." << endl;
+    return EXIT_SUCCESS;
+  }
+  // Exception handling for all the runtime errors that can occur within
+  // the AFU wrapper class.
+  catch (const fpga_result& e) {
+
+    // Provide more meaningful error messages for each exception.
+    if (e == FPGA_BUSY) {
+      cerr << "ERROR: All FPGAs busy." << endl;
+    }
+    else if (e == FPGA_NOT_FOUND) {
+      cerr << "ERROR: FPGA with accelerator " << AFU_ACCEL_UUID
+	   << " not found." << endl;
+    }
+    else {
+      // Print the default error string for the remaining fpga_result types.
+      cerr << "ERROR: " << fpgaErrStr(e) << endl;
+    }
+  }
+  catch (const runtime_error& e) {
+    cerr << e.what() << endl;
+  }
+  catch (const opae::fpga::types::no_driver& e) {
+    cerr << "ERROR: No FPGA driver found." << endl;
+  }
+
+  return EXIT_FAILURE;
+}
+
+
+void printUsage(char *name) {
+
+  cout << "Usage: " << name << " rows cols tile_rows tile_cols\n"
+       << "rows, cols (positive integer size of the matrix)\n"
+       << "tile_rows, tile_cols (positive integer size of the tile copied from the matrix)\n"
+       << "cols and tile_cols must be multiples of " << CL_ELEMENTS
+       << ", and the tile can't be larger than the matrix."
+       << endl;
+}
+
+// Returns unsigned long representation of string str.
+// Throws an exception if str is not a positive integer.
+unsigned long stringToPositiveInt(char *str) {
+
+  char *p;
+  long num = strtol(str, &p, 10);
+  if (p != 0 && *p == '\0' && num > 0) {
+    return num;
+  }
+
+  throw runtime_error("String is not a positive integer.");
+  return 0;
+}
+
+
+bool checkUsage(int argc, char *argv[], unsigned long &rows, unsigned long &cols,
+		unsigned long &tile_rows, unsigned long &tile_cols) {
+
+  if (argc == 5) {
+    try {
+      rows = stringToPositiveInt(argv[1]);
+      cols = stringToPositiveInt(argv[2]);
+      tile_rows = stringToPositiveInt(argv[3]);
+      tile_cols = stringToPositiveInt(argv[4]);
+    }
+    catch (const runtime_error& e) {
+      return false;
+    }
+  }
+  else {
+    return false;
+  }
+
+  return cols % CL_ELEMENTS == 0 && tile_cols % CL_ELEMENTS == 0 &&
+    tile_rows <= rows && tile_cols <= cols;
+}
@@ -0,0 +1,166 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "HostMemory.h"
+
+using namespace std;
+
+
+HostMemory::HostMemory(const HostMemoryConfig& config) :
+  config_(config), cycle_(0), last_rd_ready_(0), rd_tokens_(0),
+  wr_tokens_(0), rng_(config.seed) {
+
+  // CCI-P returns at most one read response per cycle.
+  if (config_.rd_bandwidth <= 0 || config_.rd_bandwidth > 1)
+    throw runtime_error("ERROR: Read bandwidth must be in (0, 1] cache lines per cycle.");
+
+  if (config_.wr_bandwidth <= 0)
+    throw runtime_error("ERROR: Write bandwidth must be positive.");
+}
+
+
+HostMemory::Line& HostMemory::getLine(uint64_t addr) {
+
+  Line& line = lines_[addr / CL_BYTES];
+  if (line.empty())
+    line.resize(CL_BYTES, 0);
+
+  return line;
+}
+
+
+void HostMemory::write(uint64_t addr, const void* data, size_t bytes) {
+
+  const uint8_t* src = static_cast<const uint8_t*>(data);
+  for (size_t i=0; i < bytes; i++) {
+    getLine(addr+i)[(addr+i) % CL_BYTES] = src[i];
+  }
+}
+
+
+void HostMemory::read(uint64_t addr, void* data, size_t bytes) const {
+
+  uint8_t* dst = static_cast<uint8_t*>(data);
+  for (size_t i=0; i < bytes; i++) {
+    auto it = lines_.find((addr+i) / CL_BYTES);
+    dst[i] = it == lines_.end() ? 0 : it->second[(addr+i) % CL_BYTES];
+  }
+}
+
+
+void HostMemory::readRequest(uint64_t addr, unsigned lines, uint16_t mdata) {
+
+  if (addr % CL_BYTES != 0)
+    throw runtime_error("ERROR: Read request isn't aligned to a cache line.");
+
+  uniform_int_distribution<unsigned> jitter(0, config_.rd_jitter);
+  for (unsigned i=0; i < lines; i++) {
+    uint64_t ready = cycle_ + config_.rd_latency + jitter(rng_);
+
+    // Sorted responses can't overtake earlier responses.
+    if (!config_.out_of_order) {
+      ready = max(ready, last_rd_ready_);
+      last_rd_ready_ = ready;
+    }
+
+    reads_.push_back({ready, addr + i*CL_BYTES, mdata, i});
+  }
+}
+
+
+void HostMemory::writeRequest(uint64_t addr, unsigned byte_len,
+			      const uint32_t* data) {
+
+  if (addr % CL_BYTES != 0)
+    throw runtime_error("ERROR: Write request isn't aligned to a cache line.");
+
+  // The data is visible immediately. The completion time only determines
+  // when the write stops counting against the almost-full threshold.
+  write(addr, data, byte_len == 0 ? CL_BYTES : byte_len);
+  writes_.push_back(cycle_ + config_.wr_latency);
+}
+
+
+bool HostMemory::tick(ReadResponse& rsp) {
+
+  bool valid = false;
+  cycle_++;
+
+  // Accumulate bandwidth, saving at most one cycle of unused bandwidth.
+  rd_tokens_ = min(rd_tokens_ + config_.rd_bandwidth, 1.0);
+  wr_tokens_ = min(wr_tokens_ + config_.wr_bandwidth,
+		   max(1.0, config_.wr_bandwidth));
+
+  while (!writes_.empty() && writes_.front() <= cycle_ && wr_tokens_ >= 1.0) {
+    writes_.pop_front();
+    wr_tokens_ -= 1.0;
+  }
+
+  if (rd_tokens_ >= 1.0) {
+
+    // Sorted reads have non-decreasing ready times, so the first ready
+    // response is always at the front.
+    auto next = reads_.end();
+    for (auto it = reads_.begin(); it != reads_.end(); ++it) {
+      if (it->ready <= cycle_ && (next == reads_.end() || it->ready < next->ready))
+	next = it;
+
+      if (!config_.out_of_order)
+	break;
+    }
+
+    if (next != reads_.end() && next->ready <= cycle_) {
+      rsp.mdata = next->mdata;
+      rsp.cl_num = next->cl_num;
+      read(next->addr, rsp.data, CL_BYTES);
+      reads_.erase(next);
+      rd_tokens_ -= 1.0;
+      valid = true;
+    }
+  }
+
+  return valid;
+}
+
+
+bool HostMemory::rdAlmFull() const {
+
+  return reads_.size() >= config_.rd_alm_full;
+}
+
+
+bool HostMemory::wrAlmFull() const {
+
+  return writes_.size() >= config_.wr_alm_full;
+}
+
+
+bool HostMemory::rdEmpty() const {
+
+  return reads_.empty();
+}
+
+
+bool HostMemory::wrEmpty() const {
+
+  return writes_.empty();
+}
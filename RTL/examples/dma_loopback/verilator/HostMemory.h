@@ -0,0 +1,134 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+
+// Description: This file defines a behavioral model of the host memory
+// seen through CCI-P, which the Verilator simulations use in place of the
+// FIU. The model is not cycle-accurate with respect to a real FPGA, but
+// it has configurable latency, bandwidth, and almost-full back-pressure,
+// which is enough to compare the throughput of different versions of the
+// RTL and to find out which side of a transfer is the bottleneck.
+//
+// Reads return one cache line per response, like CCI-P. Multi-line reads
+// return their lines with the cl_num of each line. Unless out_of_order is
+// set, responses are returned in the order of the requests, which is the
+// behavior of MPF with SORT_READ_RESPONSES.
+
+#ifndef _HOST_MEMORY_H_
+#define _HOST_MEMORY_H_
+
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+
+// The number of 32-bit words in a cache line, which matches the
+// representation of 512-bit signals in Verilator.
+const unsigned CL_WORDS = 16;
+const unsigned CL_BYTES = 64;
+
+
+struct HostMemoryConfig {
+
+  // Minimum number of cycles between a read request and its response.
+  unsigned rd_latency = 100;
+
+  // Each read response is delayed by an additional random number of cycles
+  // in [0, rd_jitter].
+  unsigned rd_jitter = 0;
+
+  // Number of cycles between a write request and its completion.
+  unsigned wr_latency = 50;
+
+  // Maximum average number of cache lines returned/written per cycle.
+  double rd_bandwidth = 1.0;
+  double wr_bandwidth = 1.0;
+
+  // Number of outstanding cache lines at which the almost-full signals are
+  // asserted. Like CCI-P, requests are still accepted while almost full.
+  unsigned rd_alm_full = 256;
+  unsigned wr_alm_full = 128;
+
+  // Returns read responses in the order they become ready instead of the
+  // order of the requests. Requires cci_dma to be built with REORDER_READS.
+  bool out_of_order = false;
+
+  unsigned seed = 1;
+};
+
+
+struct ReadResponse {
+
+  uint16_t mdata;
+  unsigned cl_num;
+  uint32_t data[CL_WORDS];
+};
+
+
+class HostMemory {
+
+public:
+  HostMemory(const HostMemoryConfig& config);
+
+  // Functional access to memory for software, which is not timed.
+  void write(uint64_t addr, const void* data, size_t bytes);
+  void read(uint64_t addr, void* data, size_t bytes) const;
+
+  // Requests from the AFU. addr is a byte address of a cache line.
+  // byte_len is the number of bytes written at the start of the line, where
+  // 0 writes the entire line.
+  void readRequest(uint64_t addr, unsigned lines, uint16_t mdata);
+  void writeRequest(uint64_t addr, unsigned byte_len, const uint32_t* data);
+
+  // Advances the model by one cycle. Returns true when a read response is
+  // available during the cycle, which is stored in rsp.
+  bool tick(ReadResponse& rsp);
+
+  bool rdAlmFull() const;
+  bool wrAlmFull() const;
+
+  // Asserted when there are no outstanding reads/writes.
+  bool rdEmpty() const;
+  bool wrEmpty() const;
+
+private:
+
+  struct PendingRead {
+    uint64_t ready;
+    uint64_t addr;
+    uint16_t mdata;
+    unsigned cl_num;
+  };
+
+  typedef std::vector<uint8_t> Line;
+
+  Line& getLine(uint64_t addr);
+
+  HostMemoryConfig config_;
+  std::unordered_map<uint64_t, Line> lines_;
+  std::deque<PendingRead> reads_;
+  std::deque<uint64_t> writes_;
+  uint64_t cycle_;
+  uint64_t last_rd_ready_;
+  double rd_tokens_;
+  double wr_tokens_;
+  std::mt19937 rng_;
+};
+
+#endif
@@ -0,0 +1,86 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+// Module Name:  float_ip.sv
+// Description:  Behavioral replacements for the mult_float and add_float
+//               cores of the float pipeline exercise, which are generated
+//               by Quartus and can't be compiled by Verilator. The math is
+//               done in C++ through DPI (see sim_pipeline.cpp), and the
+//               result is delayed by the latencies in pipe_pkg.sv, so the
+//               pipeline has the same timing as with the real cores.
+//
+//               The results can differ from the cores for denormals, which
+//               the cores flush to zero.
+
+//===================================================================
+// Interface Description
+// Identical to the ports of the generated cores (see ip/*_bb.v).
+//===================================================================
+
+import "DPI-C" function int float_mult(input int a, input int b);
+import "DPI-C" function int float_add(input int a, input int b);
+
+module mult_float
+  (
+   input [31:0]        a,
+   input 	       areset,
+   input [31:0]        b,
+   input 	       clk,
+   input [0:0] 	       en,
+   output logic [31:0] q
+   );
+
+   logic [31:0]        q_r[pipe_pkg::MULT_LATENCY];
+
+   always_ff @(posedge clk) begin
+      if (en) begin
+	 q_r[0] <= float_mult(a, b);
+	 for (int i=1; i < pipe_pkg::MULT_LATENCY; i++) begin
+	    q_r[i] <= q_r[i-1];
+	 end
+      end
+   end
+
+   assign q = q_r[pipe_pkg::MULT_LATENCY-1];
+
+endmodule
+
+
+module add_float
+  (
+   input [31:0]        a,
+   input 	       areset,
+   input [31:0]        b,
+   input 	       clk,
+   input [0:0] 	       en,
+   output logic [31:0] q
+   );
+
+   logic [31:0]        q_r[pipe_pkg::ADD_LATENCY];
+
+   always_ff @(posedge clk) begin
+      if (en) begin
+	 q_r[0] <= float_add(a, b);
+	 for (int i=1; i < pipe_pkg::ADD_LATENCY; i++) begin
+	    q_r[i] <= q_r[i-1];
+	 end
+      end
+   end
+
+   assign q = q_r[pipe_pkg::ADD_LATENCY-1];
+
+endmodule
@@ -0,0 +1,364 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+//
+// Description: This application runs a loopback job on the Verilator model
+// of a DMA channel (sim_dma.sv), using the HostMemory model in place of
+// CCI-P. It programs the channel through the same MMIO registers as the
+// software in ../sw, verifies the output array, and reports the throughput
+// and stall breakdown of the job from the DMA performance counters.
+//
+// --max-dma splits the job into DMA transfers of at most that many cache
+// lines, which are started back to back like AFU::startDma() does for jobs
+// larger than the maximum DMA size. --last-bytes writes only part of the
+// last cache line, which the last transfer requests with MMIO_BYTES.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "verilated.h"
+#include "Vsim_dma.h"
+
+#include "HostMemory.h"
+// MMIO addresses shared with the software in ../sw
+#include "config.h"
+
+using namespace std;
+
+#ifndef REORDER_READS
+#define REORDER_READS 0
+#endif
+
+// Arbitrary, non-overlapping addresses for the input and output arrays.
+const uint64_t INPUT_ADDR = 0x10000000;
+const uint64_t OUTPUT_ADDR = 0x20000000;
+
+
+struct Options {
+
+  unsigned lines = 4096;
+  unsigned burst_len = 4;
+  unsigned max_dma = 0;
+  unsigned last_bytes = 0;
+  uint64_t timeout = 10000000;
+  HostMemoryConfig mem;
+};
+
+
+class Sim {
+
+public:
+  Sim(const HostMemoryConfig& config) : mem(config), cycle(0),
+					rd_alm_full_cycles(0),
+					wr_alm_full_cycles(0) {
+
+    top = new Vsim_dma;
+    top->clk = 0;
+    top->rst = 1;
+    top->mmio_rd_en = 0;
+    top->mmio_wr_en = 0;
+    top->eval();
+    for (unsigned i=0; i < 4; i++)
+      tick();
+    top->rst = 0;
+  }
+
+  ~Sim() {
+
+    top->final();
+    delete top;
+  }
+
+  // Simulates one cycle. The requests registered on the rising edge are
+  // passed to the memory model, which provides the inputs of the next
+  // rising edge.
+  void tick() {
+
+    ReadResponse rsp;
+    bool rsp_valid = mem.tick(rsp);
+
+    top->c0_rsp_valid = rsp_valid;
+    if (rsp_valid) {
+      top->c0_rsp_mdata = rsp.mdata;
+      top->c0_rsp_cl_num = rsp.cl_num;
+      for (unsigned i=0; i < CL_WORDS; i++)
+	top->c0_rsp_data[i] = rsp.data[i];
+    }
+
+    top->c0_alm_full = mem.rdAlmFull();
+    top->c1_alm_full = mem.wrAlmFull();
+    top->c0_empty = mem.rdEmpty();
+    top->c1_empty = mem.wrEmpty();
+
+    rd_alm_full_cycles += mem.rdAlmFull();
+    wr_alm_full_cycles += mem.wrAlmFull();
+
+    top->clk = 1;
+    top->eval();
+
+    if (!top->rst) {
+      if (top->c0_req_valid)
+	mem.readRequest(top->c0_req_addr, top->c0_req_lines,
+			top->c0_req_mdata);
+
+      if (top->c1_req_valid) {
+	uint32_t data[CL_WORDS];
+	for (unsigned i=0; i < CL_WORDS; i++)
+	  data[i] = top->c1_req_data[i];
+	mem.writeRequest(top->c1_req_addr, top->c1_req_byte_len, data);
+      }
+    }
+
+    top->clk = 0;
+    top->eval();
+    cycle++;
+  }
+
+  void mmioWrite(uint16_t addr, uint64_t data) {
+
+    top->mmio_wr_en = 1;
+    top->mmio_wr_addr = addr;
+    top->mmio_wr_data = data;
+    tick();
+    top->mmio_wr_en = 0;
+  }
+
+  // The memory map registers the read data, so it is available after
+  // the rising edge where rd_en is asserted.
+  uint64_t mmioRead(uint16_t addr) {
+
+    top->mmio_rd_en = 1;
+    top->mmio_rd_addr = addr;
+    tick();
+    top->mmio_rd_en = 0;
+    return top->mmio_rd_data;
+  }
+
+  Vsim_dma *top;
+  HostMemory mem;
+  uint64_t cycle;
+  uint64_t rd_alm_full_cycles;
+  uint64_t wr_alm_full_cycles;
+};
+
+
+void printUsage(char *name);
+bool checkUsage(int argc, char *argv[], Options &opts);
+
+int main(int argc, char *argv[]) {
+
+  Options opts;
+  Verilated::commandArgs(argc, argv);
+  if (!checkUsage(argc, argv, opts)) {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  try {
+    Sim sim(opts.mem);
+
+    // Initialize the input array.
+    vector<uint32_t> input(opts.lines * CL_WORDS);
+    for (auto& word : input)
+      word = rand();
+
+    sim.mem.write(INPUT_ADDR, input.data(), input.size()*sizeof(uint32_t));
+
+    sim.mmioWrite(MMIO_BURST_LEN, opts.burst_len);
+
+    // Clears the CRCs and performance counters, which accumulate across
+    // the transfers of the job.
+    sim.mmioWrite(MMIO_RD_CRC, 0);
+
+    // Each transfer is done when the job queue's completion count
+    // increments. Reading the count every cycle adds at most two cycles to
+    // the measured time.
+    unsigned max_dma = opts.max_dma == 0 ? opts.lines : opts.max_dma;
+    unsigned transfers = 0;
+    uint64_t start = sim.cycle;
+    for (unsigned line=0; line < opts.lines; line += max_dma) {
+      unsigned lines = min(max_dma, opts.lines - line);
+      sim.mmioWrite(MMIO_RD_ADDR, INPUT_ADDR + line*CL_BYTES);
+      sim.mmioWrite(MMIO_WR_ADDR, OUTPUT_ADDR + line*CL_BYTES);
+
+      // Only the last transfer of the job can end with a partial line.
+      if (line + lines == opts.lines && opts.last_bytes != 0)
+	sim.mmioWrite(MMIO_BYTES, (lines-1)*CL_BYTES + opts.last_bytes);
+      else
+	sim.mmioWrite(MMIO_SIZE, lines);
+
+      uint64_t completed = sim.mmioRead(MMIO_JOBS_COMPLETED);
+      sim.mmioWrite(MMIO_GO, 1);
+      while (sim.mmioRead(MMIO_JOBS_COMPLETED) == completed) {
+	if (sim.cycle - start > opts.timeout)
+	  throw runtime_error("ERROR: Job didn't finish within the timeout.");
+      }
+      transfers++;
+    }
+    uint64_t cycles = sim.cycle - start;
+
+    uint64_t perf[12];
+    for (unsigned i=0; i < 12; i++)
+      perf[i] = sim.mmioRead(MMIO_PERF + 2*i);
+
+    // Verify the output array. The bytes after a partial last line must
+    // not have been written.
+    size_t bytes = input.size()*sizeof(uint32_t);
+    size_t written = opts.last_bytes == 0 ? bytes : bytes - CL_BYTES + opts.last_bytes;
+    vector<uint8_t> output(bytes);
+    const uint8_t* expected = reinterpret_cast<const uint8_t*>(input.data());
+    sim.mem.read(OUTPUT_ADDR, output.data(), bytes);
+    unsigned errors = 0;
+    for (size_t i=0; i < bytes; i++) {
+      if (output[i] != (i < written ? expected[i] : 0))
+	errors++;
+    }
+
+    auto percent = [cycles](uint64_t count) {
+      return 100.0 * count / cycles;
+    };
+
+    cout << fixed << setprecision(3)
+	 << "Lines: " << opts.lines << ", burst length: " << opts.burst_len
+	 << (opts.mem.out_of_order ? ", out-of-order reads" : "")
+	 << ", transfers: " << transfers << "\n"
+	 << "Cycles: " << cycles
+	 << ", lines per cycle: " << double(opts.lines) / cycles << "\n"
+	 << setprecision(1)
+	 << "  Active cycles: " << perf[0]
+	 << ", read requests: " << perf[1]
+	 << ", read responses: " << perf[2]
+	 << ", write requests: " << perf[3] << "\n"
+	 << "  Read stalls: c0TxAlmFull " << perf[4] << " (" << percent(perf[4]) << "%)"
+	 << ", FIFO " << perf[5] << " (" << percent(perf[5]) << "%)"
+	 << ", rd_en " << perf[6] << " (" << percent(perf[6]) << "%)\n"
+	 << "  Write stalls: c1TxAlmFull " << perf[7] << " (" << percent(perf[7]) << "%)"
+	 << ", wr_en " << perf[8] << " (" << percent(perf[8]) << "%)\n"
+	 << "  Read latency (cycles): min " << perf[9]
+	 << ", max " << perf[10]
+	 << ", mean " << (perf[2] ? double(perf[11]) / perf[2] : 0.0) << "\n"
+	 << "  Host memory almost full (cycles): reads " << sim.rd_alm_full_cycles
+	 << ", writes " << sim.wr_alm_full_cycles << endl;
+
+    if (errors > 0) {
+      cout << "Failed with " << errors << " errors." << endl;
+      return EXIT_FAILURE;
+    }
+
+    cout << "Succeeded." << endl;
+    return EXIT_SUCCESS;
+  }
+  catch (const runtime_error& e) {
+    cerr << e.what() << endl;
+  }
+
+  return EXIT_FAILURE;
+}
+
+
+void printUsage(char *name) {
+
+  cout << "Usage: " << name << " [options]\n"
+       << "--lines n (cache lines to transfer, default 4096)\n"
+       << "--burst n (maximum cache lines per memory request: 1, 2, or 4, default 4)\n"
+       << "--max-dma n (maximum cache lines per DMA transfer, default 0 for one transfer)\n"
+       << "--last-bytes n (bytes to write from the last cache line, default 0 for all 64)\n"
+       << "--rd-latency n (read latency in cycles, default 100)\n"
+       << "--rd-jitter n (maximum additional random read latency, default 0)\n"
+       << "--wr-latency n (write latency in cycles, default 50)\n"
+       << "--rd-bw x (read bandwidth in cache lines per cycle, default 1.0)\n"
+       << "--wr-bw x (write bandwidth in cache lines per cycle, default 1.0)\n"
+       << "--rd-alm-full n (outstanding read lines that assert c0TxAlmFull, default 256)\n"
+       << "--wr-alm-full n (outstanding write lines that assert c1TxAlmFull, default 128)\n"
+       << "--out-of-order (return reads out of order, requires REORDER=1)\n"
+       << "--seed n (random seed, default 1)\n"
+       << "--timeout n (maximum cycles, default 10000000)"
+       << endl;
+}
+
+
+bool checkUsage(int argc, char *argv[], Options &opts) {
+
+  try {
+    for (int i=1; i < argc; i++) {
+      string arg = argv[i];
+
+      // Skip Verilator's +args.
+      if (arg[0] == '+')
+	continue;
+
+      if (arg == "--out-of-order") {
+	if (!REORDER_READS) {
+	  cerr << "ERROR: Out-of-order reads require building with REORDER=1." << endl;
+	  return false;
+	}
+	opts.mem.out_of_order = true;
+	continue;
+      }
+
+      if (i+1 >= argc)
+	return false;
+
+      string value = argv[++i];
+      if (arg == "--lines")
+	opts.lines = stoul(value);
+      else if (arg == "--burst")
+	opts.burst_len = stoul(value);
+      else if (arg == "--max-dma")
+	opts.max_dma = stoul(value);
+      else if (arg == "--last-bytes")
+	opts.last_bytes = stoul(value);
+      else if (arg == "--rd-latency")
+	opts.mem.rd_latency = stoul(value);
+      else if (arg == "--rd-jitter")
+	opts.mem.rd_jitter = stoul(value);
+      else if (arg == "--wr-latency")
+	opts.mem.wr_latency = stoul(value);
+      else if (arg == "--rd-bw")
+	opts.mem.rd_bandwidth = stod(value);
+      else if (arg == "--wr-bw")
+	opts.mem.wr_bandwidth = stod(value);
+      else if (arg == "--rd-alm-full")
+	opts.mem.rd_alm_full = stoul(value);
+      else if (arg == "--wr-alm-full")
+	opts.mem.wr_alm_full = stoul(value);
+      else if (arg == "--seed")
+	opts.mem.seed = stoul(value);
+      else if (arg == "--timeout")
+	opts.timeout = stoull(value);
+      else
+	return false;
+    }
+  }
+  catch (const logic_error& e) {
+    return false;
+  }
+
+  if (opts.lines == 0 || (opts.burst_len != 1 && opts.burst_len != 2 && opts.burst_len != 4))
+    return false;
+
+  if (opts.last_bytes >= CL_BYTES)
+    return false;
+
+  return true;
+}
@@ -0,0 +1,161 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+
+// Module Name:  sim_dma.sv
+// Description:  Top-level module for the Verilator simulation of a single
+//               DMA channel (see sim_dma.cpp). It connects cci_dma.sv to
+//               the loopback channel (memory map, job queue, descriptor
+//               ring, and CRCs), and replaces the CCI-P structs with
+//               individual signals, so the C++ model of host memory doesn't
+//               depend on the bit layout of the CCI-P headers.
+//
+//               The MMIO signals use the protocol in mmio_if.vh, where read
+//               data is available the cycle after rd_en.
+
+//===================================================================
+// Parameter Description
+// REORDER_READS : Enables the reorder buffer of cci_dma.sv, which is
+//                 required when the host model returns read responses out
+//                 of order.
+//===================================================================
+
+`include "cci_mpf_if.vh"
+`include "dma_if.vh"
+`include "mmio_if.vh"
+
+module sim_dma
+  #(
+    parameter bit REORDER_READS=0
+    )
+   (
+    input logic 	 clk,
+    input logic 	 rst,
+
+    // MMIO
+    input logic 	 mmio_rd_en,
+    input logic 	 mmio_wr_en,
+    input logic [15:0] 	 mmio_rd_addr,
+    input logic [15:0] 	 mmio_wr_addr,
+    input logic [63:0] 	 mmio_wr_data,
+    output logic [63:0]  mmio_rd_data,
+
+    // Read requests
+    output logic 	 c0_req_valid,
+    output logic [63:0]  c0_req_addr,
+    output logic [2:0] 	 c0_req_lines,
+    output logic [15:0]  c0_req_mdata,
+    input logic 	 c0_alm_full,
+
+    // Read responses (one cache line per response)
+    input logic 	 c0_rsp_valid,
+    input logic [15:0] 	 c0_rsp_mdata,
+    input logic [1:0] 	 c0_rsp_cl_num,
+    input logic [511:0]  c0_rsp_data,
+
+    // Write requests (one cache line per request)
+    output logic 	 c1_req_valid,
+    output logic [63:0]  c1_req_addr,
+    output logic [5:0] 	 c1_req_byte_len,
+    output logic [511:0] c1_req_data,
+    input logic 	 c1_alm_full,
+
+    // Asserted when there are no outstanding reads/writes
+    input logic 	 c0_empty,
+    input logic 	 c1_empty
+    );
+
+   localparam int VIRTUAL_BYTE_ADDR_WIDTH = 64;
+
+   t_if_cci_mpf_c0_Tx c0Tx;
+   t_if_cci_mpf_c1_Tx c1Tx;
+   t_if_cci_c0_Rx c0Rx;
+
+   mmio_if
+     #(
+       .DATA_WIDTH(64),
+       .ADDR_WIDTH(16),
+       .START_ADDR(0),
+       .END_ADDR(0)
+       ) mmio();
+
+   dma_if
+     #(
+       .DATA_WIDTH($size(t_ccip_clData)),
+       .ADDR_WIDTH(VIRTUAL_BYTE_ADDR_WIDTH),
+       .SIZE_WIDTH($size(t_ccip_clAddr)+1)
+       ) dma();
+
+   cci_dma
+     #(
+       .REORDER_READS(REORDER_READS)
+       )
+   dma_ctrl
+     (
+      .clk(clk),
+      .rst(rst),
+      .c0Tx(c0Tx),
+      .c0TxAlmFull(c0_alm_full),
+      .c0TxReq(),
+      .c1Tx(c1Tx),
+      .c1TxAlmFull(c1_alm_full),
+      .c1TxArbStall(1'b0),
+      .c1TxReq(),
+      .c1TxLock(),
+      .c0Rx(c0Rx),
+      .dma(dma),
+      .c0Empty(c0_empty),
+      .c1Empty(c1_empty)
+      );
+
+   loopback_channel channel
+     (
+      .clk,
+      .rst,
+      .mmio(mmio),
+      .dma(dma)
+      );
+
+   assign mmio.rd_en = mmio_rd_en;
+   assign mmio.wr_en = mmio_wr_en;
+   assign mmio.rd_addr = mmio_rd_addr;
+   assign mmio.wr_addr = mmio_wr_addr;
+   assign mmio.wr_data = mmio_wr_data;
+   assign mmio_rd_data = mmio.rd_data;
+
+   // The headers use cache-line addresses.
+   assign c0_req_valid = c0Tx.valid;
+   assign c0_req_addr = 64'(c0Tx.hdr.base.address) << 6;
+   assign c0_req_lines = 3'(c0Tx.hdr.base.cl_len) + 3'd1;
+   assign c0_req_mdata = c0Tx.hdr.base.mdata;
+
+   // Full cache-line writes have a byte length of 0.
+   assign c1_req_valid = c1Tx.valid;
+   assign c1_req_addr = 64'(c1Tx.hdr.base.address) << 6;
+   assign c1_req_byte_len = c1Tx.hdr.base.mode == eMOD_BYTE ? 6'(c1Tx.hdr.base.byte_len) : 6'd0;
+   assign c1_req_data = c1Tx.data;
+
+   always_comb begin
+      c0Rx = '0;
+      c0Rx.rspValid = c0_rsp_valid;
+      c0Rx.hdr.resp_type = eRSP_RDLINE;
+      c0Rx.hdr.mdata = c0_rsp_mdata;
+      c0Rx.hdr.cl_num = t_ccip_clNum'(c0_rsp_cl_num);
+      c0Rx.data = c0_rsp_data;
+   end
+
+endmodule
@@ -0,0 +1,313 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+//
+// Description: This application streams random inputs through the
+// Verilator model of an exercise pipeline (sim_pipeline.sv), verifies every
+// result, and reports the latency and the number of results per cycle.
+// Building with FLOAT_PIPELINE selects the float pipeline, whose inputs and
+// result are 32-bit floats. Also defining BF16_PIPELINE packs 32 bfloat16
+// inputs into each cache line instead, which tests the float pipeline's
+// bfloat16 mode.
+//
+// The simple pipeline's operation is selected with op (see
+// pipe_pkg::op_t), and is fixed for the entire simulation.
+//
+// Inputs are provided with probability valid_rate each cycle, which
+// models a DMA that can't provide a cache line every cycle. A correct
+// pipeline produces results at the same rate.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <deque>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <stdexcept>
+
+#include "verilated.h"
+#include "Vsim_pipeline.h"
+
+using namespace std;
+
+// The number of 32-bit words in the inputs, and the number of pipeline
+// inputs packed into those words.
+const unsigned NUM_WORDS = 16;
+#ifdef BF16_PIPELINE
+const unsigned NUM_INPUTS = 32;
+#else
+const unsigned NUM_INPUTS = NUM_WORDS;
+#endif
+
+
+#ifdef FLOAT_PIPELINE
+
+// Floating-point operations for the behavioral cores in float_ip.sv.
+extern "C" int float_mult(int a, int b) {
+
+  float x, y, z;
+  memcpy(&x, &a, sizeof(float));
+  memcpy(&y, &b, sizeof(float));
+  z = x * y;
+  memcpy(&a, &z, sizeof(float));
+  return a;
+}
+
+
+extern "C" int float_add(int a, int b) {
+
+  float x, y, z;
+  memcpy(&x, &a, sizeof(float));
+  memcpy(&y, &b, sizeof(float));
+  z = x + y;
+  memcpy(&a, &z, sizeof(float));
+  return a;
+}
+
+
+// Random floats with small magnitudes, so the results don't overflow.
+// bfloat16 inputs are the upper 16 bits of a float, which the pipeline
+// converts back to a float by appending 16 zeros.
+uint32_t randomInput(mt19937& rng) {
+
+  uniform_real_distribution<float> dist(-100.0, 100.0);
+  float x = dist(rng);
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(float));
+#ifdef BF16_PIPELINE
+  bits &= 0xffff0000;
+#endif
+  return bits;
+}
+
+
+// Uses the same order of operations as the pipeline's adder tree, so the
+// results match exactly. The float pipeline has no operations.
+uint64_t reference(const uint32_t* inputs, unsigned op) {
+
+  int level[NUM_INPUTS/2];
+  for (unsigned i=0; i < NUM_INPUTS/2; i++)
+    level[i] = float_mult(inputs[2*i], inputs[2*i+1]);
+
+  for (unsigned n=NUM_INPUTS/4; n > 0; n /= 2) {
+    for (unsigned i=0; i < n; i++)
+      level[i] = float_add(level[2*i], level[2*i+1]);
+  }
+
+  return uint32_t(level[0]);
+}
+
+#else
+
+uint32_t randomInput(mt19937& rng) {
+
+  return rng();
+}
+
+
+// Operations of the simple pipeline, which match pipe_pkg::op_t.
+enum Op {OP_SUM_OF_PRODUCTS, OP_SUM, OP_MIN, OP_MAX, OP_SUM_OF_SQUARES, NUM_OPS};
+
+// The multiply-add tree ignores carries out of 64 bits.
+uint64_t reference(const uint32_t* inputs, unsigned op) {
+
+  uint64_t sum = 0;
+  uint64_t extreme = inputs[0];
+  for (unsigned i=0; i < NUM_INPUTS; i++) {
+    uint64_t x = inputs[i];
+    switch (op) {
+    case OP_SUM: sum += x; break;
+    case OP_MIN: extreme = min(extreme, x); break;
+    case OP_MAX: extreme = max(extreme, x); break;
+    case OP_SUM_OF_SQUARES: sum += x * x; break;
+    default: if (i % 2 == 0) sum += x * inputs[i+1];
+    }
+  }
+
+  return op == OP_MIN || op == OP_MAX ? extreme : sum;
+}
+
+#endif
+
+
+void printUsage(char *name);
+bool checkUsage(int argc, char *argv[], unsigned long &num_inputs, double &valid_rate, unsigned long &seed, unsigned &op);
+
+int main(int argc, char *argv[]) {
+
+  unsigned long num_inputs, seed;
+  double valid_rate;
+  unsigned op;
+  Verilated::commandArgs(argc, argv);
+  if (!checkUsage(argc, argv, num_inputs, valid_rate, seed, op)) {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  Vsim_pipeline *top = new Vsim_pipeline;
+  mt19937 rng(seed);
+  bernoulli_distribution valid(valid_rate);
+  deque<uint64_t> expected;
+  unsigned long sent = 0, received = 0, errors = 0;
+  uint64_t cycle = 0, first_in = 0, first_out = 0, last_out = 0;
+
+  top->clk = 0;
+  top->rst = 1;
+  top->en = 1;
+  top->valid_in = 0;
+  top->op = op;
+  top->eval();
+  for (unsigned i=0; i < 4; i++) {
+    top->clk = 1;
+    top->eval();
+    top->clk = 0;
+    top->eval();
+  }
+  top->rst = 0;
+
+  // Allow enough cycles to drain the pipeline after the last input.
+  const uint64_t timeout = num_inputs / valid_rate * 2 + 1000;
+
+  while (received < num_inputs && cycle < timeout) {
+
+    top->valid_in = sent < num_inputs && valid(rng);
+    if (top->valid_in) {
+      uint32_t inputs[NUM_INPUTS];
+      for (unsigned i=0; i < NUM_INPUTS; i++)
+	inputs[i] = randomInput(rng);
+
+      // Pack the inputs into the words of the cache line, with bfloat16
+      // inputs in the upper 16 bits of each float.
+      for (unsigned i=0; i < NUM_WORDS; i++) {
+#ifdef BF16_PIPELINE
+	top->inputs[i] = (inputs[2*i] >> 16) | (inputs[2*i+1] & 0xffff0000);
+#else
+	top->inputs[i] = inputs[i];
+#endif
+      }
+
+      expected.push_back(reference(inputs, op));
+      if (sent == 0)
+	first_in = cycle;
+      sent++;
+    }
+
+    top->clk = 1;
+    top->eval();
+
+    if (top->valid_out) {
+      if (expected.empty() || top->result != expected.front())
+	errors++;
+      if (!expected.empty())
+	expected.pop_front();
+
+      if (received == 0)
+	first_out = cycle;
+      last_out = cycle;
+      received++;
+    }
+
+    top->clk = 0;
+    top->eval();
+    cycle++;
+  }
+
+  top->final();
+  delete top;
+
+  if (received < num_inputs) {
+    cerr << "ERROR: Pipeline produced " << received << " of " << num_inputs
+	 << " results." << endl;
+    return EXIT_FAILURE;
+  }
+
+  // An input is registered on the rising edge of its cycle, and its result
+  // is read on the rising edge after valid_out is asserted, hence the +1.
+  uint64_t cycles = last_out - first_out + 1;
+  cout << fixed << setprecision(3)
+       << "Results: " << received << ", latency: " << first_out - first_in + 1
+       << " cycles\n"
+       << "Cycles: " << cycles
+       << ", results per cycle: " << double(received) / cycles
+       << " (input rate " << valid_rate << ")" << endl;
+
+  if (errors > 0) {
+    cout << "Failed with " << errors << " errors." << endl;
+    return EXIT_FAILURE;
+  }
+
+  cout << "Succeeded." << endl;
+  return EXIT_SUCCESS;
+}
+
+
+void printUsage(char *name) {
+
+  cout << "Usage: " << name << " num_inputs [valid_rate] [seed] [op]\n"
+       << "num_inputs (positive integer amount of inputs to send through the pipeline)\n"
+       << "valid_rate (probability of an input each cycle in (0, 1], default 1.0)\n"
+       << "seed (random seed, default 1)\n"
+       << "op (simple pipeline only: 0 sum of products, 1 sum, 2 min, 3 max, 4 sum of squares, default 0)"
+       << endl;
+}
+
+
+bool checkUsage(int argc, char *argv[], unsigned long &num_inputs, double &valid_rate, unsigned long &seed, unsigned &op) {
+
+  valid_rate = 1.0;
+  seed = 1;
+  op = 0;
+
+  // Ignore Verilator's +args.
+  int num_args = 0;
+  char *args[4];
+  for (int i=1; i < argc; i++) {
+    if (argv[i][0] == '+')
+      continue;
+    if (num_args == 4)
+      return false;
+    args[num_args++] = argv[i];
+  }
+
+  if (num_args < 1)
+    return false;
+
+  try {
+    num_inputs = stoul(args[0]);
+    if (num_args >= 2)
+      valid_rate = stod(args[1]);
+    if (num_args >= 3)
+      seed = stoul(args[2]);
+    if (num_args == 4)
+      op = stoul(args[3]);
+  }
+  catch (const logic_error& e) {
+    return false;
+  }
+
+#ifdef FLOAT_PIPELINE
+  if (op != 0)
+    return false;
+#else
+  if (op >= NUM_OPS)
+    return false;
+#endif
+
+  return num_inputs > 0 && valid_rate > 0 && valid_rate <= 1.0;
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+// Module Name:  sim_pipeline.sv
+// Description:  Top-level module for the Verilator simulation of the
+//               exercise pipelines (see sim_pipeline.cpp). It flattens the
+//               array of 16 32-bit inputs into a single cache line, so the
+//               C++ testbench can drive it like the DMA read data, and
+//               zero-extends the result to 64 bits so the same top level
+//               works for the simple (64-bit) and float (32-bit) pipelines.
+//               With BF16 set, the cache line is unpacked into 32 bfloat16
+//               inputs that are converted to 32-bit floats like the float
+//               pipeline's AFU, which tests its bfloat16 mode.
+//               Defining SIMPLE_PIPELINE connects the op input to the simple
+//               pipeline, which is the only pipeline with an operation.
+
+//===================================================================
+// Parameter Description
+// RESULT_WIDTH : Width of the pipeline's result (64 for the simple
+//                pipeline, 32 for the float pipeline).
+// BF16         : Unpacks 32 bfloat16 inputs instead of 16 32-bit inputs
+//                (float pipeline only).
+//===================================================================
+
+//===================================================================
+// Interface Description
+// clk  : Clock input
+// rst  : Reset input (active high)
+// en   : Activates pipeline when asserted (active high), stalls when 0
+// valid_in : Specifies validity of data on inputs.
+// op   : The operation of the simple pipeline (see pipe_pkg::op_t).
+// inputs : 16 32-bit inputs, where input i is in bits 32*i+31:32*i, or
+//          32 bfloat16 inputs, where input i is in bits 16*i+15:16*i.
+// result : The result, zero extended to 64 bits.
+// valid_out : Asserted when result contains valid data (active high)
+//===================================================================
+
+module sim_pipeline
+  #(
+    parameter int RESULT_WIDTH=64,
+    parameter bit BF16=0
+    )
+  (
+    input 		clk,
+    input 		rst,
+    input 		en, 
+    input 		valid_in,
+    input [2:0] 	op,
+    input [511:0] 	inputs,
+    output logic [63:0] result,
+    output logic 	valid_out
+    );
+
+   localparam int NUM_INPUTS = BF16 ? 32 : 16;
+
+   logic [31:0] 	inputs_a[NUM_INPUTS];
+   logic [RESULT_WIDTH-1:0] pipe_result;
+
+   always_comb begin
+      for (int i=0; i < NUM_INPUTS; i++) begin
+	 if (BF16)
+	   inputs_a[i] = {inputs[i*16 +: 16], 16'h0};
+	 else
+	   inputs_a[i] = inputs[i*32 +: 32];
+      end
+   end
+
+   pipeline 
+     #(
+       .NUM_INPUTS(NUM_INPUTS)
+       )
+   pipeline
+     (
+      .clk,
+      .rst,
+      .en,
+      .valid_in,
+`ifdef SIMPLE_PIPELINE
+      .op(pipe_pkg::op_t'(op)),
+`endif
+      .inputs(inputs_a),
+      .result(pipe_result),
+      .valid_out
+      );
+
+   assign result = 64'(pipe_result);
+   
+endmodule
@@ -75,7 +75,7 @@ int main(int argc, char *argv[]) {
       cout << "Starting Test " << test << "...";
 
       // Initialize the input and output memory.
-      for (unsigned i=0; i < size; i++) {
+      for (uint64_t i=0; i < size; i++) {
 	input[i] = (dma_data_t) rand();
 	output[i] = 0;
       }
@@ -86,8 +86,8 @@ int main(int argc, char *argv[]) {
 
       // The FPGA DMA only handles cache-line transfers, so we need to convert
       // the array size to cache lines.
-      unsigned total_bytes = size*sizeof(dma_data_t);
-      unsigned num_cls = ceil((float) total_bytes / (float) AFU::CL_BYTES);
+      uint64_t total_bytes = size*sizeof(dma_data_t);
+      uint64_t num_cls = (total_bytes + AFU::CL_BYTES - 1) / AFU::CL_BYTES;
       afu.write(MMIO_SIZE, num_cls);
 
       // Start the FPGA DMA transfer.
@@ -104,7 +104,7 @@ int main(int argc, char *argv[]) {
       // NOTE: This could be replaced with memcp, but that is only possible
       // when not using volatile data (i.e. AFU::mallocNonvolatile()). 
       unsigned errors = 0;
-      for (unsigned i=0; i < size; i++) {
+      for (uint64_t i=0; i < size; i++) {
 	if (output[i] != input[i]) {
 	  errors++;
 	}
@@ -0,0 +1,215 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+
+// Module Name:  accumulator.sv
+// Project:      float pipeline
+// Description:  This module sums every group of LENGTH consecutive 32-bit
+//               float inputs into a single result, which the AFU uses to
+//               reduce the pipeline outputs of many cache lines into a
+//               single dot product.
+//
+//               A single accumulator register can't accept an input every
+//               cycle, because each add takes pipe_pkg::ADD_LATENCY cycles
+//               before its sum is available for the next add. Instead, the
+//               inputs of a group are interleaved across NUM_PARTIALS =
+//               ADD_LATENCY partial sums in round-robin order, so a partial
+//               sum is never updated again until its previous add has
+//               completed. When the last add of a group completes, the
+//               partial sums are merged with a small tree of adders, while
+//               the accumulator already starts on the next group.
+//
+//               Because the order of the adds is different from a
+//               sequential loop, the result can differ slightly from a
+//               software sum due to floating-point rounding.
+//
+//               The latency from the last input of a group to the result
+//               is pipe_pkg::ACC_LATENCY.
+
+//===================================================================
+// Parameter Description
+// LENGTH_WIDTH : The width of the length input.
+//===================================================================
+
+//===================================================================
+// Interface Description
+// clk  : Clock input
+// rst  : Reset input (active high)
+// length : The number of inputs in each group (must be at least 1). Must
+//          not change while a group is being accumulated.
+// valid_in : Specifies validity of data_in.
+// data_in : The 32-bit float input.
+// valid_out : Asserted when result contains valid data (active high)
+// result : The 32-bit float sum of a group of inputs.
+//===================================================================
+
+module accumulator
+  #(
+    parameter int LENGTH_WIDTH=32
+    )
+   (
+    input 		     clk,
+    input 		     rst,
+    input [LENGTH_WIDTH-1:0] length,
+    input 		     valid_in,
+    input [31:0] 	     data_in,
+    output logic 	     valid_out,
+    output logic [31:0]      result
+    );
+
+   localparam int NUM_PARTIALS = pipe_pkg::NUM_PARTIALS;
+   localparam int MERGE_INPUTS = 2**$clog2(NUM_PARTIALS);
+   localparam int MERGE_LEVELS = $clog2(MERGE_INPUTS);
+   localparam int MERGE_LATENCY = pipe_pkg::ADD_LATENCY*MERGE_LEVELS;
+   
+   // Information about each add, which is delayed alongside the adder.
+   // last : the last add of the group for the add's partial sum.
+   // group_end : the last add of the group.
+   typedef struct packed {
+      logic 	     valid;
+      logic [7:0]    partial;
+      logic 	     last;
+      logic 	     group_end;
+   } add_info_t;
+
+   logic [LENGTH_WIDTH-1:0] count_r;
+   logic [7:0] 		    partial_r;
+   logic [31:0] 	    partials_r[NUM_PARTIALS];
+   logic [31:0] 	    finals_r[NUM_PARTIALS];
+   logic [31:0] 	    add_b, sum;
+   add_info_t 		    add_info, info_r[pipe_pkg::ADD_LATENCY], sum_info;
+
+   // The first input of each partial sum in a group is added to 0, and the
+   // remaining inputs are added to the partial sum. When the previous add
+   // of the same partial sum completes in the same cycle, its sum hasn't
+   // been stored yet, so it comes directly from the adder.
+   always_comb begin
+      add_info.valid = valid_in;
+      add_info.partial = partial_r;
+      add_info.last = count_r + NUM_PARTIALS >= length;
+      add_info.group_end = count_r == length - 1'b1 || length == 0;
+
+      if (count_r < NUM_PARTIALS)
+	add_b = '0;
+      else if (sum_info.valid && sum_info.partial == partial_r)
+	add_b = sum;
+      else
+	add_b = partials_r[partial_r];
+   end
+
+   add_float acc_add
+     (
+      .a(data_in),
+      .areset(rst),
+      .b(add_b),
+      .clk(clk),
+      .en(1'b1),
+      .q(sum)
+      );
+
+   assign sum_info = info_r[pipe_pkg::ADD_LATENCY-1];
+
+   // The inputs of the merge tree, which are padded with 0 to a power of 2,
+   // and the outputs of each level of the tree.
+   logic [31:0] merge_r[MERGE_INPUTS];
+   logic [31:0] merge[MERGE_LEVELS+1][MERGE_INPUTS];
+   logic [MERGE_LATENCY:0] merge_valid_r;
+
+   always_ff @(posedge clk or posedge rst) begin
+      if (rst) begin
+	 count_r <= '0;
+	 partial_r <= '0;
+	 merge_valid_r <= '0;
+	 for (int i=0; i < pipe_pkg::ADD_LATENCY; i++) info_r[i] <= '0;
+	 for (int i=0; i < NUM_PARTIALS; i++) finals_r[i] <= '0;
+      end
+      else begin
+	 // Advance to the next input of the group, or start the next group.
+	 if (valid_in) begin
+	    if (add_info.group_end) begin
+	       count_r <= '0;
+	       partial_r <= '0;
+	    end
+	    else begin
+	       count_r <= count_r + 1'b1;
+	       partial_r <= partial_r == NUM_PARTIALS-1 ? '0 : partial_r + 1'b1;
+	    end
+	 end
+
+	 // Delay the add information by the latency of the adder.
+	 info_r[0] <= add_info;
+	 for (int i=1; i < pipe_pkg::ADD_LATENCY; i++) begin
+	    info_r[i] <= info_r[i-1];
+	 end
+
+	 // Store each completed add into its partial sum, and save the last
+	 // sum of each partial sum in the group for the merge.
+	 if (sum_info.valid) begin
+	    partials_r[sum_info.partial] <= sum;
+	    if (sum_info.last)
+	      finals_r[sum_info.partial] <= sum;
+	 end
+
+	 // Start the merge when the last add of the group completes. The
+	 // partial sums that weren't used by a short group are still 0.
+	 merge_valid_r[0] <= sum_info.valid && sum_info.group_end;
+	 for (int i=1; i <= MERGE_LATENCY; i++) begin
+	    merge_valid_r[i] <= merge_valid_r[i-1];
+	 end
+
+	 if (sum_info.valid && sum_info.group_end) begin
+	    for (int i=0; i < MERGE_INPUTS; i++) begin
+	       if (i >= NUM_PARTIALS)
+		 merge_r[i] <= '0;
+	       else if (i == sum_info.partial)
+		 merge_r[i] <= sum;
+	       else
+		 merge_r[i] <= finals_r[i];
+	    end
+
+	    for (int i=0; i < NUM_PARTIALS; i++) begin
+	       finals_r[i] <= '0;
+	    end
+	 end
+      end
+   end
+
+   // Generate the tree of adders that merges the partial sums.
+   genvar l, i;
+   generate
+      for (i=0; i < MERGE_INPUTS; i++) begin : gen_merge_inputs
+	 assign merge[0][i] = merge_r[i];
+      end
+      
+      for (l=0; l < MERGE_LEVELS; l++) begin : gen_merge_levels
+	 for (i=0; i < MERGE_INPUTS/2**(l+1); i++) begin : gen_merge_adds
+	    add_float merge_add (
+				 .a(merge[l][2*i]),
+				 .areset(rst),
+				 .b(merge[l][2*i+1]),
+				 .clk(clk),
+				 .en(1'b1),
+				 .q(merge[l+1][i])
+				 );
+	 end
+      end
+   endgenerate
+
+   assign result = merge[MERGE_LEVELS][0];
+   assign valid_out = merge_valid_r[MERGE_LATENCY];
+   
+endmodule
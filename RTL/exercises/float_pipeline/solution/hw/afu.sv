@@ -36,6 +36,24 @@
 //               the situation of ending without 16 results in the buffer to
 //               write to memory (i.e. an incomplete cache line on the final
 //               transfer.
+//
+//               For long dot products, software can also set a reduction
+//               length (reduce_len), in which case the AFU accumulates the
+//               pipeline results of reduce_len consecutive input cache lines
+//               into a single result (see accumulator.sv). Only the final
+//               dot products are written to memory, so the output traffic
+//               drops by a factor of reduce_len.
+//
+//               Software can also select bfloat16 inputs (bf16), in which
+//               case each cache line provides 32 inputs. A bfloat16 is the
+//               upper 16 bits of a 32-bit float, so each input is converted
+//               to a 32-bit float by appending 16 zeros, and the products
+//               and sums still use 32-bit floats. To support both formats,
+//               the pipeline is a 32-input tree. In 32-bit float mode, the
+//               16 inputs use the first half of the tree and the remaining
+//               inputs are 0, which doesn't change the sum. Each cache line
+//               produces one result in both modes, so bfloat16 doubles the
+//               number of multiplies per cache line.
 
 //               The AFU uses MMIO to receive the starting read adress, 
 //               starting write address, input_size (# of input cache lines), 
@@ -72,6 +90,12 @@ module afu
    localparam int RESULT_WIDTH = 32;
    localparam int INPUTS_PER_CL = CL_DATA_WIDTH / INPUT_WIDTH;   // 16
    localparam int RESULTS_PER_CL = CL_DATA_WIDTH / RESULT_WIDTH; // 16
+   localparam int BF16_WIDTH = 16;
+   localparam int BF16_INPUTS_PER_CL = CL_DATA_WIDTH / BF16_WIDTH; // 32
+
+   // The pipeline is sized for bfloat16 inputs.
+   localparam int PIPELINE_INPUTS = BF16_INPUTS_PER_CL;
+   localparam int PIPELINE_LATENCY = pipe_pkg::latency(PIPELINE_INPUTS);
        
    // 512 is the shallowest a block RAM can be in the Arria 10, so there's no 
    // point in making it smaller unless using MLABs instead.
@@ -86,6 +110,9 @@ module afu
    // module instantiation.
    typedef logic [CL_ADDR_WIDTH:0] count_t;   
    count_t 	input_size;
+   count_t      reduce_len;
+   count_t      output_size;
+   logic        bf16;
    logic 	go;
    logic 	done;
 
@@ -105,11 +132,18 @@ module afu
        )
      memory_map (.*);
 
-   // Slice the DMA read data (i.e. cache line) into 16 separate 32-bit inputs.
-   logic [INPUT_WIDTH-1:0] pipeline_inputs[INPUTS_PER_CL];
+   // Slice the DMA read data (i.e. cache line) into 16 separate 32-bit inputs,
+   // or 32 bfloat16 inputs that are converted to 32-bit floats.
+   logic [INPUT_WIDTH-1:0] pipeline_inputs[PIPELINE_INPUTS];
    always_comb begin
-      for (int i=0; i < INPUTS_PER_CL; i++) begin
-	 pipeline_inputs[i] = dma.rd_data[INPUT_WIDTH*i +: INPUT_WIDTH];
+      for (int i=0; i < PIPELINE_INPUTS; i++) begin
+	 if (bf16)
+	   pipeline_inputs[i] = {dma.rd_data[BF16_WIDTH*i +: BF16_WIDTH], 
+				 {INPUT_WIDTH-BF16_WIDTH{1'b0}}};
+	 else if (i < INPUTS_PER_CL)
+	   pipeline_inputs[i] = dma.rd_data[INPUT_WIDTH*i +: INPUT_WIDTH];
+	 else
+	   pipeline_inputs[i] = '0;
       end      
    end
 
@@ -122,13 +156,48 @@ module afu
    // The pipeline has valid inputs everytime data is read from the DMA, and
    // has a valid output when pipeline_valid_out is asserted, with the result
    // showing up on pipeline_result.
-   pipeline pipeline (.clk,
-		      .rst,
-		      .en(1'b1),
-		      .valid_in(dma.rd_en),
-		      .inputs(pipeline_inputs),
-		      .result(pipeline_result),
-		      .valid_out(pipeline_valid_out));
+   pipeline
+     #(
+       .NUM_INPUTS(PIPELINE_INPUTS)
+       )
+   pipeline
+     (
+      .clk,
+      .rst,
+      .en(1'b1),
+      .valid_in(dma.rd_en),
+      .inputs(pipeline_inputs),
+      .result(pipeline_result),
+      .valid_out(pipeline_valid_out)
+      );
+
+   logic acc_valid_out;
+   logic [RESULT_WIDTH-1:0] acc_result;
+
+   // Accumulate the pipeline results of every reduce_len input cache lines
+   // into a single dot product.
+   accumulator
+     #(
+       .LENGTH_WIDTH(CL_ADDR_WIDTH+1)
+       )
+   accumulator
+     (
+      .clk,
+      .rst,
+      .length(reduce_len),
+      .valid_in(pipeline_valid_out),
+      .data_in(pipeline_result),
+      .valid_out(acc_valid_out),
+      .result(acc_result)
+      );
+
+   // Without a reduction length, every pipeline result is an output.
+   logic                    reduce;
+   logic                    result_valid;
+   logic [RESULT_WIDTH-1:0] result;
+   assign reduce = reduce_len > 1;
+   assign result_valid = reduce ? acc_valid_out : pipeline_valid_out;
+   assign result = reduce ? acc_result : pipeline_result;
 
    logic 		    fifo_rd_en, fifo_empty, fifo_almost_full;
    logic [RESULT_WIDTH-1:0] fifo_rd_data;
@@ -151,21 +220,21 @@ module afu
        .WIDTH(RESULT_WIDTH),
        .DEPTH(FIFO_DEPTH),
        // This leaves enough space to absorb the entire contents of the
-       // pipeline when there is a stall.
-       .ALMOST_FULL_COUNT(FIFO_DEPTH-pipe_pkg::PIPE_LATENCY)
+       // pipeline and the accumulator when there is a stall.
+       .ALMOST_FULL_COUNT(FIFO_DEPTH-PIPELINE_LATENCY-pipe_pkg::ACC_LATENCY)
        )
    absorption_fifo 
      (
       .clk(clk),
       .rst(rst),
       .rd_en(fifo_rd_en),
-      .wr_en(pipeline_valid_out),
+      .wr_en(result_valid),
       .empty(fifo_empty),
       .full(), // Not used in an absorption FIFO.
       .almost_full(fifo_almost_full),
       .count(),
       .space(),
-      .wr_data(pipeline_result),
+      .wr_data(result),
       .rd_data(fifo_rd_data)
       );
 
@@ -225,8 +294,10 @@ module afu
 
    // For every input cache line, we get 16 32-bit inputs. These inputs produce
    // one 32-bit output. We can store 16 outputs in a cache line, so there is
-   // one output cache line for every 16 input cache lines.
-   assign dma.wr_size = input_size >> 4;
+   // one output cache line for every 16 input cache lines. When reducing,
+   // software provides the number of output cache lines, which avoids
+   // dividing by reduce_len.
+   assign dma.wr_size = reduce ? output_size : input_size >> 4;
 
    // Start both the read and write channels when the MMIO go is received.
    // Note that writes don't actually occur until dma.wr_en is asserted.
@@ -24,6 +24,9 @@
 //               rd_addr    : h0052,
 //               wr_addr    : h0054,
 //               input_size : h0056
+//               reduce_len : h005A
+//               output_size : h005C
+//               bf16       : h005E
 //
 //               and provides one output to software:
 //               done    : h0058
@@ -31,6 +34,15 @@
 //               rd_addr and wr_addr are both 64-bit virtual byte addresses.
 //               input_size is the number of input cache lines to transfer
 //               go starts the AFU and done signals completion.
+//
+//               reduce_len is the number of input cache lines that are
+//               accumulated into each result. 0 and 1 produce one result
+//               per input cache line. When reduce_len is larger than 1,
+//               output_size specifies the number of output cache lines.
+//
+//               bf16 selects bfloat16 inputs (32 per cache line) instead of
+//               32-bit floats (16 per cache line). The products and sums are
+//               32-bit floats for both formats.
 
 //==========================================================================
 // Parameter Description
@@ -50,6 +62,9 @@
 // rd_addr : the starting read address for the DMA transfer
 // wr_addr : the starting write address for the DMA transfer
 // input_size : the number of input cache lines to transfer
+// reduce_len : the number of input cache lines per result
+// output_size : the number of output cache lines when reduce_len > 1
+// bf16    : Asserted when the inputs are bfloat16
 // go      : starts the DMA transfer
 // done    : Asserted when the DMA transfer is complete
 //==========================================================================
@@ -67,6 +82,9 @@ module memory_map
    
    output logic [ADDR_WIDTH-1:0] rd_addr, wr_addr,
    output logic [SIZE_WIDTH-1:0] input_size,
+   output logic [SIZE_WIDTH-1:0] reduce_len,
+   output logic [SIZE_WIDTH-1:0] output_size,
+   output logic        bf16,
    output logic        go,
    input logic 	       done   
    );
@@ -80,6 +98,9 @@ module memory_map
 	 rd_addr    <= '0;
 	 wr_addr    <= '0;	     
 	 input_size <= '0;
+	 reduce_len <= '0;
+	 output_size <= '0;
+	 bf16 <= 1'b0;
       end
       else begin
 	 go <= '0;
@@ -90,6 +111,9 @@ module memory_map
 	      16'h0052: rd_addr    <= mmio.wr_data[$size(rd_addr)-1:0];
 	      16'h0054: wr_addr    <= mmio.wr_data[$size(wr_addr)-1:0];
 	      16'h0056: input_size <= mmio.wr_data[$size(input_size)-1:0];
+	      16'h005A: reduce_len <= mmio.wr_data[$size(reduce_len)-1:0];
+	      16'h005C: output_size <= mmio.wr_data[$size(output_size)-1:0];
+	      16'h005E: bf16 <= mmio.wr_data[0];
             endcase
          end
       end
@@ -113,6 +137,9 @@ module memory_map
 	      16'h0054: mmio.rd_data[$size(wr_addr)-1:0]    <= wr_addr;
 	      16'h0056: mmio.rd_data[$size(input_size)-1:0] <= input_size;     
 	      16'h0058: mmio.rd_data[0] 		    <= done;
+	      16'h005A: mmio.rd_data[$size(reduce_len)-1:0] <= reduce_len;
+	      16'h005C: mmio.rd_data[$size(output_size)-1:0] <= output_size;
+	      16'h005E: mmio.rd_data[0]                     <= bf16;
 	      
 	      // If the processor requests an address that is unused, return 0.
               default:  mmio.rd_data 			    <= 64'h0;
@@ -26,12 +26,18 @@ package pipe_pkg;
    localparam int MULT_LATENCY = 3;
    localparam int ADD_LATENCY  = 3;
 
-   // Normally I would make this a function of the number of inputs, but since
-   // the pipeline is hardcoded for a specific number of inputs in this example,
-   // this will suffice.
-   // The *3 is because of the 3 levels of adders. The +1 is for the 
-   // registered inputs.    
-   localparam int PIPE_LATENCY = MULT_LATENCY + ADD_LATENCY*3 + 1;
+   // Latency of a pipeline (see pipeline.sv) with num_inputs inputs, which
+   // has log2(num_inputs/2) levels of adders. The +1 is for the registered
+   // inputs.
+   function automatic int latency(int num_inputs);
+      return MULT_LATENCY + ADD_LATENCY*$clog2(num_inputs/2) + 1;
+   endfunction
+
+   // The accumulator (see accumulator.sv) interleaves one partial sum per
+   // cycle of adder latency, and merges the partial sums with a tree of
+   // adders. The +1 is for the registered inputs of the tree.
+   localparam int NUM_PARTIALS = ADD_LATENCY;
+   localparam int ACC_LATENCY = ADD_LATENCY + 1 + ADD_LATENCY*$clog2(NUM_PARTIALS);
 
 endpackage
 
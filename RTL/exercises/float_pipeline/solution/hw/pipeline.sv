@@ -18,10 +18,12 @@
 
 // Module Name:  pipeline.sv
 // Project:      simple pipeline
-// Description:  This pipelines takes 16 32-bit floats, multiplies 
-//               each pair of inputs to generate 8 32-bit float products, and 
-//               then adds those products to generate a 32-bit float result.
-//               All operations use 32-bit floats.
+// Description:  This pipelines takes NUM_INPUTS 32-bit floats, multiplies 
+//               each pair of inputs to generate NUM_INPUTS/2 32-bit float
+//               products, and then adds those products with a tree of adders
+//               to generate a 32-bit float result. All operations use 32-bit
+//               floats. With the default parameters, the pipeline takes 16
+//               inputs, which is one cache line of 32-bit floats.
 //
 //               The pipeline implements the functionality as a complete
 //               multiply-add tree in order to imitate the simple_pipeline
@@ -44,90 +46,89 @@
 
 import pipe_pkg::*;
 
+//===================================================================
+// Parameter Description
+// NUM_INPUTS : The number of inputs. Must be a power of 2 and at least 2.
+//===================================================================
+
 //===================================================================
 // Interface Description
 // clk  : Clock input
 // rst  : Reset input (active high)
 // en   : Activates pipeline when asserted (active high), stalls when 0
 // valid_id : Specifies validity of data on inputs.
-// inputs : An array of 16 32-bit float inputs.
+// inputs : An array of NUM_INPUTS 32-bit float inputs.
 // result : The 32-bit float result.
 // valid_out : Asserted when result contains valid data (active high)
 //===================================================================
 
 module pipeline
+  #(
+    parameter int NUM_INPUTS=16
+    )
   (
     input 		clk,
     input 		rst,
     input 		en, 
     input 		valid_in,
-    input [31:0] 	inputs[16],
+    input [31:0] 	inputs[NUM_INPUTS],
     output logic [31:0] result,
     output logic 	valid_out
     );
 
-   // Signals for each row of the multiply-add tree.
-   logic [31:0] 		   inputs_r[16];
-   logic [31:0] 		   mult_out[8];
-   logic [31:0] 		   add_out_l1[4];
-   logic [31:0] 		   add_out_l2[2];
+   localparam int NUM_PRODUCTS = NUM_INPUTS / 2;
+   localparam int ADD_LEVELS = $clog2(NUM_PRODUCTS);
+   localparam int LATENCY = pipe_pkg::latency(NUM_INPUTS);
+
+   initial begin
+      if (NUM_INPUTS < 2 || 2**$clog2(NUM_INPUTS) != NUM_INPUTS)
+	$error("NUM_INPUTS must be a power of 2 that is at least 2.");
+   end
+
+   // Signals for each row of the multiply-add tree. tree[0] contains the
+   // multiplier outputs, and tree[i] contains the outputs of level i of the
+   // adders, which only uses the first NUM_PRODUCTS/2**i elements.
+   logic [31:0] 		   inputs_r[NUM_INPUTS];
+   logic [31:0] 		   tree[ADD_LEVELS+1][NUM_PRODUCTS];
 
-   // Delays valid_in by pipe_pkg::PIPE_LATENCY cycles.
-   logic 			   delay_r[pipe_pkg::PIPE_LATENCY];
+   // Delays valid_in by LATENCY cycles.
+   logic 			   delay_r[LATENCY];
 
-   genvar 			   i;
+   genvar 			   i, j;
 
-   // Generate the 8 multipliers.
+   // Generate the multipliers.
    generate
-      for (i=0; i < 8; i++) begin : gen_mults
+      for (i=0; i < NUM_PRODUCTS; i++) begin : gen_mults
 	 mult_float mult (
 			.a(inputs_r[2*i]),
 			.areset(rst),
 			.b(inputs_r[2*i+1]),
 			.clk(clk),
 			.en(en),
-			.q(mult_out[i])
-			);
-      end
-   endgenerate
-
-   // Generate the first level of adders to add the 4 multiplier outputs.
-   generate
-      for (i=0; i < 4; i++) begin : gen_add_l1
-	 add_float add_l1 (
-			.a(mult_out[2*i]),
-			.areset(rst),
-			.b(mult_out[2*i+1]),
-			.clk(clk),
-			.en(en),
-			.q(add_out_l1[i])
+			.q(tree[0][i])
 			);
       end
    endgenerate
 
-   // Generate the second level of adders to add the 2 level 1 adder outputs.
+   // Generate each level of adders, which adds pairs of outputs from the
+   // previous level.
    generate
-      for (i=0; i < 2; i++) begin : gen_add_l2
-	 add_float add_l2 (
-			.a(add_out_l1[2*i]),
-			.areset(rst),
-			.b(add_out_l1[2*i+1]),
-			.clk(clk),
-			.en(en),
-			.q(add_out_l2[i])
-			);
+      for (i=0; i < ADD_LEVELS; i++) begin : gen_add_levels
+	 for (j=0; j < NUM_PRODUCTS/2**(i+1); j++) begin : gen_adds
+	    add_float add (
+			   .a(tree[i][2*j]),
+			   .areset(rst),
+			   .b(tree[i][2*j+1]),
+			   .clk(clk),
+			   .en(en),
+			   .q(tree[i+1][j])
+			   );
+	 end
       end
    endgenerate
 
-   // Instantiate the final adder to generate the result.
-   add_float add_l3 (
-		     .a(add_out_l2[0]),
-		     .areset(rst),
-		     .b(add_out_l2[1]),
-		     .clk(clk),
-		     .en(en),
-		     .q(result)
-		     );
+   // The final level of the tree has a single output.
+   assign result = tree[ADD_LEVELS][0];
       
    // Create a pipelined multiply-add tree.
    always_ff @ (posedge clk or posedge rst) begin
@@ -137,7 +138,7 @@ module pipeline
 	 // recommend against it since it creates a huge fan-out on the reset 
 	 // signal. However, the delay must be reset to avoid valid_out being
 	 // asserted incorrectly.
-	 for (int i=0; i < pipe_pkg::PIPE_LATENCY; i++) begin
+	 for (int i=0; i < LATENCY; i++) begin
 	    delay_r[i] <= 1'b0;	    
 	 end
       end
@@ -151,22 +152,19 @@ module pipeline
       else if (en) begin
 	 // Register the inputs (not necessary, but usually a good idea
 	 // for timing optimization if you don't know where they come from).
-	 for (int i=0; i < 16; i++) begin
+	 for (int i=0; i < NUM_INPUTS; i++) begin
 	    inputs_r[i] <= inputs[i];  	    
 	 end
 
-	 // Delay valid_in by pipe_pkg::PIPE_LATENCY cycles.
+	 // Delay valid_in by LATENCY cycles.
 	 delay_r[0] <= valid_in;	 
-	 for (int i=1; i < pipe_pkg::PIPE_LATENCY; i++) begin
+	 for (int i=1; i < LATENCY; i++) begin
 	    delay_r[i] <= delay_r[i-1];	    
 	 end
       end     
    end
 
-   // The pipeline output is valid after pipe_pkg::PIPE_LATENCY cycles (with enable asserted).
-   assign valid_out = delay_r[pipe_pkg::PIPE_LATENCY-1]; 
+   // The pipeline output is valid after LATENCY cycles (with enable asserted).
+   assign valid_out = delay_r[LATENCY-1]; 
 
 endmodule
-
-   
-   
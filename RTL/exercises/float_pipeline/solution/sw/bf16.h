@@ -0,0 +1,59 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+//
+// Description: Conversions between 32-bit floats and bfloat16, which is the
+// upper 16 bits of a 32-bit float. The AFU converts bfloat16 inputs to
+// 32-bit floats by appending 16 zeros (see hw/afu.sv), which matches
+// bf16ToFloat().
+
+#ifndef __BF16_H__
+#define __BF16_H__
+
+#include <cstdint>
+#include <cstring>
+
+typedef uint16_t bf16_t;
+
+
+// Returns the bfloat16 nearest to x, with ties rounded to even. NaNs stay
+// NaNs, and values that round past the largest bfloat16 become infinity.
+inline bf16_t floatToBf16(float x) {
+
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(float));
+
+  // Keep NaNs quiet, since rounding could otherwise turn them into infinity.
+  if ((bits & 0x7fffffff) > 0x7f800000)
+    return (bits >> 16) | 0x0040;
+
+  uint32_t lsb = (bits >> 16) & 1;
+  bits += 0x7fff + lsb;
+  return bits >> 16;
+}
+
+
+// Returns the exact 32-bit float representation of x.
+inline float bf16ToFloat(bf16_t x) {
+
+  uint32_t bits = uint32_t(x) << 16;
+  float result;
+  memcpy(&result, &bits, sizeof(float));
+  return result;
+}
+
+#endif
@@ -29,7 +29,13 @@ enum MmioAddr {
   MMIO_RD_ADDR=0x0052,
   MMIO_WR_ADDR=0x0054,
   MMIO_SIZE=0x0056,
-  MMIO_DONE=0x0058
+  MMIO_DONE=0x0058,
+  // Number of input cache lines accumulated into each result.
+  MMIO_REDUCE_LEN=0x005A,
+  // Number of output cache lines, which is only used when reducing.
+  MMIO_OUTPUT_SIZE=0x005C,
+  // 1 for bfloat16 inputs, 0 for 32-bit float inputs.
+  MMIO_BF16=0x005E
 };
 
 
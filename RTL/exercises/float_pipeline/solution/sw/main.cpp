@@ -27,18 +27,33 @@
 // This software allocates the input and output arrays, initializes their 
 // contents, transfers the virtual addresses of the arrays, the 
 // number of input cache lines to read, and a go signal to start the AFU. The
-// software then waits until the AFU signals that it is done.
+// software then waits until the AFU signals that it is done. The sizes of the
+// arrays, the launch, and the verification are handled by the generic
+// StreamKernel (see StreamKernel.h).
+//
+// An optional reduction length makes the AFU accumulate the results of that
+// many input cache lines into each output, which computes long dot products
+// without writing partial sums back to memory.
+//
+// The inputs can optionally be bfloat16 (see bf16.h), in which case every
+// cache line provides 32 inputs and 16 products. The AFU still multiplies and
+// adds with 32-bit floats.
 
 #include <cstdlib>
 #include <iostream>
 #include <cmath>
 #include <random>
+#include <string>
 
 #include <opae/utils.h>
 
 #include "AFU.h"
 // Contains application-specific information
 #include "config.h"
+// Conversions for bfloat16 inputs
+#include "bf16.h"
+// Generic allocation, launching, and verification of streaming jobs
+#include "StreamKernel.h"
 // Auto-generated by OPAE's afu_json_mgr script
 #include "afu_json_info.h"
 
@@ -46,86 +61,105 @@ using namespace std;
 
 
 void printUsage(char *name);
-bool checkUsage(int argc, char *argv[], unsigned long &num_inputs);
-bool isAcceptableError(float fpga, float sw);
-float getCorrectOutput(volatile float input[], unsigned output_id);
+bool checkUsage(int argc, char *argv[], unsigned long &num_inputs, unsigned long &reduce_len, bool &bf16);
+bool isAcceptableError(float fpga, float sw, unsigned long num_products);
+
+// Registers that launch a job.
+const StreamRegs STREAM_REGS = {MMIO_GO, MMIO_RD_ADDR, MMIO_WR_ADDR, MMIO_SIZE, MMIO_DONE};
+
+
+// Conversions between the input types and floats, which let the test be
+// templated on the input type.
+float inputToFloat(float x) { return x; }
+float inputToFloat(bf16_t x) { return bf16ToFloat(x); }
+void floatToInput(float x, float &input) { input = x; }
+void floatToInput(float x, bf16_t &input) { input = floatToBf16(x); }
+
+
+// Returns the correct output for the num_inputs inputs of reduce_len cache
+// lines.
+template <typename in_t>
+float getCorrectOutput(const in_t input[], unsigned num_inputs) {
+
+  // Perform the same computation as the AFU pipeline. The AFU adds in a
+  // different order, so long sums are computed with more precision to
+  // keep the rounding error of the software result out of the comparison.
+  // The inputs are converted exactly like the AFU, so the only difference
+  // is the rounding of the 32-bit float operations.
+  double result = 0.0;
+  for (unsigned i=0; i < num_inputs; i+=2) {
+    result += (double) inputToFloat(input[i]) * inputToFloat(input[i+1]);
+  }
+
+  return result;
+}
+
+
+// Runs the AFU with inputs of type in_t, which must be float or bf16_t.
+// Returns the number of incorrect outputs.
+template <typename in_t>
+unsigned runTest(AFU &afu, unsigned long num_output_cls, unsigned long reduce_len) {
+
+  // Every output is computed from reduce_len cache lines of inputs, and the
+  // kernel determines the number of inputs and outputs per cache line from
+  // the types.
+  StreamKernel<in_t, float> kernel(afu, STREAM_REGS, reduce_len);
+#ifdef SLEEP_WHILE_WAITING
+  kernel.setPollInterval(SLEEP_MS);
+#endif
+
+  // C++11 way of creating random real numbers between 0 and 100.
+  mt19937 e;
+  uniform_real_distribution<> dist(0, 100);
+
+  // Allocate and initialize the input and output arrays.
+  auto job = kernel.allocate(num_output_cls * kernel.OUTPUTS_PER_CL);
+  kernel.fill(job, [&]() {
+      in_t x;
+      floatToInput(dist(e), x);
+      return x;
+    });
+    
+  // Inform the FPGA of the input format. Accumulate reduce_len input cache
+  // lines into each output. The AFU doesn't divide by the reduction length,
+  // so the number of output cache lines is also provided.
+  afu.write(MMIO_BF16, sizeof(in_t) == sizeof(bf16_t));
+  afu.write(MMIO_REDUCE_LEN, reduce_len);
+  afu.write(MMIO_OUTPUT_SIZE, job.output_cls);
+
+  kernel.run(job);
+
+  // Verify the output.
+  unsigned errors = kernel.verify(job, getCorrectOutput<in_t>, [&](float fpga, float sw) {
+      return isAcceptableError(fpga, sw, kernel.inputsPerOutput()/2);
+    });
+
+  kernel.free(job);
+  return errors;
+}
 
 
 int main(int argc, char *argv[]) {
 
   unsigned long num_output_cls;
-  unsigned long num_inputs;
-  unsigned long num_outputs;
+  unsigned long reduce_len;
+  bool bf16;
 
-  if (!checkUsage(argc, argv, num_output_cls)) {
+  if (!checkUsage(argc, argv, num_output_cls, reduce_len, bf16)) {
     printUsage(argv[0]);
     return EXIT_FAILURE;
   }
   
-  // There are 16 32-bit outputs per cache line.
-  num_outputs = num_output_cls * 16;
-  // There are 16 32-bit inputs per output.
-  num_inputs = num_outputs * 16;
-
   try {
     AFU afu(AFU_ACCEL_UUID); 
-    bool failed = false;
+    unsigned errors;
 
-    // Allocate input and output arrays.
-    auto input  = afu.malloc<volatile float>(num_inputs);
-    auto output = afu.malloc<volatile float>(num_outputs);  
-
-    // C++11 way of creating random real numbers between 0 and 100.
-    random_device rd;
-    mt19937 e;
-    uniform_real_distribution<> dist(0, 100);
-
-    // Initialize the input and output arrays.
-    for (unsigned i=0; i < num_inputs; i++) {      
-      input[i] = dist(e);      
+    if (bf16) {
+      errors = runTest<bf16_t>(afu, num_output_cls, reduce_len);
     }
-
-    for (unsigned i=0; i < num_outputs; i++) {      
-      output[i] = 0.0;
-    }   
-    
-    // Inform the FPGA of the starting addresses of the arrays.
-    afu.write(MMIO_RD_ADDR, (uint64_t) input);
-    afu.write(MMIO_WR_ADDR, (uint64_t) output);
-
-    // The FPGA DMA only handles cache-line transfers, so we need to convert
-    // the input array size to cache lines. We could also do this conversion 
-    // on the FPGA and transfer the number of inputs instead here.
-    // The number of output cache lines is calculated by the FPGA.
-    unsigned total_bytes = num_inputs*sizeof(float);
-    unsigned num_cls = ceil((float) total_bytes / (float) AFU::CL_BYTES);
-    afu.write(MMIO_SIZE, num_cls);
-
-    // Start the FPGA DMA transfer (cleared automatically by the AFU).
-    afu.write(MMIO_GO, 1);  
-
-    // Wait until the FPGA is done.
-    while (afu.read(MMIO_DONE) == 0) {
-#ifdef SLEEP_WHILE_WAITING
-      this_thread::sleep_for(chrono::milliseconds(SLEEP_MS));
-#endif
-    }
-
-    // Verify the output.
-    unsigned errors = 0;
-    for (unsigned i=0; i < num_outputs; i++) {     
-
-      float sw_result = getCorrectOutput(input, i);
-
-      if (!isAcceptableError(output[i], sw_result)) {
-	
-	errors ++;
-      }
+    else {
+      errors = runTest<float>(afu, num_output_cls, reduce_len);
     }
-
-    // Free the allocated memory.
-    afu.free(input);
-    afu.free(output);
         
     if (errors == 0) {
       cout << "SUCCESS: all outputs correct." << endl;
@@ -164,8 +198,10 @@ int main(int argc, char *argv[]) {
 
 void printUsage(char *name) {
 
-  cout << "Usage: " << name << " size\n"     
-       << "size (positive integer for number of output cache lines to test. Every output cache line adds 8 32-bit outputs and 128 64-bit inputs.)\n"
+  cout << "Usage: " << name << " size [reduce_len] [bf16]\n"     
+       << "size (positive integer for number of output cache lines to test. Every output cache line adds 16 32-bit outputs and 256 32-bit inputs (512 bfloat16 inputs) per reduce_len.)\n"
+       << "reduce_len (positive integer number of input cache lines accumulated into each output, default 1)\n"
+       << "bf16 (1 for bfloat16 inputs, 0 for 32-bit float inputs, default 0)\n"
        << endl;
 }
 
@@ -184,11 +220,21 @@ unsigned long stringToPositiveInt(char *str) {
 }
 
 
-bool checkUsage(int argc, char *argv[], unsigned long &num_output_cls) {
+bool checkUsage(int argc, char *argv[], unsigned long &num_output_cls, unsigned long &reduce_len, bool &bf16) {
   
-  if (argc == 2) {
+  reduce_len = 1;
+  bf16 = false;
+  if (argc >= 2 && argc <= 4) {
     try {
       num_output_cls = stringToPositiveInt(argv[1]);
+      if (argc >= 3)
+	reduce_len = stringToPositiveInt(argv[2]);
+      if (argc == 4) {
+	string format = argv[3];
+	if (format != "0" && format != "1")
+	  return false;
+	bf16 = format == "1";
+      }
     }
     catch (const runtime_error& e) {    
       return false;
@@ -202,24 +248,10 @@ bool checkUsage(int argc, char *argv[], unsigned long &num_output_cls) {
 }
 
 
-bool isAcceptableError(float fpga, float sw) {
-
-  return abs((sw-fpga)/sw) < ACCEPTABLE_PERCENT_ERROR;
-}
-
-
-float getCorrectOutput(volatile float input[], unsigned output_id) {
+// The rounding error of the AFU's float adds grows with the number of
+// products in each output. The tolerance is relative to the 8 products of
+// a cache line of 32-bit floats.
+bool isAcceptableError(float fpga, float sw, unsigned long num_products) {
 
-  // There are 16 inputs for every output, so find the appropriate range
-  // of the input array to calculate the requested output.
-  unsigned start_index = output_id*16;
-  unsigned end_index = start_index + 16;
-
-  // Perform the same computation as the AFU pipeline.
-  float result = 0.0;
-  for (unsigned i=start_index; i < end_index; i+=2) {
-    result += input[i] * input[i+1];
-  }
-
-  return result;
+  return abs((sw-fpga)/sw) < ACCEPTABLE_PERCENT_ERROR * num_products / 8.0;
 }
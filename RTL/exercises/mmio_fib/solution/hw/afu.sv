@@ -9,6 +9,13 @@
 //               along with a go signal to start the computation.
 //               The module outputs the result and asserts a done signal,
 //               which can be read by software over MMIO.
+//
+//               Software can also compute a batch of Fibonacci numbers
+//               with fib_batch, which writes the results to host memory.
+//
+//               Both interfaces use either the iterative calculator (fib)
+//               or the fast-doubling calculator (fib_fast), which is
+//               selected by the memory-mapped engine register.
 
 `include "platform_if.vh"
 
@@ -22,20 +29,98 @@ module afu
    output t_if_ccip_Tx tx
    );
 
+   localparam int QUEUE_DEPTH = 1024;
+   
    // Connectinos between the memory map and fib module
-   logic  go, done;
-   logic [31:0] n, result;
+   logic  go, done, overflow, engine;
+   logic [31:0] n;
+   logic [63:0] result;
+
+   // Connections between the memory map and fib_batch module
+   logic 	batch_push, batch_go, batch_done, batch_overflow;
+   logic [63:0] batch_push_data;
+   logic [$clog2(QUEUE_DEPTH):0] batch_size;
+   t_ccip_clAddr batch_addr;
 
+   // Connections between fib_batch and the fib modules
+   logic 	batch_active, batch_fib_go, fib_go;
+   logic [31:0] batch_fib_n, fib_n;
+
+   // Outputs of the two Fibonacci calculators
+   logic 	iter_done, iter_overflow_r, fast_done, fast_overflow;
+   logic [31:0] iter_result;
+   logic [63:0] fast_result;
+   
+   // The memory map only uses channel 2 for MMIO read responses. Channel 1
+   // belongs to fib_batch.
+   t_if_ccip_Tx mmio_tx;
+   t_if_ccip_c1_Tx batch_c1Tx;
+   
+   always_comb begin
+      tx = mmio_tx;
+      tx.c1 = batch_c1Tx;
+   end
+   
    // In this example, we separate the memory mapping from the main
    // functionality of the AFU because they are more complex.
    // The memory map provides the input n and go signals from software, 
    // and transfers the result and done signals back to software.
-   memory_map memory_map (.*);
+   memory_map #(.QUEUE_DEPTH(QUEUE_DEPTH)) memory_map (.tx(mmio_tx), .*);
+
+   // Runs the fib module on every n in the request queue, and writes the
+   // results to host memory.
+   fib_batch #(.QUEUE_DEPTH(QUEUE_DEPTH)) fib_batch
+     (
+      .clk,
+      .rst,
+      .push(batch_push),
+      .push_data(batch_push_data),
+      .go(batch_go),
+      .size(batch_size),
+      .result_addr(batch_addr),
+      .done(batch_done),
+      .overflow(batch_overflow),
+      .active(batch_active),
+      .fib_go(batch_fib_go),
+      .fib_n(batch_fib_n),
+      .fib_done(done),
+      .fib_result(result),
+      .fib_overflow(overflow),
+      .c1TxAlmFull(rx.c1TxAlmFull),
+      .c1Rx(rx.c1),
+      .c1Tx(batch_c1Tx)
+      );
+
+   // The batch has priority over the single-request registers while it
+   // is active. Software shouldn't use both at the same time.
+   assign fib_go = batch_active ? batch_fib_go : go;
+   assign fib_n = batch_active ? batch_fib_n : n;
+
+   // The iterative calculator wraps at 32 bits, so its result overflows
+   // for n > ITER_MAX_N. n is registered while go is asserted, which is
+   // when fib samples it, so the flag is valid along with iter_done.
+   localparam int ITER_MAX_N = 47;
 
+   always_ff @(posedge clk or posedge rst) begin
+      if (rst)
+	iter_overflow_r <= 1'b0;
+      else if (fib_go && !engine)
+	iter_overflow_r <= fib_n > ITER_MAX_N;
+   end
+
+   assign done = engine ? fast_done : iter_done;
+   assign result = engine ? fast_result : 64'(iter_result);
+   assign overflow = engine ? fast_overflow : iter_overflow_r;
+   
    // The main Fibonacci calculator. This module takes the input n
    // from a memory-mapped register, and computes the nth Fibonacci
    // number when go is asserted. It outputs the result on the result
    // output, and asserts done in the cycle that result is valid.
-   fib fib (.*);  
+   fib fib (.go(fib_go && !engine), .n(fib_n), .done(iter_done),
+	    .result(iter_result), .*);
+
+   // Computes the same function with O(log n) latency using fast doubling.
+   fib_fast fib_fast (.go(fib_go && engine), .n(fib_n), .done(fast_done),
+		      .result(fast_result), .overflow(fast_overflow), .*);
    
 endmodule
@@ -0,0 +1,199 @@
+// Greg Stitt
+// University of Florida
+//
+// Module Name:  fib_batch.sv
+// Project:      mmio_fib
+// Description:  Computes a batch of Fibonacci numbers without any MMIO
+//               transfers between requests. Software pushes the n values
+//               into a BRAM request queue, two per 64-bit MMIO write,
+//               provides the byte address of a result array in host memory,
+//               and asserts go. The module then runs the fib module on
+//               every queued n, packs the results into cache lines, and
+//               writes each line to host memory over CCI-P channel 1.
+//               done is asserted once every write has been acknowledged,
+//               at which point all results are visible to software.
+//
+//               Because the result array is written over CCI-P without
+//               MPF, the address must be the buffer's IO address, and the
+//               array must be padded to a whole number of cache lines.
+
+//========================================================================
+// Parameter Description
+// QUEUE_DEPTH : The maximum number of n values in a batch (must be even)
+// RESULT_WIDTH : The width of each result, which must divide 512
+//========================================================================
+
+//========================================================================
+// Port Description
+// clk : clock
+// rst : reset
+// push : Writes push_data to the end of the request queue
+// push_data : Two n values, with the first in the lower 32 bits
+// go : Starts a batch of size requests. Clears the request queue, so
+//      the next batch can be pushed once done is asserted.
+// size : The number of n values in the batch
+// result_addr : The cache-line address of the result array
+// done : Asserted when all results have been written. Remains asserted
+//        until the next go.
+// overflow : Asserted with done if any result of the batch overflowed
+// active : Asserted while the batch is using the fib module
+// fib_* : Connections to the fib module
+// c1TxAlmFull, c1Rx, c1Tx : CCI-P channel 1 for the result writes
+//========================================================================
+
+`include "platform_if.vh"
+
+module fib_batch
+  #(
+    parameter int QUEUE_DEPTH=1024,
+    parameter int RESULT_WIDTH=64
+    )
+   (
+    input logic 			    clk,
+    input logic 			    rst,
+    input logic 			    push,
+    input logic [63:0] 			    push_data,
+    input logic 			    go,
+    input logic [$clog2(QUEUE_DEPTH):0]     size,
+    input 				    t_ccip_clAddr result_addr,
+    output logic 			    done,
+    output logic 			    overflow,
+    output logic 			    active,
+    output logic 			    fib_go,
+    output logic [31:0] 		    fib_n,
+    input logic 			    fib_done,
+    input logic [RESULT_WIDTH-1:0] 	    fib_result,
+    input logic 			    fib_overflow,
+    input logic 			    c1TxAlmFull,
+    input 				    t_if_ccip_c1_Rx c1Rx,
+    output 				    t_if_ccip_c1_Tx c1Tx
+    );
+
+   localparam int RESULTS_PER_CL = 512 / RESULT_WIDTH;
+   localparam int COUNT_WIDTH = $clog2(QUEUE_DEPTH)+1;
+   localparam int QUEUE_ADDR_WIDTH = $clog2(QUEUE_DEPTH/2);
+
+   typedef enum {IDLE, FETCH, START, WAIT, WRITE, DRAIN} state_t;
+   state_t state_r;
+
+   // Request queue, which stores two n values per word to match the MMIO
+   // writes.
+   logic [63:0] 			    queue[QUEUE_DEPTH/2];
+   logic [QUEUE_ADDR_WIDTH-1:0] 	    wr_addr_r;
+   logic [63:0] 			    rd_data_r;
+
+   logic [COUNT_WIDTH-1:0] 		    size_r, index_r, lines_r, responses_r;
+   logic [$clog2(RESULTS_PER_CL)-1:0] 	    slot_r;
+   t_ccip_clAddr 			    addr_r;
+   t_ccip_clData 			    results_r;
+   t_ccip_c1_ReqMemHdr 			    wr_hdr;
+
+   always_ff @(posedge clk) begin
+      if (push)
+	queue[wr_addr_r] <= push_data;
+
+      rd_data_r <= queue[index_r[QUEUE_ADDR_WIDTH:1]];
+   end
+
+   // The fib module samples n in the cycle after go, while the FSM waits
+   // in WAIT with an unchanged index.
+   assign fib_go = state_r == START;
+   assign fib_n = index_r[0] ? rd_data_r[63:32] : rd_data_r[31:0];
+   assign active = state_r != IDLE;
+
+   always_comb begin
+      wr_hdr 	      = '0;
+      wr_hdr.vc_sel   = eVC_VA;
+      wr_hdr.sop      = 1'b1;
+      wr_hdr.cl_len   = eCL_LEN_1;
+      wr_hdr.req_type = eREQ_WRLINE_I;
+      wr_hdr.address  = addr_r + lines_r;
+   end
+
+   always_ff @(posedge clk or posedge rst) begin
+      if (rst) begin
+	 state_r     <= IDLE;
+	 done 	     <= 1'b0;
+	 overflow    <= 1'b0;
+	 wr_addr_r   <= '0;
+	 size_r      <= '0;
+	 index_r     <= '0;
+	 lines_r     <= '0;
+	 responses_r <= '0;
+	 slot_r      <= '0;
+	 addr_r      <= '0;
+	 results_r   <= '0;
+	 c1Tx.valid  <= 1'b0;
+      end
+      else begin
+	 c1Tx.valid <= 1'b0;
+
+	 if (push)
+	   wr_addr_r <= wr_addr_r + 1'b1;
+
+	 if (c1Rx.rspValid && c1Rx.hdr.resp_type == eRSP_WRLINE)
+	   responses_r <= responses_r + 1'b1;
+
+	 case (state_r)
+	   IDLE: begin
+	      if (go) begin
+		 done 	     <= 1'b0;
+		 overflow    <= 1'b0;
+		 wr_addr_r   <= '0;
+		 size_r      <= size;
+		 addr_r      <= result_addr;
+		 index_r     <= '0;
+		 lines_r     <= '0;
+		 responses_r <= '0;
+		 slot_r      <= '0;
+		 results_r   <= '0;
+		 state_r     <= size == 0 ? DRAIN : FETCH;
+	      end
+	   end
+
+	   // Waits for the queue's read latency.
+	   FETCH: state_r <= START;
+
+	   START: state_r <= WAIT;
+
+	   WAIT: begin
+	      if (fib_done) begin
+		 results_r[slot_r*RESULT_WIDTH +: RESULT_WIDTH] <= fib_result;
+		 if (fib_overflow)
+		   overflow <= 1'b1;
+		 slot_r  <= slot_r + 1'b1;
+		 index_r <= index_r + 1'b1;
+
+		 // Write the line once it is full, or after the last result.
+		 if (slot_r == RESULTS_PER_CL-1 || index_r == size_r-1)
+		   state_r <= WRITE;
+		 else
+		   state_r <= FETCH;
+	      end
+	   end
+
+	   WRITE: begin
+	      if (!c1TxAlmFull) begin
+		 c1Tx.valid <= 1'b1;
+		 c1Tx.hdr   <= wr_hdr;
+		 c1Tx.data  <= results_r;
+		 lines_r    <= lines_r + 1'b1;
+		 slot_r     <= '0;
+		 results_r  <= '0;
+		 state_r    <= index_r == size_r ? DRAIN : FETCH;
+	      end
+	   end
+
+	   // Waits for all writes to be acknowledged, which guarantees the
+	   // results are visible to software when done is asserted.
+	   DRAIN: begin
+	      if (responses_r == lines_r) begin
+		 done 	 <= 1'b1;
+		 state_r <= IDLE;
+	      end
+	   end
+	 endcase
+      end
+   end
+
+endmodule
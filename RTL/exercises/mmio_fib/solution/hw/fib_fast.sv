@@ -0,0 +1,187 @@
+// Greg Stitt
+// University of Florida
+//
+// Module Name:  fib_fast.sv
+// Project:      mmio_fib
+// Description:  Implements a Fibonacci calculator with the fast-doubling
+//               algorithm, which requires O(log n) iterations instead of
+//               the O(n) iterations of fib.sv:
+//
+// a = 0;  // F(k), starting with k=0
+// b = 1;  // F(k+1)
+//
+// for (i=msb(n); i >= 0; i--) {
+//   c = a*(2*b - a);  // F(2k)
+//   d = a*a + b*b;    // F(2k+1)
+//   if (n[i]) {
+//     a = d;
+//     b = c+d;
+//   }
+//   else {
+//     a = c;
+//     b = d;
+//   }
+// }
+//
+// return a;
+//
+//               All arithmetic is modulo 2^64, so the result is F(n) modulo
+//               2^64 even when intermediate values overflow. F(93) is the
+//               largest Fibonacci number that fits in 64 bits, so overflow
+//               is simply n > 93.
+//
+//               The three multiplications of each iteration run in
+//               parallel, followed by MULT_STAGES register stages that can
+//               be retimed into the DSPs. Each iteration therefore takes
+//               MULT_STAGES+1 cycles.
+
+//========================================================================
+// Parameter Description
+// MULT_STAGES : The number of register stages after each multiplier
+//               (at least 1)
+//========================================================================
+
+//========================================================================
+// Port Description
+// clk : clock
+// rst : reset
+// go : Assert to start the circuit. To restart the circuit, go must be
+//      cleared before being asserted again.
+// n : Specifies the nth Fibonacci number to calculate
+// done : Asserted when result output is valid. Remains asserted until
+//        circuit is restarted.
+// result : The nth Fibonacci number modulo 2^64, valid when done is asserted
+// overflow : Asserted with done when the nth Fibonacci number doesn't fit
+//            in 64 bits
+//========================================================================
+
+module fib_fast
+  #(
+    parameter int MULT_STAGES=3
+    )
+  (
+   input 	       clk,
+   input 	       rst,
+   input 	       go,
+   input [31:0]        n,
+   output logic        done,
+   output logic [63:0] result,
+   output logic        overflow
+   );
+
+   // The largest n whose Fibonacci number fits in 64 bits.
+   localparam int MAX_N = 93;
+
+   typedef enum  {START, INIT, MULT, UPDATE, COMPLETE} state_t;
+   state_t state;
+
+   logic [31:0]  n_r;
+   logic [4:0] 	 i;
+   logic [63:0]  a, b;
+   logic [$clog2(MULT_STAGES+1)-1:0] count;
+
+   // Pipelined products, where c_r is a*(2b-a), and aa_r and bb_r are a*a
+   // and b*b.
+   logic [63:0]  c_r[MULT_STAGES], aa_r[MULT_STAGES], bb_r[MULT_STAGES];
+   logic [63:0]  c, d;
+
+   // Returns the index of the most significant 1 in x.
+   function automatic logic [4:0] msb(logic [31:0] x);
+      msb = '0;
+      for (int j=0; j < 32; j++)
+	if (x[j]) msb = 5'(j);
+   endfunction
+
+   initial begin
+      if (MULT_STAGES < 1)
+	$error("MULT_STAGES must be at least 1.");
+   end
+
+   // The multipliers operate every cycle. The FSM waits MULT_STAGES cycles
+   // after a and b change before using the products.
+   always_ff @(posedge clk) begin
+      c_r[0]  <= a * ((b << 1) - a);
+      aa_r[0] <= a * a;
+      bb_r[0] <= b * b;
+
+      for (int s=1; s < MULT_STAGES; s++) begin
+	 c_r[s]  <= c_r[s-1];
+	 aa_r[s] <= aa_r[s-1];
+	 bb_r[s] <= bb_r[s-1];
+      end
+   end
+
+   assign c = c_r[MULT_STAGES-1];
+   assign d = aa_r[MULT_STAGES-1] + bb_r[MULT_STAGES-1];
+
+   always_ff @(posedge clk or posedge rst) begin
+      if (rst) begin
+	 state 	  <= START;
+	 result   <= '0;
+	 overflow <= '0;
+	 done 	  <= '0;
+	 n_r 	  <= '0;
+	 i 	  <= '0;
+	 a 	  <= '0;
+	 b 	  <= '0;
+	 count 	  <= '0;
+      end
+      else begin
+	 case (state)
+	   START: begin
+	      if (go) begin
+		 state <= INIT;
+		 done  <= 1'b0;
+	      end
+	   end
+
+	   INIT: begin
+	      a     <= 0;
+	      b     <= 1;
+	      i     <= msb(n);
+	      count <= '0;
+	      n_r   <= n;
+
+	      if (n == 0)
+		state <= COMPLETE;
+	      else
+		state <= MULT;
+	   end
+
+	   MULT: begin
+	      count <= count + 1'b1;
+	      if (count == MULT_STAGES-1)
+		state <= UPDATE;
+	   end
+
+	   UPDATE: begin
+	      if (n_r[i]) begin
+		 a <= d;
+		 b <= c + d;
+	      end
+	      else begin
+		 a <= c;
+		 b <= d;
+	      end
+
+	      count <= '0;
+	      i     <= i - 1'b1;
+	      if (i == 0)
+		state <= COMPLETE;
+	      else
+		state <= MULT;
+	   end
+
+	   COMPLETE: begin
+	      result   <= a;
+	      overflow <= n_r > MAX_N;
+	      done     <= 1'b1;
+	      if (!go) begin
+		 state <= START;
+	      end
+	   end
+	 endcase
+      end
+   end
+
+endmodule
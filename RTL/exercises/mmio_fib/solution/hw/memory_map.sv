@@ -16,12 +16,35 @@
 //               go     : h0022
 //               result : h0024
 //               done   : h0026
+//
+//               The batch interface (see fib_batch.sv) uses the following
+//               registers:
+//
+//               batch_push  : h0028 (write only, two n values per write)
+//               batch_size  : h002A
+//               batch_addr  : h002C (byte address of the result array)
+//               batch_go    : h002E
+//               batch_done  : h0030
+//               batch_max   : h0032 (read only, maximum batch size)
+//
+//               The engine register selects the Fibonacci calculator used
+//               by both interfaces (0 for fib.sv, 1 for fib_fast.sv). The
+//               remaining registers are read only:
+//
+//               engine         : h0034
+//               overflow       : h0036 (result doesn't fit in the engine's
+//                                       32 or 64 bits)
+//               batch_overflow : h0038 (any batch result overflowed)
+//               cycles         : h003A (cycles from go to done)
 
 
 `include "platform_if.vh"
 `include "afu_json_info.vh"
 
 module memory_map
+  #(
+    parameter int QUEUE_DEPTH=1024
+    )
   (
    input  clk,
    input  rst, 
@@ -33,8 +56,19 @@ module memory_map
    // Memory-mapped signals that communicate with fib module
    output [31:0] n,
    output go,
-   input [31:0] result,
-   input done
+   input [63:0] result,
+   input done,
+   input overflow,
+   output engine,
+
+   // Memory-mapped signals that communicate with the fib_batch module
+   output batch_push,
+   output [63:0] batch_push_data,
+   output batch_go,
+   output [$clog2(QUEUE_DEPTH):0] batch_size,
+   output t_ccip_clAddr batch_addr,
+   input batch_done,
+   input batch_overflow
    );
 
    localparam [127:0] afu_id = `AFU_ACCEL_UUID;
@@ -46,6 +80,24 @@ module memory_map
    // Connect internal registers to ports.
    assign n = n_r;
    assign go = go_r;
+
+   // Batch registers (memory mapped to addresses h0028-h0030).
+   logic batch_push_r, batch_go_r;
+   logic [63:0] batch_push_data_r;
+   logic [$clog2(QUEUE_DEPTH):0] batch_size_r;
+   t_ccip_clAddr batch_addr_r;
+
+   assign batch_push = batch_push_r;
+   assign batch_push_data = batch_push_data_r;
+   assign batch_go = batch_go_r;
+   assign batch_size = batch_size_r;
+   assign batch_addr = batch_addr_r;
+
+   // Engine select (h0034), and the latency of the last single request.
+   logic engine_r;
+   logic [63:0] cycles_r;
+
+   assign engine = engine_r;
  
    // Get mmio request header.
    t_ccip_c0_ReqMmioHdr mmio_hdr;
@@ -60,6 +112,13 @@ module memory_map
           begin
 	     go_r <= '0;
 	     n_r  <= '0;	    
+	     batch_push_r <= '0;
+	     batch_push_data_r <= '0;
+	     batch_go_r <= '0;
+	     batch_size_r <= '0;
+	     batch_addr_r <= '0;
+	     engine_r <= '0;
+	     cycles_r <= '0;
           end
         else 
           begin
@@ -67,12 +126,31 @@ module memory_map
 	     // creates a 1-cycle high pulse. This saves a PCIe
 	     // transfer to clear the go signal.
 	     go_r <= 1'b0;
+	     batch_push_r <= 1'b0;
+	     batch_go_r <= 1'b0;
+
+	     // Count the cycles until done, starting at go. done isn't
+	     // cleared until the cycle after go, which adds the same
+	     // constant to the count of both engines.
+	     if (go_r)
+	       cycles_r <= '0;
+	     else if (!done)
+	       cycles_r <= cycles_r + 1'b1;
 	     	     
              if (rx.c0.mmioWrValid)
                begin
                   case (mmio_hdr.address)
                     16'h0020: go_r <= rx.c0.data[0];
 		    16'h0022: n_r  <= rx.c0.data[31:0];
+		    16'h0028: begin
+		       batch_push_r <= 1'b1;
+		       batch_push_data_r <= rx.c0.data;
+		    end
+		    16'h002A: batch_size_r <= rx.c0.data[$size(batch_size_r)-1:0];
+		    // The cache-line address of the byte address from software.
+		    16'h002C: batch_addr_r <= rx.c0.data[$size(batch_addr_r)+5:6];
+		    16'h002E: batch_go_r <= rx.c0.data[0];
+		    16'h0034: engine_r <= rx.c0.data[0];
                   endcase
                end
           end
@@ -148,6 +226,18 @@ module memory_map
 		    16'h0024: tx.c2.data <= result;
 		    16'h0026: tx.c2.data <= done;
 
+		    // Batch registers
+		    16'h002A: tx.c2.data <= batch_size_r;
+		    16'h002C: tx.c2.data <= {batch_addr_r, 6'b0};
+		    // batch_done isn't cleared until the cycle after batch_go_r,
+		    // so a read right after the go write would see the old batch.
+		    16'h0030: tx.c2.data <= batch_done && !batch_go_r;
+		    16'h0032: tx.c2.data <= QUEUE_DEPTH;
+		    16'h0034: tx.c2.data <= engine_r;
+		    16'h0036: tx.c2.data <= overflow;
+		    16'h0038: tx.c2.data <= batch_overflow;
+		    16'h003A: tx.c2.data <= cycles_r;
+
 		    // If the processor requests an address that is unused, return 0.
                     default:  tx.c2.data <= 64'h0;
                   endcase
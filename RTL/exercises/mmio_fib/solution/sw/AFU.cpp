@@ -119,3 +119,9 @@ uint64_t AFU::read(uint64_t addr) {
 
   return data;
 }
+
+
+shared_buffer::ptr_t AFU::allocate(size_t bytes) {
+
+  return shared_buffer::allocate(fpga, bytes);
+}
@@ -20,6 +20,7 @@
 #define __AFU_H__
 
 #include <opae/cxx/core/handle.h>
+#include <opae/cxx/core/shared_buffer.h>
 
 class AFU {
 
@@ -33,6 +34,11 @@ public:
   virtual void reset();
   virtual void write(uint64_t addr, uint64_t data);
   virtual uint64_t read(uint64_t addr);
+
+  // Allocates memory that is shared with the FPGA. Without MPF, the AFU 
+  // must access the buffer with its io_address() instead of the virtual 
+  // address.
+  opae::fpga::types::shared_buffer::ptr_t allocate(size_t bytes);
     
 protected: 
 
@@ -18,9 +18,24 @@
 //
 // This example demonstrates how to use the AFU OPAE wrapper class to 
 // communicate with a simple AFU that calculates Fibonacci numbers.
+//
+// The AFU has two Fibonacci calculators: an iterative engine with O(n)
+// latency and 32-bit results, and a fast-doubling engine with O(log n)
+// latency and 64-bit results. For each engine, every value is computed 
+// twice: once with the single-request registers, which requires several 
+// MMIO round trips per value, and once with the batch interface, where the
+// AFU writes all results to host memory. The times of both approaches are
+// reported for comparison. Finally, the latency of both engines is measured
+// in cycles for increasing values of n.
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <iomanip>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include <opae/utils.h>
 
@@ -44,7 +59,36 @@ using namespace std;
 #define RESULT_ADDR 0x0024
 #define DONE_ADDR 0x0026
 
-#define NUM_TESTS 50
+#define BATCH_PUSH_ADDR 0x0028
+#define BATCH_SIZE_ADDR 0x002A
+#define BATCH_RESULT_ADDR 0x002C
+#define BATCH_GO_ADDR 0x002E
+#define BATCH_DONE_ADDR 0x0030
+#define BATCH_MAX_ADDR 0x0032
+
+#define ENGINE_ADDR 0x0034
+#define OVERFLOW_ADDR 0x0036
+#define BATCH_OVERFLOW_ADDR 0x0038
+#define CYCLES_ADDR 0x003A
+
+// The AFU writes 8 64-bit results per cache line.
+#define CL_BYTES 64
+#define RESULTS_PER_CL 8
+
+// Values of the engine register
+#define ENGINE_ITERATIVE 0
+#define ENGINE_FAST 1
+
+// F(93) is the largest Fibonacci number that fits in 64 bits, and F(47) is
+// the largest that fits in the 32-bit results of the iterative engine.
+#define MAX_FAST_N 93
+#define MAX_ITER_N 47
+
+#define NUM_TESTS 100
+#define DEFAULT_NUM_VALUES 1000
+
+// The latency benchmark uses n = 2^0 ... 2^MAX_LATENCY_LOG.
+#define MAX_LATENCY_LOG 16
 
 // Software solution to compute nth Fibonacci number for comparison with hw
 unsigned fib(unsigned n) {
@@ -65,37 +109,221 @@ unsigned fib(unsigned n) {
 }
 
 
+// Software solution using the same fast-doubling algorithm as fib_fast.sv.
+// The result is modulo 2^64, and overflow is set if the actual Fibonacci
+// number doesn't fit in 64 bits.
+uint64_t fibFast(unsigned n, bool &overflow) {
+
+  uint64_t a = 0;  // F(k)
+  uint64_t b = 1;  // F(k+1)
+
+  overflow = n > MAX_FAST_N;
+  for (int i=31; i >= 0; i--) {
+    if (n >> i == 0)
+      continue;
+
+    uint64_t c = a * (2*b - a);  // F(2k)
+    uint64_t d = a*a + b*b;      // F(2k+1)
+    if ((n >> i) & 1) {
+      a = d;
+      b = c + d;
+    }
+    else {
+      a = c;
+      b = d;
+    }
+  }
+
+  return a;
+}
+
+
+// Returns the expected result of the engine for input n.
+uint64_t reference(unsigned engine, unsigned n, bool &overflow) {
+
+  if (engine == ENGINE_FAST)
+    return fibFast(n, overflow);
+
+  overflow = n > MAX_ITER_N;
+  return fib(n);
+}
+
+
+// Computes the nth Fibonacci number with the single-request registers.
+uint64_t computeSingle(AFU& afu, unsigned n) {
+
+  // Give the AFU a value for the n input
+  afu.write(N_ADDR, n);
+
+  // Tell the AFU to go. The go signal is cleared automatically by the 
+  // AFU, so that software does not have to explicitly write a 0.
+  afu.write(GO_ADDR, 1);
+
+  // Wait until the AFU is done.
+  // NOTE: An interrupt would be a more efficiently implementation that
+  // prevents the CPU from constantly polling the done register.
+  while(!afu.read(DONE_ADDR));
+
+  return afu.read(RESULT_ADDR);
+}
+
+
+// Computes the Fibonacci number of each of the count values in n, and
+// stores them in results. The values are pushed into the AFU's request
+// queue with posted MMIO writes, two values per write, and the AFU writes
+// the results to host memory, so the only MMIO round trips are the reads
+// of the done register. Inputs larger than the request queue are split into
+// several batches. Returns true if any result overflowed.
+bool computeBatch(AFU& afu, const unsigned* n, size_t count, uint64_t* results) {
+
+  size_t max_batch = afu.read(BATCH_MAX_ADDR);
+  size_t lines = (max_batch + RESULTS_PER_CL - 1) / RESULTS_PER_CL;
+  auto buffer = afu.allocate(lines * CL_BYTES);
+  volatile uint64_t* output = reinterpret_cast<volatile uint64_t*>(buffer->c_type());
+  bool overflow = false;
+
+  // The AFU doesn't use MPF, so it needs the IO address of the buffer.
+  afu.write(BATCH_RESULT_ADDR, buffer->io_address());
+
+  for (size_t start=0; start < count; start += max_batch) {
+
+    size_t size = min(max_batch, count - start);
+    afu.write(BATCH_SIZE_ADDR, size);
+    for (size_t i=0; i < size; i += 2) {
+      uint64_t second = i+1 < size ? n[start+i+1] : 0;
+      afu.write(BATCH_PUSH_ADDR, second << 32 | uint32_t(n[start+i]));
+    }
+
+    afu.write(BATCH_GO_ADDR, 1);
+    while(!afu.read(BATCH_DONE_ADDR));
+
+    overflow |= afu.read(BATCH_OVERFLOW_ADDR);
+    for (size_t i=0; i < size; i++)
+      results[start+i] = output[i];
+  }
+
+  return overflow;
+}
+
+
+// Computes every value in n with the selected engine, using both single
+// requests and the batch interface, and returns the number of errors.
+unsigned testEngine(AFU& afu, unsigned engine, const vector<unsigned>& n) {
+
+  size_t num_values = n.size();
+  vector<uint64_t> single_results(num_values), batch_results(num_values);
+
+  afu.write(ENGINE_ADDR, engine);
+
+  auto start = chrono::steady_clock::now();
+  for (size_t i=0; i < num_values; i++)
+    single_results[i] = computeSingle(afu, n[i]);
+  chrono::duration<double> single_time = chrono::steady_clock::now() - start;
+
+  start = chrono::steady_clock::now();
+  bool batch_overflow = computeBatch(afu, n.data(), num_values, batch_results.data());
+  chrono::duration<double> batch_time = chrono::steady_clock::now() - start;
+
+  // Compare the AFU results with software.
+  unsigned errors = 0;
+  bool sw_batch_overflow = false;
+  for (size_t i=0; i < num_values; i++) {
+    bool overflow;
+    uint64_t sw_result = reference(engine, n[i], overflow);
+    sw_batch_overflow |= overflow;
+
+    if (single_results[i] != sw_result) {
+      cerr << "ERROR: AFU returned " << single_results[i]
+	   << " instead of " << sw_result
+	   << " for an input of " << n[i] << endl;
+      errors ++;
+    }
+
+    if (batch_results[i] != sw_result) {
+      cerr << "ERROR: AFU batch returned " << batch_results[i]
+	   << " instead of " << sw_result
+	   << " for an input of " << n[i] << endl;
+      errors ++;
+    }
+  }
+
+  if (batch_overflow != sw_batch_overflow) {
+    cerr << "ERROR: AFU batch overflow is " << batch_overflow
+	 << " instead of " << sw_batch_overflow << endl;
+    errors ++;
+  }
+
+  cout << (engine == ENGINE_FAST ? "Fast doubling" : "Iterative") << " engine\n"
+       << "  Single requests: " << single_time.count() << "s ("
+       << num_values / single_time.count() << " values/s)\n"
+       << "  Batch: " << batch_time.count() << "s ("
+       << num_values / batch_time.count() << " values/s)" << endl;
+
+  return errors;
+}
+
+
+// Prints the latency in cycles of both engines for n = 0 and powers of 2,
+// and returns the number of errors.
+unsigned benchmarkLatency(AFU& afu) {
+
+  const unsigned engines[2] = {ENGINE_ITERATIVE, ENGINE_FAST};
+  uint64_t cycles[2][MAX_LATENCY_LOG+2];
+  unsigned errors = 0;
+
+  for (unsigned e=0; e < 2; e++) {
+    afu.write(ENGINE_ADDR, engines[e]);
+    for (unsigned i=0; i <= MAX_LATENCY_LOG+1; i++) {
+      unsigned n = i == 0 ? 0 : 1 << (i-1);
+      uint64_t afu_result = computeSingle(afu, n);
+      bool afu_overflow = afu.read(OVERFLOW_ADDR);
+      cycles[e][i] = afu.read(CYCLES_ADDR);
+
+      bool sw_overflow;
+      uint64_t sw_result = reference(engines[e], n, sw_overflow);
+      if (afu_result != sw_result || afu_overflow != sw_overflow) {
+	cerr << "ERROR: AFU returned " << afu_result << " (overflow " << afu_overflow
+	     << ") instead of " << sw_result << " (overflow " << sw_overflow
+	     << ") for an input of " << n << endl;
+	errors ++;
+      }
+    }
+  }
+
+  cout << "Latency (cycles)\n"
+       << setw(8) << "n" << setw(12) << "iterative" << setw(16) << "fast doubling\n";
+  for (unsigned i=0; i <= MAX_LATENCY_LOG+1; i++) {
+    cout << setw(8) << (i == 0 ? 0 : 1 << (i-1))
+	 << setw(12) << cycles[0][i] << setw(15) << cycles[1][i] << "\n";
+  }
+  cout << flush;
+
+  return errors;
+}
+
+
+void printUsage(char *name);
+bool checkUsage(int argc, char *argv[], unsigned long &num_values);
+
 int main(int argc, char *argv[]) {
 
+  unsigned long num_values;
+  if (!checkUsage(argc, argv, num_values)) {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
   try {
     AFU afu(AFU_ACCEL_UUID);
-    
+
+    vector<unsigned> n(num_values);
+    for (size_t i=0; i < num_values; i++)
+      n[i] = i % NUM_TESTS;
+
     unsigned errors = 0;
-    for (uint64_t i=0; i < NUM_TESTS; i++) {
-            
-      // Give the AFU a value for the n input
-      afu.write(N_ADDR, i);
-
-      // Tell the AFU to go. The go signal is cleared automatically by the 
-      // AFU, so that software does not have to explicitly write a 0.
-      afu.write(GO_ADDR, 1);
-
-      // Wait until the AFU is done.
-      // NOTE: An interrupt would be a more efficiently implementation that
-      // prevents the CPU from constantly polling the done register.
-      while(!afu.read(DONE_ADDR));
-    
-      // Read the AFU result and compare with software.
-      uint64_t afu_result = afu.read(RESULT_ADDR);
-      uint64_t sw_result  = fib(i);
-
-      if (afu_result != sw_result) {
-	cerr << "ERROR: AFU returned " << afu_result
-	     << " instead of " << sw_result
-	     << " for an input of " << i << endl;
-	errors ++;
-      }
-    }
+    errors += testEngine(afu, ENGINE_ITERATIVE, n);
+    errors += testEngine(afu, ENGINE_FAST, n);
+    errors += benchmarkLatency(afu);
 
     if (errors == 0) {
       cout << "All tests succeeded." << endl;
@@ -132,3 +360,31 @@ int main(int argc, char *argv[]) {
 
   return EXIT_FAILURE;
 }
+
+
+void printUsage(char *name) {
+
+  cout << "Usage: " << name << " [num_values]\n"
+       << "num_values (positive integer amount of Fibonacci numbers to compute, default "
+       << DEFAULT_NUM_VALUES << ")"
+       << endl;
+}
+
+
+bool checkUsage(int argc, char *argv[], unsigned long &num_values) {
+
+  num_values = DEFAULT_NUM_VALUES;
+  if (argc > 2)
+    return false;
+
+  if (argc == 2) {
+    try {
+      num_values = stoul(argv[1]);
+    }
+    catch (const logic_error& e) {
+      return false;
+    }
+  }
+
+  return num_values > 0;
+}
@@ -46,7 +46,7 @@ using namespace std;
 
 void printUsage(char *name);
 bool checkUsage(int argc, char *argv[], unsigned long &num_inputs);
-uint64_t getCorrectOutput(volatile uint32_t input[], unsigned output_id);
+uint64_t getCorrectOutput(volatile uint32_t input[], uint64_t output_id);
 
 
 int main(int argc, char *argv[]) {
@@ -74,11 +74,11 @@ int main(int argc, char *argv[]) {
     auto output = afu.malloc<volatile uint64_t>(num_outputs);  
 
     // Initialize the input and output arrays.
-    for (unsigned i=0; i < num_inputs; i++) {      
+    for (uint64_t i=0; i < num_inputs; i++) {      
       input[i] = rand();
     }
 
-    for (unsigned i=0; i < num_outputs; i++) {      
+    for (uint64_t i=0; i < num_outputs; i++) {      
       output[i] = 0;
     }   
     
@@ -90,8 +90,8 @@ int main(int argc, char *argv[]) {
     // the input array size to cache lines. We could also do this conversion 
     // on the FPGA and transfer the number of inputs instead here.
     // The number of output cache lines is calculated by the FPGA.
-    unsigned total_bytes = num_inputs*sizeof(uint32_t);
-    unsigned num_cls = ceil((float) total_bytes / (float) AFU::CL_BYTES);
+    uint64_t total_bytes = num_inputs*sizeof(uint32_t);
+    uint64_t num_cls = (total_bytes + AFU::CL_BYTES - 1) / AFU::CL_BYTES;
     afu.write(MMIO_SIZE, num_cls);
 
     // Start the FPGA DMA transfer (cleared automatically by the AFU).
@@ -106,7 +106,7 @@ int main(int argc, char *argv[]) {
 
     // Verify the output.
     unsigned errors = 0;
-    for (unsigned i=0; i < num_outputs; i++) {     
+    for (uint64_t i=0; i < num_outputs; i++) {     
       if (output[i] != getCorrectOutput(input, i)) {
 	errors ++;
       }
@@ -191,16 +191,16 @@ bool checkUsage(int argc, char *argv[], unsigned long &num_output_cls) {
 }
 
 
-uint64_t getCorrectOutput(volatile uint32_t input[], unsigned output_id) {
+uint64_t getCorrectOutput(volatile uint32_t input[], uint64_t output_id) {
 
   // There are 16 inputs for every output, so find the appropriate range
   // of the input array to calculate the requested output.
-  unsigned start_index = output_id*16;
-  unsigned end_index = start_index + 16;
+  uint64_t start_index = output_id*16;
+  uint64_t end_index = start_index + 16;
 
   // Perform the same computation as the AFU pipeline.
   uint64_t result = 0;
-  for (unsigned i=start_index; i < end_index; i+=2) {
+  for (uint64_t i=start_index; i < end_index; i+=2) {
     result += (uint64_t) input[i] * (uint64_t) input[i+1];
   }
 
@@ -39,6 +39,30 @@
 //               the situation of ending without 8 results in the buffer to
 //               write to memory (i.e. an incomplete cache line on the final
 //               transfer.
+//
+//               Software can also select packed low-precision inputs with
+//               the mode register (see memory_map.sv), which unpacks each
+//               cache line into 32 int16 inputs or 64 int8 inputs. The
+//               signed products are summed into 64-bit results for int16
+//               and 32-bit results for int8, which are packed 8 or 16 per
+//               output cache line. Each mode uses its own multiply-add tree,
+//               so a cache line feeds 16 or 32 multiplies instead of 8.
+//               The mode must not change while the AFU is running.
+//
+//               Software also selects the operation of the pipelines for each
+//               job with the op register (see memory_map.sv and
+//               pipe_pkg::op_t): sum of products, sum, min, max, or sum of
+//               squares. Each operation uses the same tree with the same
+//               latency, and produces one result per input cache line, so
+//               the rest of the AFU doesn't depend on the operation. The
+//               op must not change while the AFU is running.
+//
+//               The description above uses the default parameters. The input
+//               and result widths, and the pipeline's register stages, are
+//               parameters. The number of inputs per result is
+//               always one cache line of inputs, so the pipeline's latency
+//               and the number of output cache lines follow from the
+//               parameters.
 
 //               The AFU uses MMIO to receive the starting read adress, 
 //               starting write address, input_size (# of input cache lines), 
@@ -49,6 +73,14 @@
 //               This example assumes the user is familiar with the
 //               dma_loopback and dma_loop_uclk training modules.
 
+//===================================================================
+// Parameter Description
+// INPUT_WIDTH  : The width of each input (e.g. 8, 16, 32, or 64).
+// RESULT_WIDTH : The width of each result. Must divide the cache line.
+// MULT_STAGES  : Register stages after each multiplier (see pipeline.sv).
+// ADD_STAGES   : Register stages after each adder level (see pipeline.sv).
+//===================================================================
+
 //===================================================================
 // Interface Description
 // clk  : Clock input
@@ -60,6 +92,12 @@
 `include "cci_mpf_if.vh"
 
 module afu 
+  #(
+    parameter int INPUT_WIDTH=32,
+    parameter int RESULT_WIDTH=64,
+    parameter int MULT_STAGES=1,
+    parameter int ADD_STAGES=1
+    )
   (
    input clk,
    input rst,
@@ -69,15 +107,31 @@ module afu
 
    localparam int CL_ADDR_WIDTH = $size(t_ccip_clAddr);
    localparam int CL_DATA_WIDTH = $size(t_ccip_clData);
-   localparam int INPUT_WIDTH = 32;   
-   localparam int RESULT_WIDTH = 64;
    localparam int INPUTS_PER_CL = CL_DATA_WIDTH / INPUT_WIDTH;   // 16
    localparam int RESULTS_PER_CL = CL_DATA_WIDTH / RESULT_WIDTH; // 8
+
+   // Input modes (see memory_map.sv). The packed modes have fixed input and
+   // result widths.
+   localparam logic [1:0] MODE_WIDE = 2'd0;
+   localparam logic [1:0] MODE_INT16 = 2'd1;
+   localparam logic [1:0] MODE_INT8 = 2'd2;
+   localparam int INT16_LANES = CL_DATA_WIDTH / 16;                   // 32
+   localparam int INT16_RESULT_WIDTH = 64;
+   localparam int INT16_RESULTS_PER_CL = CL_DATA_WIDTH / INT16_RESULT_WIDTH; // 8
+   localparam int INT8_LANES = CL_DATA_WIDTH / 8;                     // 64
+   localparam int INT8_RESULT_WIDTH = 32;
+   localparam int INT8_RESULTS_PER_CL = CL_DATA_WIDTH / INT8_RESULT_WIDTH;  // 16
+
+   // The FIFO and output buffer must handle the results of every mode.
+   localparam int FIFO_WIDTH = RESULT_WIDTH > INT16_RESULT_WIDTH ? RESULT_WIDTH : INT16_RESULT_WIDTH;
+   localparam int MAX_RESULTS_PER_CL = RESULTS_PER_CL > INT8_RESULTS_PER_CL ? RESULTS_PER_CL : INT8_RESULTS_PER_CL;
    
-   // Normally I would make this a function of the number of inputs, but since
-   // the pipeline is hardcoded for a specific number of inputs in this example,
-   // this will suffice.
-   localparam int PIPELINE_LATENCY = 5;
+   // The latencies are derived from the same parameters as the pipelines.
+   // The absorption FIFO must absorb the longest pipeline.
+   localparam int WIDE_LATENCY = pipe_pkg::latency(INPUTS_PER_CL, MULT_STAGES, ADD_STAGES);
+   localparam int INT16_LATENCY = pipe_pkg::latency(INT16_LANES, MULT_STAGES, ADD_STAGES);
+   localparam int INT8_LATENCY = pipe_pkg::latency(INT8_LANES, MULT_STAGES, ADD_STAGES);
+   localparam int PIPELINE_LATENCY = INT8_LATENCY > WIDE_LATENCY ? INT8_LATENCY : WIDE_LATENCY;
    
    // 512 is the shallowest a block RAM can be in the Arria 10, so there's no 
    // point in making it smaller unless using MLABs instead.
@@ -92,6 +146,8 @@ module afu
    // module instantiation.
    typedef logic [CL_ADDR_WIDTH:0] count_t;   
    count_t 	input_size;
+   logic [1:0]  mode;
+   pipe_pkg::op_t op;
    logic 	go;
    logic 	done;
 
@@ -111,12 +167,23 @@ module afu
        )
      memory_map (.*);
 
-   // Slice the DMA read data (i.e. cache line) into 16 separate 32-bit inputs.
+   // Slice the DMA read data (i.e. cache line) into INPUTS_PER_CL separate
+   // inputs, and into the lanes of the packed modes.
    logic [INPUT_WIDTH-1:0] pipeline_inputs[INPUTS_PER_CL];
+   logic [15:0] int16_inputs[INT16_LANES];
+   logic [7:0]  int8_inputs[INT8_LANES];
    always_comb begin
       for (int i=0; i < INPUTS_PER_CL; i++) begin
 	 pipeline_inputs[i] = dma.rd_data[INPUT_WIDTH*i +: INPUT_WIDTH];
       end      
+
+      for (int i=0; i < INT16_LANES; i++) begin
+	 int16_inputs[i] = dma.rd_data[16*i +: 16];
+      end
+
+      for (int i=0; i < INT8_LANES; i++) begin
+	 int8_inputs[i] = dma.rd_data[8*i +: 8];
+      end
    end
 
    logic pipeline_valid_out;
@@ -128,16 +195,92 @@ module afu
    // The pipeline has valid inputs everytime data is read from the DMA, and
    // has a valid output when pipeline_valid_out is asserted, with the result
    // showing up on pipeline_result.
-   pipeline pipeline (.clk,
+   pipeline 
+     #(
+       .NUM_INPUTS(INPUTS_PER_CL),
+       .INPUT_WIDTH(INPUT_WIDTH),
+       .RESULT_WIDTH(RESULT_WIDTH),
+       .MULT_STAGES(MULT_STAGES),
+       .ADD_STAGES(ADD_STAGES)
+       )
+   pipeline (.clk,
 		      .rst,
 		      .en(1'b1),
-		      .valid_in(dma.rd_en),
+		      .valid_in(dma.rd_en && mode == MODE_WIDE),
+		      .op,
 		      .inputs(pipeline_inputs),
 		      .result(pipeline_result),
 		      .valid_out(pipeline_valid_out));
 
+   // Instantiate the signed pipelines of the packed modes. Only the pipeline
+   // of the current mode receives inputs.
+   logic int16_valid_out, int8_valid_out;
+   logic [INT16_RESULT_WIDTH-1:0] int16_result;
+   logic [INT8_RESULT_WIDTH-1:0]  int8_result;
+
+   pipeline 
+     #(
+       .NUM_INPUTS(INT16_LANES),
+       .INPUT_WIDTH(16),
+       .RESULT_WIDTH(INT16_RESULT_WIDTH),
+       .MULT_STAGES(MULT_STAGES),
+       .ADD_STAGES(ADD_STAGES),
+       .SIGNED(1'b1)
+       )
+   int16_pipeline (.clk,
+		   .rst,
+		   .en(1'b1),
+		   .valid_in(dma.rd_en && mode == MODE_INT16),
+		   .op,
+		   .inputs(int16_inputs),
+		   .result(int16_result),
+		   .valid_out(int16_valid_out));
+
+   pipeline 
+     #(
+       .NUM_INPUTS(INT8_LANES),
+       .INPUT_WIDTH(8),
+       .RESULT_WIDTH(INT8_RESULT_WIDTH),
+       .MULT_STAGES(MULT_STAGES),
+       .ADD_STAGES(ADD_STAGES),
+       .SIGNED(1'b1)
+       )
+   int8_pipeline (.clk,
+		  .rst,
+		  .en(1'b1),
+		  .valid_in(dma.rd_en && mode == MODE_INT8),
+		  .op,
+		  .inputs(int8_inputs),
+		  .result(int8_result),
+		  .valid_out(int8_valid_out));
+
+   // Select the results of the current mode, and the number of results in
+   // each output cache line.
+   logic                  result_valid;
+   logic [FIFO_WIDTH-1:0] result;
+   logic [$clog2(MAX_RESULTS_PER_CL):0] results_per_cl;
+   always_comb begin
+      case (mode)
+	MODE_INT16: begin
+	   result_valid = int16_valid_out;
+	   result = FIFO_WIDTH'(int16_result);
+	   results_per_cl = INT16_RESULTS_PER_CL;
+	end
+	MODE_INT8: begin
+	   result_valid = int8_valid_out;
+	   result = FIFO_WIDTH'(int8_result);
+	   results_per_cl = INT8_RESULTS_PER_CL;
+	end
+	default: begin
+	   result_valid = pipeline_valid_out;
+	   result = FIFO_WIDTH'(pipeline_result);
+	   results_per_cl = RESULTS_PER_CL;
+	end
+      endcase
+   end
+
    logic 		    fifo_rd_en, fifo_empty, fifo_almost_full;
-   logic [RESULT_WIDTH-1:0] fifo_rd_data;
+   logic [FIFO_WIDTH-1:0]   fifo_rd_data;
          
    // This FIFO isn't needed, but if removed the pipeline must be stalled 
    // (en = 0) whenever dma.full is 1. Stalling a pipeline requires a large 
@@ -154,7 +297,7 @@ module afu
    // Boulder, CO, 2018, pp. 97-100, doi: 10.1109/FCCM.2018.00024.
    fifo 
      #(
-       .WIDTH(RESULT_WIDTH),
+       .WIDTH(FIFO_WIDTH),
        .DEPTH(FIFO_DEPTH),
        // This leaves enough space to absorb the entire contents of the
        // pipeline when there is a stall.
@@ -165,29 +308,29 @@ module afu
       .clk(clk),
       .rst(rst),
       .rd_en(fifo_rd_en),
-      .wr_en(pipeline_valid_out),
+      .wr_en(result_valid),
       .empty(fifo_empty),
       .full(), // Not used in an absorption FIFO.
       .almost_full(fifo_almost_full),
       .count(),
       .space(),
-      .wr_data(pipeline_result),
+      .wr_data(result),
       .rd_data(fifo_rd_data)
       );
 
    // Tracks the number of results in the output buffer to know when to
    // write the buffer to memory (when a full cache line is available).
-   logic [$clog2(RESULTS_PER_CL):0] result_count_r;
+   logic [$clog2(MAX_RESULTS_PER_CL):0] result_count_r;
 
-   // Output buffer to assemble a cache line out of 64-bit results.
+   // Output buffer to assemble a cache line out of results.
    logic [CL_DATA_WIDTH-1:0] output_buffer_r;
    
-   // The output buffer is full when it contains RESULT_PER_CL results (i.e.,
+   // The output buffer is full when it contains results_per_cl results (i.e.,
    // a full cache line) to write to memory and there isn't currently a write
    // to the DMA (which resets result_count_r). The && !dma.wr_en isn't neeeded
    // but can save a cycle every time there is an output written to memory.
    logic output_buffer_full;
-   assign output_buffer_full = (result_count_r == RESULTS_PER_CL) && !dma.wr_en;
+   assign output_buffer_full = (result_count_r == results_per_cl) && !dma.wr_en;
    
    // Read from the absorption FIFO when there is data in it, and when the 
    // output buffer is not full.     
@@ -208,14 +351,21 @@ module afu
 	 // Whenever something is read from the absorption fifo, shift the 
 	 // output buffer to the right and append the data from the FIFO to 
 	 // the front of the buffer.
-	 // After 8 reads from the FIFO, output_buffer_r will contain 8 complete
-	 // results, all aligned correctly for memory.
+	 // After results_per_cl reads from the FIFO, output_buffer_r will
+	 // contain results_per_cl complete results, all aligned correctly for
+	 // memory.
 	 if (fifo_rd_en) begin
-	    output_buffer_r <= {fifo_rd_data, 
-				output_buffer_r[CL_DATA_WIDTH-1:RESULT_WIDTH]};
+	    case (mode)
+	      MODE_INT16: output_buffer_r <= {fifo_rd_data[INT16_RESULT_WIDTH-1:0],
+					      output_buffer_r[CL_DATA_WIDTH-1:INT16_RESULT_WIDTH]};
+	      MODE_INT8: output_buffer_r <= {fifo_rd_data[INT8_RESULT_WIDTH-1:0],
+					     output_buffer_r[CL_DATA_WIDTH-1:INT8_RESULT_WIDTH]};
+	      default: output_buffer_r <= {fifo_rd_data[RESULT_WIDTH-1:0], 
+					   output_buffer_r[CL_DATA_WIDTH-1:RESULT_WIDTH]};
+	    endcase
 
 	    // Track the number of results in the output buffer. There is
-	    // a full cache line when result_count_r reaches RESULTS_PER_CL.
+	    // a full cache line when result_count_r reaches results_per_cl.
 	    result_count_r ++;
 	 end
       end
@@ -228,10 +378,18 @@ module afu
    // Use the input size (# of input cache lines) specified by software.
    assign dma.rd_size = input_size;
 
-   // For every input cache line, we get 16 32-bit inputs. These inputs produce
-   // one 64-bit output. We can store 8 outputs in a cache line, so there is
-   // one output cache line for every 8 input cache lines.
-   assign dma.wr_size = input_size >> 3;
+   // For every input cache line, we get INPUTS_PER_CL inputs. These inputs
+   // produce one output. We can store RESULTS_PER_CL outputs in a cache line,
+   // so there is one output cache line for every RESULTS_PER_CL input cache
+   // lines. The packed modes also produce one output per input cache line,
+   // with their own number of results per cache line.
+   always_comb begin
+      case (mode)
+	MODE_INT16: dma.wr_size = input_size >> $clog2(INT16_RESULTS_PER_CL);
+	MODE_INT8: dma.wr_size = input_size >> $clog2(INT8_RESULTS_PER_CL);
+	default: dma.wr_size = input_size >> $clog2(RESULTS_PER_CL);
+      endcase
+   end
 
    // Start both the read and write channels when the MMIO go is received.
    // Note that writes don't actually occur until dma.wr_en is asserted.
@@ -246,9 +404,10 @@ module afu
 
    // Write to memory when there is a full cache line to write, and when the
    // DMA isn't full.
-   assign dma.wr_en = (result_count_r == RESULTS_PER_CL) && !dma.full;
+   assign dma.wr_en = (result_count_r == results_per_cl) && !dma.full;
 
-   // Write the data from the output buffer, which stores 8 separate results.
+   // Write the data from the output buffer, which stores results_per_cl
+   // separate results.
    assign dma.wr_data = output_buffer_r;
 
    // The AFU is done when the DMA is done writing all results.
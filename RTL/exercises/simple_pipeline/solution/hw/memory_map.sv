@@ -24,6 +24,8 @@
 //               rd_addr    : h0052,
 //               wr_addr    : h0054,
 //               input_size : h0056
+//               mode       : h005A
+//               op         : h005C
 //
 //               and provides one output to software:
 //               done    : h0058
@@ -31,6 +33,14 @@
 //               rd_addr and wr_addr are both 64-bit virtual byte addresses.
 //               input_size is the number of input cache lines to transfer
 //               go starts the AFU and done signals completion.
+//
+//               mode selects how each input cache line is unpacked (see
+//               afu.sv): 0 for the AFU's INPUT_WIDTH inputs, 1 for 32 int16
+//               inputs, and 2 for 64 int8 inputs.
+//
+//               op selects the operation of the pipeline for each job (see
+//               pipe_pkg::op_t): 0 for sum of products, 1 for sum, 2 for
+//               min, 3 for max, and 4 for sum of squares.
 
 //==========================================================================
 // Parameter Description
@@ -50,6 +60,8 @@
 // rd_addr : the starting read address for the DMA transfer
 // wr_addr : the starting write address for the DMA transfer
 // input_size : the number of input cache lines to transfer
+// mode    : the input mode
+// op      : the pipeline operation
 // go      : starts the DMA transfer
 // done    : Asserted when the DMA transfer is complete
 //==========================================================================
@@ -67,6 +79,8 @@ module memory_map
    
    output logic [ADDR_WIDTH-1:0] rd_addr, wr_addr,
    output logic [SIZE_WIDTH-1:0] input_size,
+   output logic [1:0]  mode,
+   output pipe_pkg::op_t op,
    output logic        go,
    input logic 	       done   
    );
@@ -80,6 +94,8 @@ module memory_map
 	 rd_addr    <= '0;
 	 wr_addr    <= '0;	     
 	 input_size <= '0;
+	 mode       <= '0;
+	 op         <= pipe_pkg::OP_SUM_OF_PRODUCTS;
       end
       else begin
 	 go <= '0;
@@ -90,6 +106,8 @@ module memory_map
 	      16'h0052: rd_addr    <= mmio.wr_data[$size(rd_addr)-1:0];
 	      16'h0054: wr_addr    <= mmio.wr_data[$size(wr_addr)-1:0];
 	      16'h0056: input_size <= mmio.wr_data[$size(input_size)-1:0];
+	      16'h005A: mode       <= mmio.wr_data[$size(mode)-1:0];
+	      16'h005C: op         <= pipe_pkg::op_t'(mmio.wr_data[$size(op)-1:0]);
             endcase
          end
       end
@@ -113,6 +131,8 @@ module memory_map
 	      16'h0054: mmio.rd_data[$size(wr_addr)-1:0]    <= wr_addr;
 	      16'h0056: mmio.rd_data[$size(input_size)-1:0] <= input_size;     
 	      16'h0058: mmio.rd_data[0] 		    <= done;
+	      16'h005A: mmio.rd_data[$size(mode)-1:0]       <= mode;
+	      16'h005C: mmio.rd_data[$size(op)-1:0]         <= op;
 	      
 	      // If the processor requests an address that is unused, return 0.
               default:  mmio.rd_data 			    <= 64'h0;
@@ -0,0 +1,46 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+
+`ifndef __PIPE_PKG__
+`define __PIPE_PKG__
+
+package pipe_pkg;
+
+   // Operations of the multiply-add tree in pipeline.sv, which are selected
+   // at runtime. The encoding matches the MMIO op register (see
+   // memory_map.sv).
+   typedef enum logic [2:0] {
+      OP_SUM_OF_PRODUCTS = 3'd0,
+      OP_SUM = 3'd1,
+      OP_MIN = 3'd2,
+      OP_MAX = 3'd3,
+      OP_SUM_OF_SQUARES = 3'd4
+   } op_t;
+
+   // Returns the latency of the multiply-add tree in pipeline.sv, which is
+   // 1 cycle for the registered inputs, mult_stages for the multipliers, and
+   // add_stages for each of the log2(num_inputs) levels of adders. The
+   // latency is the same for every operation. The AFU uses this to size the
+   // absorption FIFO, so the latency only has to be changed in one place.
+   function automatic int latency(int num_inputs, int mult_stages, int add_stages);
+      return 1 + mult_stages + add_stages*$clog2(num_inputs);
+   endfunction
+
+endpackage
+
+`endif
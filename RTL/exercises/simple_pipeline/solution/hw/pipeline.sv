@@ -15,18 +15,49 @@
 
 // Greg Stitt
 // University of Florida
-
 // Module Name:  pipeline.sv
 // Project:      simple pipeline
-// Description:  This pipelines takes 16 32-bit unsigned inputs, multiplies 
-//               each pair of inputs to generate 8 64-bit products, and then
-//               adds those products to generate a 64-bit result (the adds 
-//               ignore carries).
+// Description:  This pipelines takes NUM_INPUTS unsigned inputs, multiplies 
+//               each pair of inputs to generate NUM_INPUTS/2 products, and then
+//               adds those products with a tree of adders to generate a
+//               single result. All products and sums are RESULT_WIDTH bits,
+//               so the multiplies and adds ignore carries out of the result.
+//               With the default parameters, the pipeline takes 16 32-bit
+//               inputs and generates a 64-bit result. With SIGNED set, the
+//               inputs are two's complement integers that are sign extended
+//               to RESULT_WIDTH bits, which allows narrow inputs (e.g. int8)
+//               to be accumulated into a wider result.
+//
+//               The op input selects the operation of the tree at runtime
+//               (see pipe_pkg::op_t). The first level of the tree maps each
+//               input to a RESULT_WIDTH-bit value: the product of each pair
+//               (with 0 for the second value of the pair), the square of
+//               each input, or the input itself. The remaining levels reduce
+//               those values with an add, min, or max, so the latency is
+//               the same for every operation. Sum of squares needs a
+//               multiplier for every input, so there are NUM_INPUTS
+//               multipliers instead of NUM_INPUTS/2. op must not change
+//               while the pipeline contains valid inputs.
 //
 //               The pipeline has valid inputs when valid_in is asserted, and
 //               asserts valid_out when the result is valid. The pipeline stalls
 //               when en = 0, but recommended usage is to hardcode en to 1 when
 //               instantiating the pipeline (see afu.sv).
+//
+//               The latency of the pipeline is given by pipe_pkg::latency().
+
+//===================================================================
+// Parameter Description
+// NUM_INPUTS   : The number of inputs. Must be a power of 2 and at least 4.
+// INPUT_WIDTH  : The width of each input.
+// RESULT_WIDTH : The width of the products, sums, and result.
+// MULT_STAGES  : The number of register stages after each multiplier
+//                (at least 1). Extra stages can be retimed into the DSP
+//                blocks by synthesis to increase the clock frequency.
+// ADD_STAGES   : The number of register stages after each level of adders
+//                (at least 1).
+// SIGNED       : Treats the inputs as signed when set.
+//===================================================================
 
 //===================================================================
 // Interface Description
@@ -34,31 +65,70 @@
 // rst  : Reset input (active high)
 // en   : Activates pipeline when asserted (active high), stalls when 0
 // valid_id : Specifies validity of data on inputs.
-// inputs : An array of 16 unsigned 32-bit inputs.
-// result : The 64-bit result.
+// op   : The operation of the tree (see pipe_pkg::op_t).
+// inputs : An array of NUM_INPUTS unsigned INPUT_WIDTH-bit inputs.
+// result : The RESULT_WIDTH-bit result.
 // valid_out : Asserted when result contains valid data (active high)
 //===================================================================
 
 module pipeline
+  #(
+    parameter int NUM_INPUTS=16,
+    parameter int INPUT_WIDTH=32,
+    parameter int RESULT_WIDTH=64,
+    parameter int MULT_STAGES=1,
+    parameter int ADD_STAGES=1,
+    parameter bit SIGNED=0
+    )
   (
-    input 		clk,
-    input 		rst,
-    input 		en, 
-    input 		valid_in,
-    input [31:0] 	inputs[16],
-    output logic [63:0] result,
-    output logic 	valid_out
+    input 			  clk,
+    input 			  rst,
+    input 			  en, 
+    input 			  valid_in,
+    input 			  pipe_pkg::op_t op,
+    input [INPUT_WIDTH-1:0] 	  inputs[NUM_INPUTS],
+    output logic [RESULT_WIDTH-1:0] result,
+    output logic 		  valid_out
     );
 
-   // Would normally be calculated based off the number of inputs, but since
-   // the inputs are fixed, the latency is just hardcoded.
-   localparam int 	LATENCY = 5;
+   localparam int NUM_PRODUCTS = NUM_INPUTS / 2;
+   localparam int ADD_LEVELS = $clog2(NUM_INPUTS);
+   localparam int LATENCY = pipe_pkg::latency(NUM_INPUTS, MULT_STAGES, ADD_STAGES);
+
+   // Make sure the parameters describe a complete tree.
+   initial begin
+      if (NUM_INPUTS < 4 || 2**$clog2(NUM_INPUTS) != NUM_INPUTS)
+	$error("NUM_INPUTS (%0d) must be a power of 2 that is at least 4.", NUM_INPUTS);
+      if (MULT_STAGES < 1 || ADD_STAGES < 1)
+	$error("MULT_STAGES and ADD_STAGES must be at least 1.");
+   end
 
-   // Signals for each row of the multiply-add tree.
-   logic [31:0] 		   inputs_r[16];
-   logic [63:0] 		   mult_out_r[8];
-   logic [63:0] 		   add_out_l1_r[4];
-   logic [63:0] 		   add_out_l2_r[2];
+   // Signals for each row of the multiply-add tree. The first index of each
+   // array is the register stage. Level l of the adders uses the first
+   // NUM_INPUTS/2**(l+1) adders of add_out_r[l].
+   logic [INPUT_WIDTH-1:0] 	   inputs_r[NUM_INPUTS];
+   logic [RESULT_WIDTH-1:0] 	   mult_out_r[MULT_STAGES][NUM_INPUTS];
+   logic [RESULT_WIDTH-1:0] 	   add_out_r[ADD_LEVELS][ADD_STAGES][NUM_INPUTS/2];
+
+   // Sign or zero extends an input to RESULT_WIDTH bits.
+   function automatic logic [RESULT_WIDTH-1:0] extend(logic [INPUT_WIDTH-1:0] x);
+      if (SIGNED) return RESULT_WIDTH'(signed'(x));
+      else return RESULT_WIDTH'(x);
+   endfunction
+
+   // The operation of each node in the adder tree.
+   function automatic logic [RESULT_WIDTH-1:0] reduce(pipe_pkg::op_t op,
+						      logic [RESULT_WIDTH-1:0] a,
+						      logic [RESULT_WIDTH-1:0] b);
+      logic a_lt_b;
+      a_lt_b = SIGNED ? signed'(a) < signed'(b) : a < b;
+
+      case (op)
+	pipe_pkg::OP_MIN: return a_lt_b ? a : b;
+	pipe_pkg::OP_MAX: return a_lt_b ? b : a;
+	default: return a + b;
+      endcase
+   endfunction
 
    // Delays valid_in by LATENCY cycles.
    logic 			   delay_r[LATENCY];  
@@ -85,27 +155,55 @@ module pipeline
       else if (en) begin
 	 // Register the inputs (not necessary, but usually a good idea
 	 // for timing optimization if you don't know where they come from).
-	 for (int i=0; i < 16; i++) begin
+	 for (int i=0; i < NUM_INPUTS; i++) begin
 	    inputs_r[i] <= inputs[i];  	    
 	 end
 
-	 // Multiply pairs of inputs.
-	 for (int i=0; i < 8; i++) begin
-	    mult_out_r[i] <= inputs_r[i*2] * inputs_r[i*2+1];
-	 end;
+	 // Map each pair of inputs to two values for the adder tree, followed by
+	 // any extra register stages. The first multiplier of each pair
+	 // computes the product or the square of the first input, and the
+	 // second multiplier is only used for the square of the second input.
+	 for (int i=0; i < NUM_PRODUCTS; i++) begin
+	    case (op)
+	      pipe_pkg::OP_SUM_OF_PRODUCTS: begin
+		 mult_out_r[0][i*2] <= extend(inputs_r[i*2]) * extend(inputs_r[i*2+1]);
+		 mult_out_r[0][i*2+1] <= '0;
+	      end
+	      pipe_pkg::OP_SUM_OF_SQUARES: begin
+		 mult_out_r[0][i*2] <= extend(inputs_r[i*2]) * extend(inputs_r[i*2]);
+		 mult_out_r[0][i*2+1] <= extend(inputs_r[i*2+1]) * extend(inputs_r[i*2+1]);
+	      end
+	      default: begin
+		 mult_out_r[0][i*2] <= extend(inputs_r[i*2]);
+		 mult_out_r[0][i*2+1] <= extend(inputs_r[i*2+1]);
+	      end
+	    endcase
+	 end
 
-	 // Add pairs of multiplication outputs.
-	 for (int i=0; i < 4; i++) begin
-	    add_out_l1_r[i] <= mult_out_r[i*2] + mult_out_r[i*2+1];
-	 end;
+	 for (int i=0; i < NUM_INPUTS; i++) begin
+	    for (int s=1; s < MULT_STAGES; s++) begin
+	       mult_out_r[s][i] <= mult_out_r[s-1][i];
+	    end
+	 end
 
-	 // Add pairs of previous adds.
-	 for (int i=0; i < 2; i++) begin
-	    add_out_l2_r[i] <= add_out_l1_r[i*2] + add_out_l1_r[i*2+1];
-	 end;
+	 // Reduce pairs of multiplication outputs.
+	 for (int i=0; i < NUM_INPUTS/2; i++) begin
+	    add_out_r[0][0][i] <= reduce(op, mult_out_r[MULT_STAGES-1][i*2], mult_out_r[MULT_STAGES-1][i*2+1]);
+	 end
 
-	 // Add the final two adder outputs to get the result.
-	 result <= add_out_l2_r[0] + add_out_l2_r[1];
+	 // Reduce pairs of the previous level's outputs until there is one result.
+	 for (int l=1; l < ADD_LEVELS; l++) begin
+	    for (int i=0; i < NUM_INPUTS/2**(l+1); i++) begin
+	       add_out_r[l][0][i] <= reduce(op, add_out_r[l-1][ADD_STAGES-1][i*2], add_out_r[l-1][ADD_STAGES-1][i*2+1]);
+	    end
+	 end
+
+	 // Extra register stages after each level of adders.
+	 for (int l=0; l < ADD_LEVELS; l++) begin
+	    for (int s=1; s < ADD_STAGES; s++) begin
+	       add_out_r[l][s] <= add_out_r[l][s-1];
+	    end
+	 end
 
 	 // Delay valid_in by LATENCY cycles.
 	 delay_r[0] <= valid_in;	 
@@ -115,6 +213,9 @@ module pipeline
       end     
    end
 
+   // The last level of adders generates the result.
+   assign result = add_out_r[ADD_LEVELS-1][ADD_STAGES-1][0];
+
    // The pipeline output is valid after LATENCY cycles (with enable asserted).
    assign valid_out = delay_r[LATENCY-1];      
 
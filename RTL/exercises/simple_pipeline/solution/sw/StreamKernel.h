@@ -0,0 +1,258 @@
+// Copyright (c) 2020 University of Florida
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Greg Stitt
+// University of Florida
+//
+// Description: A templated host framework for AFUs that stream an input
+// array through a pipeline and write an output array, like the pipeline
+// exercises. A kernel is described by its input and output element types,
+// and the number of elements of each type in a cache line (by default, as
+// many as fit). Every other size follows from those at compile time, so
+// applications don't have to hand-code the cache-line arithmetic.
+//
+// Each output is computed from input_cls_per_output cache lines of inputs,
+// and the AFU packs OUTPUTS_PER_CL outputs into every output cache line. The
+// AFU only writes complete cache lines, so the framework pads each job to a
+// full output cache line with zero inputs. To minimize that padding, several
+// requests can be batched into a single job, which only pads the end of the
+// batch.
+//
+// The AFU must use the MMIO protocol of the pipeline exercises (see
+// StreamRegs): the read and write addresses, the number of input cache
+// lines, a go register, and a done register.
+
+#ifndef __STREAM_KERNEL_H__
+#define __STREAM_KERNEL_H__
+
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "AFU.h"
+
+
+// MMIO addresses of the registers used to launch a job.
+struct StreamRegs {
+
+  uint64_t go;
+  uint64_t rd_addr;
+  uint64_t wr_addr;
+  uint64_t size;
+  uint64_t done;
+};
+
+
+template <typename in_t, typename out_t,
+	  unsigned INPUTS_PER_CL_=AFU::CL_BYTES/sizeof(in_t),
+	  unsigned OUTPUTS_PER_CL_=AFU::CL_BYTES/sizeof(out_t)>
+class StreamKernel {
+
+public:
+
+  // Types, Constants
+  static const unsigned INPUTS_PER_CL = INPUTS_PER_CL_;
+  static const unsigned OUTPUTS_PER_CL = OUTPUTS_PER_CL_;
+
+  static_assert(INPUTS_PER_CL > 0 && INPUTS_PER_CL*sizeof(in_t) <= AFU::CL_BYTES,
+		"Inputs must fit in a cache line.");
+  static_assert(OUTPUTS_PER_CL > 0 && OUTPUTS_PER_CL*sizeof(out_t) <= AFU::CL_BYTES,
+		"Outputs must fit in a cache line.");
+
+  // The arrays of a job, and the requests batched into it. The outputs of
+  // request i start at output offsets[i].
+  struct Job {
+
+    volatile uint8_t *input;
+    volatile uint8_t *output;
+    std::vector<uint64_t> sizes;
+    std::vector<uint64_t> offsets;
+    // Requested outputs, which excludes the padding.
+    uint64_t num_outputs;
+    uint64_t input_cls;
+    uint64_t output_cls;
+  };
+
+  // Constructors, destructors
+  StreamKernel(AFU &afu, const StreamRegs &regs, unsigned input_cls_per_output=1) :
+    afu_(afu), regs_(regs), input_cls_per_output_(input_cls_per_output),
+    poll_ms_(0) {
+
+    if (input_cls_per_output == 0)
+      throw std::runtime_error("ERROR: Each output requires at least one input cache line.");
+  }
+
+  // Methods
+
+  unsigned inputsPerOutput() const { return INPUTS_PER_CL * input_cls_per_output_; }
+
+  // Returns the number of outputs after padding to a full output cache line.
+  static uint64_t paddedOutputs(uint64_t outputs) {
+
+    return (outputs + OUTPUTS_PER_CL - 1) / OUTPUTS_PER_CL * OUTPUTS_PER_CL;
+  }
+
+  // Allocates a job with num_outputs outputs.
+  Job allocate(uint64_t num_outputs) {
+
+    return allocate(std::vector<uint64_t>(1, num_outputs));
+  }
+
+  // Allocates a job that batches requests with the specified numbers of
+  // outputs. The requests are stored back to back, so only the end of the
+  // job is padded.
+  Job allocate(const std::vector<uint64_t> &sizes) {
+
+    Job job;
+    job.sizes = sizes;
+    job.num_outputs = 0;
+    for (uint64_t size : sizes) {
+      job.offsets.push_back(job.num_outputs);
+      job.num_outputs += size;
+    }
+
+    if (job.num_outputs == 0)
+      throw std::runtime_error("ERROR: Jobs require at least one output.");
+
+    job.output_cls = paddedOutputs(job.num_outputs) / OUTPUTS_PER_CL;
+    job.input_cls = job.output_cls * OUTPUTS_PER_CL * input_cls_per_output_;
+    job.input = afu_.malloc<volatile uint8_t>(job.input_cls * AFU::CL_BYTES);
+    job.output = afu_.malloc<volatile uint8_t>(job.output_cls * AFU::CL_BYTES);
+    return job;
+  }
+
+  void free(Job &job) {
+
+    afu_.free(job.input);
+    afu_.free(job.output);
+    job.input = nullptr;
+    job.output = nullptr;
+  }
+
+  // Input j of output i, and output i.
+  volatile in_t& input(const Job &job, uint64_t i, unsigned j) const {
+
+    uint64_t cl = i * input_cls_per_output_ + j / INPUTS_PER_CL;
+    return *reinterpret_cast<volatile in_t*>(job.input + cl * AFU::CL_BYTES +
+					     (j % INPUTS_PER_CL) * sizeof(in_t));
+  }
+
+  volatile out_t& output(const Job &job, uint64_t i) const {
+
+    return *reinterpret_cast<volatile out_t*>(job.output + (i / OUTPUTS_PER_CL) * AFU::CL_BYTES +
+					      (i % OUTPUTS_PER_CL) * sizeof(out_t));
+  }
+
+  // Initializes the inputs of every requested output with gen(), and the
+  // padding with zeros. Also clears the outputs.
+  template <typename Gen>
+  void fill(Job &job, Gen gen) {
+
+    for (uint64_t i=0; i < job.output_cls * OUTPUTS_PER_CL; i++) {
+      for (unsigned j=0; j < inputsPerOutput(); j++) {
+	input(job, i, j) = i < job.num_outputs ? gen() : in_t(0);
+      }
+    }
+
+    clearOutputs(job);
+  }
+
+  void clearOutputs(Job &job) {
+
+    for (uint64_t i=0; i < job.output_cls * AFU::CL_BYTES; i++) {
+      job.output[i] = 0;
+    }
+  }
+
+  // Starts a job without waiting for it to finish. Any registers specific to
+  // the AFU must be written before launching.
+  void launch(const Job &job) {
+
+    afu_.write(regs_.rd_addr, (uint64_t) job.input);
+    afu_.write(regs_.wr_addr, (uint64_t) job.output);
+    afu_.write(regs_.size, job.input_cls);
+    afu_.write(regs_.go, 1);
+  }
+
+  bool isDone() const { return afu_.read(regs_.done) != 0; }
+
+  // Waits for the launched job to finish. With a poll interval, the CPU
+  // sleeps between reads of the done register, which is useful in simulation.
+  void wait() const {
+
+    while (!isDone()) {
+      if (poll_ms_ > 0)
+	std::this_thread::sleep_for(std::chrono::milliseconds(poll_ms_));
+    }
+  }
+
+  void run(const Job &job) {
+
+    launch(job);
+    wait();
+  }
+
+  void setPollInterval(unsigned ms) { poll_ms_ = ms; }
+
+  // Runs job iterations times, and returns the average seconds per job.
+  double benchmark(const Job &job, unsigned iterations) {
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i=0; i < iterations; i++) {
+      run(job);
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+  }
+
+  // Compares every requested output with reference(inputs, num_inputs),
+  // which is given a copy of the output's inputs, using
+  // equal(output, expected). Returns the number of incorrect outputs.
+  template <typename Ref, typename Cmp>
+  uint64_t verify(const Job &job, Ref reference, Cmp equal) const {
+
+    uint64_t errors = 0;
+    std::vector<in_t> inputs(inputsPerOutput());
+    for (uint64_t i=0; i < job.num_outputs; i++) {
+      for (unsigned j=0; j < inputsPerOutput(); j++) {
+	inputs[j] = input(job, i, j);
+      }
+
+      if (!equal(output(job, i), reference(inputs.data(), inputsPerOutput()))) {
+	errors ++;
+      }
+    }
+
+    return errors;
+  }
+
+  template <typename Ref>
+  uint64_t verify(const Job &job, Ref reference) const {
+
+    return verify(job, reference, [](out_t a, out_t b) { return a == b; });
+  }
+
+private:
+
+  AFU &afu_;
+  StreamRegs regs_;
+  unsigned input_cls_per_output_;
+  unsigned poll_ms_;
+};
+
+#endif
@@ -4,6 +4,8 @@
 #ifndef __CONFIG_H__
 #define __CONFIG_H__
 
+#include <cstdint>
+
 //=============================================================
 // Configuration settings
 
@@ -17,6 +19,11 @@
 // The number of milliseconds to sleep when SLEEP_WHILE_WAITING is defined.
 const unsigned SLEEP_MS = 10;
 
+// The types of the pipeline inputs and results, which must match the
+// INPUT_WIDTH and RESULT_WIDTH parameters of hw/afu.sv.
+typedef uint32_t input_t;
+typedef uint64_t result_t;
+
 
 //=============================================================
 // AFU MMIO Addresses
@@ -27,9 +34,33 @@ enum MmioAddr {
   MMIO_RD_ADDR=0x0052,
   MMIO_WR_ADDR=0x0054,
   MMIO_SIZE=0x0056,
-  MMIO_DONE=0x0058
+  MMIO_DONE=0x0058,
+  MMIO_MODE=0x005A,
+  MMIO_OP=0x005C
+};
+
+// Input modes for MMIO_MODE. The packed modes use signed 16-bit and 8-bit
+// inputs with 64-bit and 32-bit results.
+enum Mode {
+
+  MODE_WIDE=0,
+  MODE_INT16=1,
+  MODE_INT8=2
 };
 
+// Operations for MMIO_OP, which must match pipe_pkg::op_t in hw/pipe_pkg.sv.
+enum Op {
+
+  OP_SUM_OF_PRODUCTS=0,
+  OP_SUM=1,
+  OP_MIN=2,
+  OP_MAX=3,
+  OP_SUM_OF_SQUARES=4,
+  NUM_OPS
+};
+
+const char * const OP_NAMES[NUM_OPS] = {"sum of products", "sum", "min", "max", "sum of squares"};
+
 
 
 #endif
@@ -24,20 +24,37 @@
 // takes as input the number of output cache lines, and then determines the 
 // appropriate number of outputs and inputs to fill those cache lines. 
 //
+// An optional mode selects packed signed inputs instead: 32 16-bit inputs
+// per cache line with 64-bit results, or 64 8-bit inputs per cache line with
+// 32-bit results.
+//
+// An optional operation replaces the sum of products with a sum, min, max,
+// or sum of squares of each cache line. With "all", the application runs a
+// job for every operation over the same input array, which only changes the
+// AFU's op register between jobs.
+//
 // This software allocates the input and output arrays, initializes their 
 // contents, transfers the virtual addresses of the arrays, the 
-// number of input cache lines to read, and a go signal to start the AFU. The
-// software then waits until the AFU signals that it is done.
+// number of input cache lines to read, the mode, and a go signal to start
+// the AFU. The software then waits until the AFU signals that it is done.
+// The sizes of the arrays, the launch, and the verification are handled by
+// the generic StreamKernel (see StreamKernel.h).
 
 #include <cstdlib>
 #include <iostream>
 #include <cmath>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
 
 #include <opae/utils.h>
 
 #include "AFU.h"
 // Contains application-specific information
 #include "config.h"
+// Generic allocation, launching, and verification of streaming jobs
+#include "StreamKernel.h"
 // Auto-generated by OPAE's afu_json_mgr script
 #include "afu_json_info.h"
 
@@ -45,76 +62,123 @@ using namespace std;
 
 
 void printUsage(char *name);
-bool checkUsage(int argc, char *argv[], unsigned long &num_inputs);
-uint64_t getCorrectOutput(volatile uint32_t input[], unsigned output_id);
+bool checkUsage(int argc, char *argv[], unsigned long &num_output_cls, unsigned &mode, vector<Op> &ops);
+
+// Each output is computed from one cache line of inputs (16 32-bit inputs
+// with the default types in config.h).
+typedef StreamKernel<input_t, result_t> DefaultKernel;
+const unsigned INPUTS_PER_OUTPUT = DefaultKernel::INPUTS_PER_CL;
+const unsigned OUTPUTS_PER_CL = DefaultKernel::OUTPUTS_PER_CL;
+
+// Registers that launch a job.
+const StreamRegs STREAM_REGS = {MMIO_GO, MMIO_RD_ADDR, MMIO_WR_ADDR, MMIO_SIZE, MMIO_DONE};
+
+
+// Returns the correct output for the num_inputs inputs of a cache line.
+template <typename in_t, typename out_t>
+out_t getCorrectOutput(const in_t input[], unsigned num_inputs, Op op) {
+
+  // Perform the same computation as the AFU pipeline, which ignores the
+  // carries out of each result. Signed inputs are sign extended before
+  // each operation, and the sums and products are computed as uint64_t to
+  // ignore the carries.
+  typedef typename conditional<is_signed<in_t>::value, int64_t, uint64_t>::type wide_t;
+  wide_t extreme = input[0];
+  uint64_t result = 0;
+  for (unsigned i=0; i < num_inputs; i+=2) {
+    wide_t a = input[i], b = input[i+1];
+    switch (op) {
+    case OP_SUM:
+      result += (uint64_t) a + (uint64_t) b;
+      break;
+    case OP_MIN:
+      extreme = min(extreme, min(a, b));
+      break;
+    case OP_MAX:
+      extreme = max(extreme, max(a, b));
+      break;
+    case OP_SUM_OF_SQUARES:
+      result += (uint64_t) a * (uint64_t) a + (uint64_t) b * (uint64_t) b;
+      break;
+    default:
+      result += (uint64_t) a * (uint64_t) b;
+    }
+  }
+
+  if (op == OP_MIN || op == OP_MAX) {
+    return (out_t) extreme;
+  }
+
+  return (out_t) result;
+}
+
+
+// Runs a job for each operation in ops over the same input array, with in_t
+// and out_t matching the input and result widths of the mode. Returns the
+// total number of incorrect outputs.
+template <typename in_t, typename out_t>
+unsigned runTest(AFU &afu, unsigned long num_output_cls, unsigned mode, const vector<Op> &ops) {
+
+  // Each output is computed from one cache line of inputs, and the kernel
+  // determines the number of inputs and outputs per cache line from the
+  // types.
+  StreamKernel<in_t, out_t> kernel(afu, STREAM_REGS);
+#ifdef SLEEP_WHILE_WAITING
+  kernel.setPollInterval(SLEEP_MS);
+#endif
+
+  // Allocate and initialize the input and output arrays.
+  auto job = kernel.allocate(num_output_cls * kernel.OUTPUTS_PER_CL);
+  kernel.fill(job, []() { return (in_t) rand(); });
+
+  afu.write(MMIO_MODE, mode);
+
+  unsigned total_errors = 0;
+  for (Op op : ops) {
+
+    // The operation only has to be written before each job. Everything else
+    // stays the same, so the same input is processed without reconfiguring.
+    kernel.clearOutputs(job);
+    afu.write(MMIO_OP, op);
+    kernel.run(job);
+
+    unsigned errors = kernel.verify(job, [op](const in_t *input, unsigned num_inputs) {
+	return getCorrectOutput<in_t, out_t>(input, num_inputs, op);
+      });
+
+    cout << OP_NAMES[op] << ": " << errors << " incorrect outputs." << endl;
+    total_errors += errors;
+  }
+
+  kernel.free(job);
+  return total_errors;
+}
 
 
 int main(int argc, char *argv[]) {
 
   unsigned long num_output_cls;
-  unsigned long num_inputs;
-  unsigned long num_outputs;
+  unsigned mode;
+  vector<Op> ops;
 
-  if (!checkUsage(argc, argv, num_output_cls)) {
+  if (!checkUsage(argc, argv, num_output_cls, mode, ops)) {
     printUsage(argv[0]);
     return EXIT_FAILURE;
   }
   
-  // There are 8 64-bit outputs per cache line.
-  num_outputs = num_output_cls * 8;
-  // There are 16 32-bit inputs per output.
-  num_inputs = num_outputs * 16;
-
   try {
     AFU afu(AFU_ACCEL_UUID); 
-    bool failed = false;
-
-    // Allocate input and output arrays.
-    auto input  = afu.malloc<volatile uint32_t>(num_inputs);
-    auto output = afu.malloc<volatile uint64_t>(num_outputs);  
+    unsigned errors;
 
-    // Initialize the input and output arrays.
-    for (unsigned i=0; i < num_inputs; i++) {      
-      input[i] = rand();
+    if (mode == MODE_INT16) {
+      errors = runTest<int16_t, int64_t>(afu, num_output_cls, mode, ops);
     }
-
-    for (unsigned i=0; i < num_outputs; i++) {      
-      output[i] = 0;
-    }   
-    
-    // Inform the FPGA of the starting addresses of the arrays.
-    afu.write(MMIO_RD_ADDR, (uint64_t) input);
-    afu.write(MMIO_WR_ADDR, (uint64_t) output);
-
-    // The FPGA DMA only handles cache-line transfers, so we need to convert
-    // the input array size to cache lines. We could also do this conversion 
-    // on the FPGA and transfer the number of inputs instead here.
-    // The number of output cache lines is calculated by the FPGA.
-    unsigned total_bytes = num_inputs*sizeof(uint32_t);
-    unsigned num_cls = ceil((float) total_bytes / (float) AFU::CL_BYTES);
-    afu.write(MMIO_SIZE, num_cls);
-
-    // Start the FPGA DMA transfer (cleared automatically by the AFU).
-    afu.write(MMIO_GO, 1);  
-
-    // Wait until the FPGA is done.
-    while (afu.read(MMIO_DONE) == 0) {
-#ifdef SLEEP_WHILE_WAITING
-      this_thread::sleep_for(chrono::milliseconds(SLEEP_MS));
-#endif
+    else if (mode == MODE_INT8) {
+      errors = runTest<int8_t, int32_t>(afu, num_output_cls, mode, ops);
     }
-
-    // Verify the output.
-    unsigned errors = 0;
-    for (unsigned i=0; i < num_outputs; i++) {     
-      if (output[i] != getCorrectOutput(input, i)) {
-	errors ++;
-      }
+    else {
+      errors = runTest<input_t, result_t>(afu, num_output_cls, mode, ops);
     }
-
-    // Free the allocated memory.
-    afu.free(input);
-    afu.free(output);
         
     if (errors == 0) {
       cout << "SUCCESS: all outputs correct." << endl;
@@ -153,8 +217,11 @@ int main(int argc, char *argv[]) {
 
 void printUsage(char *name) {
 
-  cout << "Usage: " << name << " size\n"     
-       << "size (positive integer for number of output cache lines to test. Every output cache line adds 8 32-bit outputs and 128 64-bit inputs.)\n"
+  cout << "Usage: " << name << " size [mode] [op]\n"     
+       << "size (positive integer for number of output cache lines to test. Every output cache line adds "
+       << OUTPUTS_PER_CL << " outputs and " << OUTPUTS_PER_CL*INPUTS_PER_OUTPUT << " inputs in mode 0.)\n"
+       << "mode (0 for the default inputs, 1 for signed 16-bit inputs, 2 for signed 8-bit inputs, default 0)\n"
+       << "op (0 for sum of products, 1 for sum, 2 for min, 3 for max, 4 for sum of squares, all for every operation, default 0)\n"
        << endl;
 }
 
@@ -173,11 +240,32 @@ unsigned long stringToPositiveInt(char *str) {
 }
 
 
-bool checkUsage(int argc, char *argv[], unsigned long &num_output_cls) {
+bool checkUsage(int argc, char *argv[], unsigned long &num_output_cls, unsigned &mode, vector<Op> &ops) {
   
-  if (argc == 2) {
+  mode = MODE_WIDE;
+  ops = {OP_SUM_OF_PRODUCTS};
+  if (argc >= 2 && argc <= 4) {
     try {
       num_output_cls = stringToPositiveInt(argv[1]);
+      if (argc >= 3) {
+	string mode_str = argv[2];
+	if (mode_str == "0") mode = MODE_WIDE;
+	else if (mode_str == "1") mode = MODE_INT16;
+	else if (mode_str == "2") mode = MODE_INT8;
+	else return false;
+      }
+      if (argc == 4) {
+	string op_str = argv[3];
+	if (op_str == "all") {
+	  ops = {OP_SUM_OF_PRODUCTS, OP_SUM, OP_MIN, OP_MAX, OP_SUM_OF_SQUARES};
+	}
+	else if (op_str.size() == 1 && op_str[0] >= '0' && op_str[0] < '0' + NUM_OPS) {
+	  ops = {Op(op_str[0] - '0')};
+	}
+	else {
+	  return false;
+	}
+      }
     }
     catch (const runtime_error& e) {    
       return false;
@@ -189,20 +277,3 @@ bool checkUsage(int argc, char *argv[], unsigned long &num_output_cls) {
 
   return true;
 }
-
-
-uint64_t getCorrectOutput(volatile uint32_t input[], unsigned output_id) {
-
-  // There are 16 inputs for every output, so find the appropriate range
-  // of the input array to calculate the requested output.
-  unsigned start_index = output_id*16;
-  unsigned end_index = start_index + 16;
-
-  // Perform the same computation as the AFU pipeline.
-  uint64_t result = 0;
-  for (unsigned i=start_index; i < end_index; i+=2) {
-    result += (uint64_t) input[i] * (uint64_t) input[i+1];
-  }
-
-  return result;
-}